@@ -0,0 +1,255 @@
+// bench/file_chunker_bench.cpp
+// Micro-benchmarks of the chunking, storage and bookkeeping paths (target file-chunker-bench,
+// built with -DFM_BUILD_BENCHMARKS=ON). Runs in a scratch store under the temp directory.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chunk.hpp"
+#include "chunk_config.hpp"
+#include "chunk_reference_manager.hpp"
+#include "cid_utility.hpp"
+#include "file_manager.hpp"
+#include "file_metadata.hpp"
+#include "logger.hpp"
+#include "merkle_tree.hpp"
+#include "thread_pool.hpp"
+
+namespace fs = std::filesystem;
+using FileManager::Config::ChunkConfig;
+
+namespace
+{
+    // Chunk and metadata directories are relative to the working directory (see ChunkConfig),
+    // so every benchmark works inside one scratch directory, emptied on first use.
+    void enterScratchStore()
+    {
+        static const bool entered = []
+        {
+            fs::path dir = fs::temp_directory_path() / "file-chunker-bench";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            fs::current_path(dir);
+            FileManager::Logging::Logger::global().setLevel(FileManager::Logging::Level::Warn);
+            return true;
+        }();
+        (void)entered;
+    }
+
+    ChunkConfig benchConfig(ChunkConfig::Compression compression = ChunkConfig::Compression::None)
+    {
+        ChunkConfig config;
+        config.compression = compression;
+        config.gc_interval_s = 0; // No background work competing with the measurements
+        config.compaction_interval_s = 0;
+        config.scrub_interval_s = 0;
+        return config;
+    }
+
+    ChunkConfig::Compression compressionArg(benchmark::State &state)
+    {
+        static const ChunkConfig::Compression modes[] = {ChunkConfig::Compression::None, ChunkConfig::Compression::LZ4,
+                                                         ChunkConfig::Compression::Zstd};
+        static const char *const names[] = {"none", "lz4", "zstd"};
+        state.SetLabel(names[state.range(0)]);
+        return modes[state.range(0)];
+    }
+
+    // Incompressible bytes
+    std::vector<char> randomBytes(size_t size, uint32_t seed = 1)
+    {
+        std::vector<char> data(size);
+        std::mt19937 rng(seed);
+        for (char &c : data)
+        {
+            c = static_cast<char>(rng());
+        }
+        return data;
+    }
+
+    // Log-like text, which compresses about as well as typical uploads
+    std::vector<char> textBytes(size_t size)
+    {
+        std::vector<char> data;
+        data.reserve(size);
+        char line[128];
+        for (size_t i = 0; data.size() < size; ++i)
+        {
+            int n = std::snprintf(line, sizeof(line), "2024-01-01T00:00:%02zu.%03zuZ INFO request served path=/files/%zu status=200\n",
+                                  i % 60, i % 1000, i * 7919 % 100000);
+            data.insert(data.end(), line, line + n);
+        }
+        data.resize(size);
+        return data;
+    }
+
+    // Fake but well-formed CIDs, cheaper than hashing for large manifests
+    std::vector<std::string> fakeCids(size_t count)
+    {
+        std::vector<std::string> cids;
+        cids.reserve(count);
+        char hex[65];
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::snprintf(hex, sizeof(hex), "%064zx", i * 2654435761u);
+            cids.emplace_back(hex);
+        }
+        return cids;
+    }
+
+    // --- Hashing ---
+
+    void BM_GenerateSHA256(benchmark::State &state)
+    {
+        const std::vector<char> data = randomBytes(static_cast<size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(FileManager::CID::CIDUtility::generateSHA256(data));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+    BENCHMARK(BM_GenerateSHA256)->RangeMultiplier(4)->Range(1 << 10, 4 << 20);
+
+    // --- Chunking ---
+
+    void BM_ProcessFileIntoChunks(benchmark::State &state)
+    {
+        enterScratchStore();
+        static FileManager::FileManager fm(std::max(1u, std::thread::hardware_concurrency()), benchConfig());
+
+        const size_t size = static_cast<size_t>(state.range(0));
+        const std::string input = "input-" + std::to_string(size) + ".bin";
+        if (!fs::exists(input))
+        {
+            std::vector<char> data = randomBytes(size);
+            std::ofstream(input, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+
+        for (auto _ : state)
+        {
+            std::vector<FileManager::Chunks::Chunk> chunks;
+            benchmark::DoNotOptimize(fm.processFileIntoChunks(input, chunks));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+    BENCHMARK(BM_ProcessFileIntoChunks)->Arg(1 << 20)->Arg(16 << 20)->Arg(64 << 20)->Unit(benchmark::kMillisecond);
+
+    // --- Chunk storage ---
+
+    // Includes the fsync and rename that make each write durable (see DurableFile)
+    void BM_ChunkSave(benchmark::State &state)
+    {
+        enterScratchStore();
+        const ChunkConfig config = benchConfig(compressionArg(state));
+        const FileManager::Chunks::Chunk chunk(textBytes(ChunkConfig::CHUNK_SIZE));
+        const fs::path path = chunk.getFullPath(config);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            fs::remove(path); // save() skips chunks that are already stored
+            state.ResumeTiming();
+            chunk.save(config);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(chunk.data.size()));
+    }
+    BENCHMARK(BM_ChunkSave)->DenseRange(0, 2)->ArgName("compression")->Unit(benchmark::kMicrosecond);
+
+    void BM_ChunkLoadData(benchmark::State &state)
+    {
+        enterScratchStore();
+        const ChunkConfig config = benchConfig(compressionArg(state));
+        std::vector<char> data = textBytes(ChunkConfig::CHUNK_SIZE);
+        data[0] = static_cast<char>(state.range(0)); // One stored file per compression mode
+        const FileManager::Chunks::Chunk chunk(std::move(data));
+        chunk.save(config);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(FileManager::Chunks::Chunk::loadData(config, chunk.cid));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(chunk.data.size()));
+    }
+    BENCHMARK(BM_ChunkLoadData)->DenseRange(0, 2)->ArgName("compression")->Unit(benchmark::kMicrosecond);
+
+    // --- Metadata ---
+
+    // Serialize and parse back, as FileMetadata::save and load do
+    void BM_FileMetadataJsonRoundTrip(benchmark::State &state)
+    {
+        FileManager::Metadata::FileMetadata metadata("file.bin", static_cast<uint64_t>(state.range(0)) * ChunkConfig::CHUNK_SIZE,
+                                                     "application/octet-stream", fakeCids(static_cast<size_t>(state.range(0))));
+        metadata.merkle_root = FileManager::CID::MerkleTree::rootOf(metadata.chunk_cids); // Else recomputed on load
+
+        for (auto _ : state)
+        {
+            std::string text = metadata.toJson().dump(4);
+            benchmark::DoNotOptimize(FileManager::Metadata::FileMetadata::fromJson(nlohmann::json::parse(text)));
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+    BENCHMARK(BM_FileMetadataJsonRoundTrip)->Arg(10)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+    // --- Reference counting ---
+
+    // Every thread takes and releases a batch of references, half of them to chunks all threads
+    // share (popular content), in one applyDeltas call each, as uploads and deletions do.
+    void BM_ChunkReferenceManagerContention(benchmark::State &state)
+    {
+        static FileManager::Chunks::ChunkReferenceManager references;
+        static const std::vector<std::string> cids = fakeCids(64 * 65);
+        const size_t batch = 64;
+
+        std::vector<std::string> mine(cids.begin(), cids.begin() + batch / 2);
+        const size_t own = batch * (1 + static_cast<size_t>(state.thread_index()));
+        mine.insert(mine.end(), cids.begin() + static_cast<std::ptrdiff_t>(own),
+                    cids.begin() + static_cast<std::ptrdiff_t>(own + batch / 2));
+        const auto take = FileManager::Chunks::ChunkReferenceManager::diff({}, mine);
+        const auto release = FileManager::Chunks::ChunkReferenceManager::negate(take);
+
+        for (auto _ : state)
+        {
+            references.applyDeltas(take);
+            references.applyDeltas(release);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(2 * batch));
+    }
+    BENCHMARK(BM_ChunkReferenceManagerContention)->ThreadRange(1, 64)->UseRealTime();
+
+    // --- Thread pool ---
+
+    // Throughput of trivial tasks through the pool, so queueing overhead dominates
+    void BM_ThreadPoolEnqueue(benchmark::State &state)
+    {
+        enterScratchStore();
+        FileManager::Concurrency::ThreadPool pool(static_cast<size_t>(state.range(0)));
+        const size_t tasks = 1000;
+        std::vector<std::future<size_t>> futures;
+        futures.reserve(tasks);
+
+        for (auto _ : state)
+        {
+            futures.clear();
+            for (size_t i = 0; i < tasks; ++i)
+            {
+                futures.push_back(pool.enqueue([i]()
+                                               { return i; }));
+            }
+            for (auto &future : futures)
+            {
+                benchmark::DoNotOptimize(future.get());
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(tasks));
+    }
+    BENCHMARK(BM_ThreadPoolEnqueue)->RangeMultiplier(2)->Range(1, 16)->ArgName("threads")->UseRealTime();
+
+} // namespace
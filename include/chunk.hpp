@@ -5,9 +5,14 @@
 #include <string>
 #include <filesystem>
 #include <stdexcept>
+#include <future>
 
 #include "chunk_config.hpp"
 #include "cid_utility.hpp"
+#include "io_engine.hpp"
+#include "group_commit.hpp"
+#include "chunk_codec.hpp"
+#include "chunk_filter.hpp"
 
 namespace FileManager {
 namespace Chunks {
@@ -26,10 +31,39 @@ public:
     Chunk() = default;
 
     // Save the chunk to disk. Filename will be its CID.
-    bool save(const Config::ChunkConfig& config);
+    // The file is written to a temp name, synced and renamed, so a crash never leaves a
+    // truncated file under a CID. Compressed according to `config` (see ChunkCodec).
+    // With a `filter`, chunks it knows to be new skip the existence check, and the chunk is
+    // added to it once written.
+    bool save(const Config::ChunkConfig& config, ChunkFilter* filter = nullptr) const;
+
+    // Write the chunk to a temp file through an I/O engine, then let `committer` sync it and
+    // rename it to its CID. Unlike save(), this doesn't check whether the chunk is already
+    // stored; callers decide dedup (e.g. from reference counts).
+    // `encoded` is the result of ChunkCodec::encode(data, config); if empty, `data` is stored as is.
+    // The chunk and `encoded` must stay alive until the returned future is ready.
+    std::future<bool> writeAsync(const Config::ChunkConfig& config, IO::IoEngine& engine,
+                                 IO::GroupCommitter& committer, const std::vector<char>& encoded) const;
+
+    // Same as writeAsync(), but writes the temp file on the calling thread and blocks until it is
+    // committed. For callers running on the thread pool, which must not block on I/O queued
+    // behind them on the same pool (as the fallback I/O engine does).
+    void write(const Config::ChunkConfig& config, IO::GroupCommitter& committer,
+               const std::vector<char>& encoded) const;
 
     // Static method to load chunk data from disk given its CID.
-    static std::vector<char> loadData(const Config::ChunkConfig& config, const std::string& chunk_cid);
+    // Compressed chunks are decompressed, so this always returns the original bytes.
+    // `dictionaries` is needed for chunks compressed with a trained dictionary.
+    // With config.verify_on_read, throws if the data doesn't hash to `chunk_cid`.
+    static std::vector<char> loadData(const Config::ChunkConfig& config, const std::string& chunk_cid,
+                                      const DictionaryStore* dictionaries = nullptr);
+
+    // Asynchronous version of loadData() that goes through an I/O engine.
+    // Decompression (if any) and verification run on the thread that calls get() on the future,
+    // so `config` must outlive it.
+    static std::future<std::vector<char>> loadDataAsync(const Config::ChunkConfig& config, IO::IoEngine& engine,
+                                                        const std::string& chunk_cid,
+                                                        const DictionaryStore* dictionaries = nullptr);
 
     // Get the full path where this chunk would be stored
     std::filesystem::path getFullPath(const Config::ChunkConfig& config) const;
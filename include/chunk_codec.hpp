@@ -0,0 +1,83 @@
+// include/chunk_codec.hpp
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+
+#include "chunk_config.hpp"
+#include "dictionary_store.hpp"
+
+namespace FileManager
+{
+    namespace Chunks
+    {
+
+        // On-disk encoding of chunk files.
+        //
+        // An uncompressed chunk is stored as its raw bytes, exactly as before, so it can still be
+        // served and reassembled straight from the page cache. A compressed chunk starts with a
+        // 16-byte header:
+        //
+        //   0..3   magic "\x89FMC"
+        //   4      format version (1)
+        //   5      codec (see Codec)
+        //   6..7   reserved, zero
+        //   8..15  uncompressed length, little-endian
+        //
+        // followed by the codec payload. A raw chunk whose bytes happen to start with the magic
+        // is stored with a header and Codec::None so the two can never be confused.
+        // A zstd payload compressed with a trained dictionary carries the dictionary's id in its
+        // frame header, so the chunk header is the same with or without one.
+        class ChunkCodec
+        {
+        public:
+            enum class Codec : uint8_t
+            {
+                None = 0,
+                LZ4 = 1,
+                Zstd = 2,
+            };
+
+            struct Header
+            {
+                Codec codec = Codec::None;
+                uint64_t raw_length = 0;
+            };
+
+            static constexpr size_t HEADER_SIZE = 16;
+
+            // Bytes to store on disk for `raw`, or an empty vector if `raw` should be stored as is
+            // (compression disabled, data looks incompressible, or the saving is too small).
+            // With Zstd compression, `dictionary` (if given) is used to compress.
+            static std::vector<char> encode(const std::vector<char> &raw, const Config::ChunkConfig &config,
+                                            const ZstdDictionary *dictionary = nullptr);
+
+            // Turn stored bytes (raw or encoded) back into the original chunk bytes.
+            // Chunks compressed with a dictionary need `dictionaries` to hold it.
+            // Throws std::runtime_error on a corrupt header or payload, or a missing dictionary.
+            static std::vector<char> decode(std::vector<char> stored, const DictionaryStore *dictionaries = nullptr);
+
+            // Parse the header at the start of a stored chunk. Returns nullopt for raw chunks.
+            // `size` may be just the first HEADER_SIZE bytes of the file.
+            static std::optional<Header> parseHeader(const char *data, size_t size);
+
+            // Enough leading bytes of a stored chunk for parseHeader() and dictionaryId()
+            static constexpr size_t PROBE_SIZE = HEADER_SIZE + 18; // Plus the largest zstd frame header
+
+            // Id of the trained dictionary a stored Zstd chunk was compressed with, or 0 if it was
+            // compressed without one or isn't a Zstd chunk. `size` may be just the first PROBE_SIZE
+            // bytes of the file.
+            static uint32_t dictionaryId(const char *data, size_t size);
+
+            // Quick entropy probe over a sample of the data; false for data that is already
+            // compressed or random, so we don't waste CPU trying.
+            static bool looksCompressible(const std::vector<char> &raw);
+
+        private:
+            static std::vector<char> withHeader(Codec codec, uint64_t raw_length, size_t payload_capacity);
+        };
+
+    } // namespace Chunks
+} // namespace FileManager
@@ -16,9 +16,142 @@ namespace FileManager
             // Define the size of each chunk (1MB)
             static const size_t CHUNK_SIZE = 1024 * 1024;
 
-            // Define the names of the directories for chunks and metadata
+            // Maximum number of chunk reads/writes the I/O engine keeps in flight
+            static const unsigned IO_QUEUE_DEPTH = 256;
+
+            // --- Tunables (per instance, defaults below; see fromEnvironment) ---
+
+            // Number of chunks retrieveFile loads ahead of the one it is writing.
+            // 0 disables read-ahead (chunks are loaded one at a time, in order).
+            size_t read_ahead_chunks = 8;
+
+            // Maximum number of chunk writes a single upload keeps outstanding at once.
+            size_t max_outstanding_writes = 64;
+
+            // How chunk and metadata writes are made crash-safe. All modes write to a temp file
+            // and rename it into place; they differ in how the data is synced first.
+            enum class Durability
+            {
+                None,        // Rename only: atomic, but may be lost on power failure
+                Immediate,   // fdatasync every file before renaming it
+                GroupCommit, // Batch syncs across concurrent writes
+            };
+            Durability durability = Durability::GroupCommit;
+
+            // How long the group committer waits for more writes to join a batch,
+            // and the largest batch it builds.
+            size_t group_commit_window_us = 2000;
+            size_t group_commit_max_batch = 512;
+
+            // I/O engine for chunk reads and writes: io_uring when the kernel supports it, else
+            // blocking I/O on the thread pool. ThreadPool forces the latter.
+            enum class IoBackend
+            {
+                Auto,
+                ThreadPool,
+            };
+            IoBackend io_backend = IoBackend::Auto;
+
+            // Per-chunk compression for newly stored chunks. CIDs are always computed over the
+            // uncompressed bytes, so this never affects deduplication.
+            enum class Compression
+            {
+                None,
+                LZ4,  // Fast, moderate ratio
+                Zstd, // Slower, better ratio
+            };
+            Compression compression = Compression::None;
+            int zstd_level = 3; // ZSTD_minCLevel() (fastest, negative) to ZSTD_maxCLevel()
+
+            // Chunks are stored uncompressed unless compression saves at least this fraction
+            // of their size.
+            double min_compression_saving = 0.1;
+
+            // Trained zstd dictionaries (see DictionaryStore), used when compression is Zstd and
+            // a dictionary exists for the file's content type.
+            // Maximum size of a trained dictionary, and how many bytes of stored chunks are
+            // sampled to train one.
+            size_t dictionary_size = 112 * 1024;
+            size_t dictionary_sample_bytes = 16 * 1024 * 1024;
+            // Train a dictionary in the background once this many files of a content type have
+            // been stored without one. 0 trains only on request.
+            size_t dictionary_auto_train_uploads = 0;
+
+            // Number of chunks the in-memory chunk filter (see ChunkFilter) is sized for.
+            // It grows to twice the stored chunks at startup if that is larger.
+            size_t chunk_filter_capacity = 1 << 20;
+
+            // Number of reader/writer locks file names are spread over (see FileLockManager).
+            size_t file_lock_stripes = 1024;
+
+            // Number of past versions kept per file when it is replaced, updated or patched (see
+            // FileMetadata::version). Past versions share chunks with each other and the current
+            // one, so each costs only the chunks it doesn't share. 0 keeps no history.
+            size_t file_versions_retained = 10;
+
+            // Background garbage collection of unreferenced chunks (see FileManager::collectGarbage).
+            // Runs every `gc_interval_s` seconds (0: only on request). Chunks modified within the
+            // grace period are never collected, which covers chunks uploaded on their own and not
+            // committed yet. Deletions are made in batches, at most `gc_max_deletes_per_second`
+            // per second (0: unlimited).
+            size_t gc_interval_s = 300;
+            size_t gc_grace_period_s = 3600;
+            size_t gc_batch_size = 256;
+            size_t gc_max_deletes_per_second = 1000;
+
+            // Deleted files' chunk references are released in the background from a persistent
+            // queue (see DeletionJournal). Journal segment size, most references released per
+            // batch, and at most how many per second (0: unlimited).
+            size_t deletion_segment_bytes = 4 * 1024 * 1024;
+            size_t deletion_batch_references = 4096;
+            size_t deletion_max_releases_per_second = 0;
+
+            // Background compaction of the chunk store (see FileManager::compactChunks): with Zstd
+            // compression, chunks stored with LZ4 or with an older dictionary than the latest one
+            // for their content type are re-encoded when that saves at least
+            // `compaction_min_saving_percent` of their size. Runs every `compaction_interval_s`
+            // seconds (0: only on request), in batches, reading at most
+            // `compaction_max_bytes_per_second` of chunk data per second (0: unlimited).
+            size_t compaction_interval_s = 3600;
+            size_t compaction_min_saving_percent = 10;
+            size_t compaction_batch_size = 64;
+            size_t compaction_max_bytes_per_second = 32 * 1024 * 1024;
+
+            // Background integrity scrubbing (see FileManager::scrubChunks): every stored chunk is
+            // re-hashed and checked against its CID, and mismatches are quarantined. A pass starts
+            // every `scrub_interval_s` seconds (0: only on request), in batches, reading at most
+            // `scrub_max_bytes_per_second` of chunk data per second (0: unlimited).
+            size_t scrub_interval_s = 24 * 3600;
+            size_t scrub_batch_size = 64;
+            size_t scrub_max_bytes_per_second = 16 * 1024 * 1024;
+
+            // Check every chunk read against its CID (see Chunk::loadData). Costs a hash per chunk
+            // read, and file downloads lose zero-copy transfer.
+            bool verify_on_read = false;
+
+            // Build a config from the defaults, overridden by environment variables:
+            //   FM_READ_AHEAD_CHUNKS, FM_MAX_OUTSTANDING_WRITES,
+            //   FM_DURABILITY (none|immediate|group), FM_GROUP_COMMIT_WINDOW_US, FM_GROUP_COMMIT_MAX_BATCH,
+            //   FM_IO_ENGINE (auto|thread_pool),
+            //   FM_COMPRESSION (none|lz4|zstd), FM_ZSTD_LEVEL,
+            //   FM_DICTIONARY_SIZE, FM_DICTIONARY_SAMPLE_BYTES, FM_DICTIONARY_AUTO_TRAIN_UPLOADS,
+            //   FM_CHUNK_FILTER_CAPACITY, FM_FILE_LOCK_STRIPES, FM_FILE_VERSIONS_RETAINED,
+            //   FM_GC_INTERVAL_S, FM_GC_GRACE_PERIOD_S, FM_GC_BATCH_SIZE, FM_GC_MAX_DELETES_PER_SECOND,
+            //   FM_DELETION_SEGMENT_BYTES, FM_DELETION_BATCH_REFERENCES, FM_DELETION_MAX_RELEASES_PER_SECOND,
+            //   FM_COMPACTION_INTERVAL_S, FM_COMPACTION_MIN_SAVING_PERCENT, FM_COMPACTION_BATCH_SIZE,
+            //   FM_COMPACTION_MAX_BYTES_PER_SECOND,
+            //   FM_SCRUB_INTERVAL_S, FM_SCRUB_BATCH_SIZE, FM_SCRUB_MAX_BYTES_PER_SECOND, FM_VERIFY_ON_READ (0|1)
+            static ChunkConfig fromEnvironment();
+
+            // Define the names of the directories for chunks, metadata, past file versions,
+            // compression dictionaries, upload sessions, the deletion journal and the scrubber
             static const std::string CHUNKS_DIR_NAME;
             static const std::string METADATA_DIR_NAME;
+            static const std::string VERSIONS_DIR_NAME;
+            static const std::string DICTIONARIES_DIR_NAME;
+            static const std::string UPLOADS_DIR_NAME;
+            static const std::string DELETIONS_DIR_NAME;
+            static const std::string SCRUB_DIR_NAME;
 
             // Get the absolute path for the chunks directory
             // This will create the directory if it doesn't exist
@@ -28,17 +161,31 @@ namespace FileManager
             // This will create the directory if it doesn't exist
             static std::filesystem::path getMetadataDirPath();
 
+            // Get the absolute path for the past file versions directory
+            // This will create the directory if it doesn't exist
+            static std::filesystem::path getVersionsDirPath();
+
+            // Get the absolute path for the compression dictionaries directory
+            // This will create the directory if it doesn't exist
+            static std::filesystem::path getDictionariesDirPath();
+
+            // Get the absolute path for the resumable upload sessions directory
+            // This will create the directory if it doesn't exist
+            static std::filesystem::path getUploadsDirPath();
+
+            // Get the absolute path for the deletion journal directory
+            // This will create the directory if it doesn't exist
+            static std::filesystem::path getDeletionsDirPath();
+
+            // Get the absolute path for the scrubber's directory, and the quarantine inside it
+            // These will create the directories if they don't exist
+            static std::filesystem::path getScrubDirPath();
+            static std::filesystem::path getQuarantineDirPath();
+
         private:
             // Helper to ensure directories exist
             static std::filesystem::path ensureDirectoryExists(const std::string &dir_name);
         };
 
-        // Initialize static members
-        // These are defined in the .cpp file, but declared here.
-        // For simple static const string members, they can be defined right here if preferred.
-        // Let's define them here for simplicity as they are compile-time constants.
-        const std::string ChunkConfig::CHUNKS_DIR_NAME = "chunks";
-        const std::string ChunkConfig::METADATA_DIR_NAME = "metadata";
-
     } // namespace Config
 } // namespace FileManager
\ No newline at end of file
@@ -0,0 +1,61 @@
+// include/chunk_filter.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+namespace FileManager
+{
+    namespace Chunks
+    {
+
+        // In-memory counting Bloom filter over the CIDs of stored chunks.
+        //
+        // mightContain() == false means the chunk is definitely not stored, so dedup checks and
+        // lookups of unknown CIDs can skip the filesystem entirely; true means "probably stored"
+        // and the caller checks the disk. Each slot is an 8-bit counter, so chunks can be removed
+        // again; a counter that saturates stays saturated (never causes a false negative).
+        //
+        // Slot positions come straight from the CID's SHA-256 digest, which is already uniformly
+        // distributed, so no extra hashing is needed. All operations are lock-free.
+        class ChunkFilter
+        {
+        public:
+            // Build the filter from the chunk files in `chunks_dir` (temp files are skipped).
+            // Sized for the larger of `expected_chunks` and twice the chunks already stored,
+            // at about 1% false positives.
+            ChunkFilter(const std::filesystem::path &chunks_dir, size_t expected_chunks);
+
+            ChunkFilter(const ChunkFilter &) = delete;
+            ChunkFilter &operator=(const ChunkFilter &) = delete;
+
+            // Record a chunk that was just stored.
+            void add(const std::string &chunk_cid);
+
+            // Forget a chunk whose file was just removed. Must pair with an earlier add().
+            void remove(const std::string &chunk_cid);
+
+            // False if the chunk is definitely not stored.
+            bool mightContain(const std::string &chunk_cid) const;
+
+            // Number of chunks currently recorded.
+            size_t size() const { return count.load(std::memory_order_relaxed); }
+
+        private:
+            static const size_t COUNTERS_PER_CHUNK = 10;
+            static const size_t HASHES = 7;
+
+            // Slot indexes of a CID (double hashing over two 64-bit words of its digest)
+            void slotsFor(const std::string &chunk_cid, size_t (&slots)[HASHES]) const;
+
+            std::vector<std::atomic<uint8_t>> counters;
+            std::atomic<size_t> count{0};
+            size_t capacity = 0;
+        };
+
+    } // namespace Chunks
+} // namespace FileManager
@@ -2,10 +2,14 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <unordered_map>
 #include <mutex>
 #include <memory> // For std::shared_ptr
 
+#include "cid_utility.hpp"
+
 namespace FileManager
 {
     namespace Chunks
@@ -15,13 +19,25 @@ namespace FileManager
         // For a production system, this state would typically be persisted
         // (e.g., to a database or a dedicated reference file) to survive service restarts.
         // For this project, we'll keep it in-memory as a starting point.
+        // Counts are keyed by binary CID.
         class ChunkReferenceManager
         {
         public:
+            // Net change in reference count per chunk. Entries are never zero.
+            using Deltas = std::unordered_map<CID::BinaryCID, int64_t, CID::BinaryCIDHash>;
+
+            // Chunks whose count crossed zero while applying deltas
+            struct DeltaResult
+            {
+                std::vector<std::string> referenced; // Went from 0 to positive: may need storing
+                std::vector<std::string> released;   // Went from positive to 0: may be deleted
+            };
+
             ChunkReferenceManager();
 
             // Increment the reference count for a given chunk CID.
-            void increment(const std::string &chunk_cid);
+            // Returns the new count. A count of 1 means nobody else referenced the chunk.
+            int increment(const std::string &chunk_cid);
 
             // Decrement the reference count for a given chunk CID.
             // Returns the new count. If 0, the chunk can be considered for deletion.
@@ -30,11 +46,25 @@ namespace FileManager
             // Get the current reference count for a given chunk CID.
             int getCount(const std::string &chunk_cid) const;
 
+            // The reference changes that turn a file made of `old_cids` into one made of
+            // `new_cids`, counting every occurrence (a chunk repeated in a file holds one
+            // reference per occurrence). Linear in the number of CIDs.
+            static Deltas diff(const std::vector<std::string> &old_cids, const std::vector<std::string> &new_cids);
+
+            // Split deltas into their increments and (negative) decrements.
+            static void split(const Deltas &deltas, Deltas &increments, Deltas &decrements);
+
+            // The same deltas with the opposite sign (to undo applyDeltas).
+            static Deltas negate(const Deltas &deltas);
+
+            // Apply all deltas as one transaction. Counts never go below zero.
+            DeltaResult applyDeltas(const Deltas &deltas);
+
         private:
             // Map to store chunk CID to its reference count
-            std::unordered_map<std::string, int> reference_counts;
+            std::unordered_map<CID::BinaryCID, int, CID::BinaryCIDHash> reference_counts;
             mutable std::mutex mtx; // Mutex for thread-safe access to reference_counts
         };
 
     } // namespace Chunks
-} // namespace FileManager
\ No newline at end of file
+} // namespace FileManager
@@ -3,18 +3,46 @@
 
 #include <string>
 #include <vector>
+#include <array>
+#include <cstdint>
+#include <cstring> // For std::memcpy
 
 namespace FileManager
 {
     namespace CID
     {
 
+        // A CID as its 32 raw digest bytes: half the size of the hex form, and compared and
+        // hashed without touching characters.
+        using BinaryCID = std::array<uint8_t, 32>;
+
+        // SHA-256 output is uniformly distributed, so its first word is already a good hash
+        struct BinaryCIDHash
+        {
+            size_t operator()(const BinaryCID &cid) const noexcept
+            {
+                size_t hash;
+                std::memcpy(&hash, cid.data(), sizeof(hash));
+                return hash;
+            }
+        };
+
         class CIDUtility
         {
         public:
             // Generates SHA-256 hash of data and returns as hex string.
             // This string will serve as the Content Identifier (CID).
             static std::string generateSHA256(const std::vector<char> &data_buffer);
+
+            // Checks that a string looks like a CID produced by generateSHA256
+            // (64 lowercase hex characters). Used to validate CIDs coming from clients
+            // before they are turned into paths inside the chunk store.
+            static bool isValidCID(const std::string &cid);
+
+            // Convert between the hex and binary forms of a CID.
+            // toBinary throws std::runtime_error if `cid` is not a valid CID.
+            static BinaryCID toBinary(const std::string &cid);
+            static std::string toHex(const BinaryCID &cid);
         };
 
     } // namespace CID
@@ -0,0 +1,77 @@
+// include/deletion_journal.hpp
+#pragma once
+
+#include <string>
+#include <cstdint> // For SIZE_MAX
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <filesystem>
+
+#include "chunk_config.hpp" // For directory paths and durability
+#include "zero_copy.hpp"    // For ScopedFd
+
+namespace FileManager {
+namespace Metadata {
+
+// Persistent queue of deleted files whose chunk references are still to be released, so
+// DELETE only has to drop the metadata. Kept in deletions/:
+//
+//   <first sequence>.log   segments of records, one JSON object per line, appended in order
+//   applied.json           sequence number of the last record whose references were released
+//
+// A new segment is started once the current one reaches config.deletion_segment_bytes, and a
+// segment is removed once all its records are applied. Records are written (and synced, unless
+// durability is None) before the metadata they describe is removed. A line torn by a crash is
+// skipped when the journal is reopened; appends always go to a fresh segment after that.
+class DeletionJournal {
+public:
+    struct Record {
+        uint64_t sequence = 0;               // Assigned by append()
+        std::string filename;
+        uint64_t version = 0;                // Current version when deleted
+        std::string created_at;              // Of that version
+        std::vector<std::string> chunk_cids; // Of all its versions: one reference per entry
+    };
+
+    explicit DeletionJournal(const Config::ChunkConfig& config);
+
+    DeletionJournal(const DeletionJournal&) = delete;
+    DeletionJournal& operator=(const DeletionJournal&) = delete;
+
+    // Append a record durably. Returns its sequence number.
+    uint64_t append(Record record);
+
+    // Records not applied yet, oldest first: as many as fit in `max_references` chunk
+    // references, but at least one if any are pending
+    std::vector<Record> pending(size_t max_references = SIZE_MAX) const;
+    size_t pendingCount() const;
+
+    // Record that the references of every record up to `sequence` have been released
+    void markApplied(uint64_t sequence);
+
+    // Mark every record applied (e.g. once reference counts were rebuilt from the metadata)
+    void clear();
+
+private:
+    void load();
+    void startSegment(uint64_t first_sequence);
+    void saveApplied();
+    void removeAppliedSegments();
+
+    std::filesystem::path dir;
+    size_t segment_bytes;
+    bool sync;
+
+    mutable std::mutex mtx;
+    std::deque<Record> records;                   // Pending, oldest first
+    std::map<uint64_t, std::filesystem::path> segments; // First sequence -> file
+    IO::ScopedFd segment_fd;                      // Segment being appended to, if any
+    uint64_t segment_size = 0;
+    uint64_t next_sequence = 1;
+    uint64_t applied = 0;
+};
+
+} // namespace Metadata
+} // namespace FileManager
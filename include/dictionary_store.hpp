@@ -0,0 +1,95 @@
+// include/dictionary_store.hpp
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <shared_mutex>
+#include <filesystem>
+#include <unordered_map>
+
+#include <zstd.h>
+
+#include "chunk_config.hpp"
+
+namespace FileManager
+{
+    namespace Chunks
+    {
+
+        // A trained zstd dictionary, digested once for compression and once for decompression
+        // so per-chunk calls don't pay for loading it.
+        class ZstdDictionary
+        {
+        public:
+            ZstdDictionary(uint32_t id, std::string content_type, std::vector<char> bytes, int compression_level);
+            ~ZstdDictionary();
+
+            ZstdDictionary(const ZstdDictionary &) = delete;
+            ZstdDictionary &operator=(const ZstdDictionary &) = delete;
+
+            const uint32_t id;                // zstd dictionary id, also recorded in every frame using it
+            const std::string content_type;   // Content type it was trained for
+            const std::vector<char> bytes;    // Dictionary contents as stored on disk
+
+            const ZSTD_CDict *compressionDict() const { return cdict; }
+            const ZSTD_DDict *decompressionDict() const { return ddict; }
+
+        private:
+            ZSTD_CDict *cdict = nullptr;
+            ZSTD_DDict *ddict = nullptr;
+        };
+
+        // Versioned zstd dictionaries, one series per content type, kept in the dictionaries/
+        // directory next to the chunks:
+        //
+        //   dictionaries/<id>.zdict   dictionary contents
+        //   dictionaries/index.json   {"content_types": {"<type>": [<id>, ...]}}, oldest first
+        //
+        // New chunks are compressed with the newest version for their file's content type.
+        // Older versions are never removed: a chunk's zstd frame records the id of the
+        // dictionary it was compressed with, and that dictionary is needed to read it back.
+        class DictionaryStore
+        {
+        public:
+            struct Info
+            {
+                uint32_t id = 0;
+                std::string content_type;
+                size_t version = 0; // 1 for the first dictionary trained for the content type
+                size_t size = 0;    // Bytes
+            };
+
+            // Load every stored dictionary. Throws std::runtime_error if the index is corrupt.
+            explicit DictionaryStore(const Config::ChunkConfig &config);
+
+            // Newest dictionary for `content_type`, or nullptr if none has been trained.
+            std::shared_ptr<const ZstdDictionary> latest(const std::string &content_type) const;
+
+            // Dictionary with the given id, or nullptr if it isn't stored.
+            std::shared_ptr<const ZstdDictionary> find(uint32_t id) const;
+
+            // Train a new dictionary version for `content_type` from sample data, store it
+            // durably and make it the one new chunks of that type are compressed with.
+            // Throws std::runtime_error if there is too little sample data to train on.
+            Info train(const std::string &content_type, const std::vector<std::vector<char>> &samples);
+
+            std::vector<Info> list() const;
+
+        private:
+            Info infoFor(const ZstdDictionary &dictionary) const; // Caller holds `mutex`
+            void saveIndex() const;                              // Caller holds `mutex`
+
+            std::filesystem::path dir;
+            int compression_level;
+            size_t max_dictionary_size;
+
+            mutable std::shared_mutex mutex;
+            std::unordered_map<uint32_t, std::shared_ptr<const ZstdDictionary>> by_id;
+            std::map<std::string, std::vector<uint32_t>> versions; // Content type -> ids, oldest first
+        };
+
+    } // namespace Chunks
+} // namespace FileManager
@@ -0,0 +1,37 @@
+// include/file_lock_manager.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+#include <shared_mutex>
+#include <mutex> // For std::unique_lock
+
+namespace FileManager
+{
+    namespace Concurrency
+    {
+
+        // Reader/writer locks per file name. Names hash onto a fixed set of stripes, so the
+        // table never grows and needs no cleanup; two names only contend when they share a
+        // stripe, which is rare with enough stripes.
+        //
+        // Hold at most one name's lock at a time: two names on the same stripe would deadlock.
+        class FileLockManager
+        {
+        public:
+            explicit FileLockManager(size_t num_stripes);
+
+            // For operations that only read a file: any number may hold it at once
+            std::shared_lock<std::shared_mutex> lockShared(const std::string &name);
+
+            // For operations that replace or remove a file: excludes all others on the name
+            std::unique_lock<std::shared_mutex> lockExclusive(const std::string &name);
+
+        private:
+            std::shared_mutex &stripeFor(const std::string &name);
+
+            std::vector<std::shared_mutex> stripes;
+        };
+
+    } // namespace Concurrency
+} // namespace FileManager
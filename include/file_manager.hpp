@@ -5,13 +5,33 @@
 #include <vector>
 #include <filesystem>
 #include <stdexcept> // For std::runtime_error
+#include <memory>    // For std::unique_ptr
+#include <mutex>
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
+#include <optional>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
 
 #include "chunk_config.hpp"
 #include "cid_utility.hpp"
+#include "merkle_tree.hpp"
 #include "chunk.hpp"
 #include "file_metadata.hpp"
+#include "upload_session.hpp"
+#include "deletion_journal.hpp"
+#include "scrub_progress.hpp"
 #include "chunk_reference_manager.hpp"
+#include "dictionary_store.hpp"
+#include "chunk_filter.hpp"
 #include "thread_pool.hpp"
+#include "file_lock_manager.hpp"
+#include "rate_limiter.hpp"
+#include "zero_copy.hpp"
+#include "io_engine.hpp"
+#include "group_commit.hpp"
 
 namespace FileManager
 {
@@ -20,7 +40,10 @@ namespace FileManager
     {
     public:
         // Constructor
-        FileManager(size_t num_threads);
+        FileManager(size_t num_threads, Config::ChunkConfig config = Config::ChunkConfig());
+
+        // Stops background garbage collection, compaction, scrubbing and deletion processing
+        ~FileManager();
 
         // --- API Endpoints/Functionalities as per PRD ---
 
@@ -30,16 +53,83 @@ namespace FileManager
                                           const std::string &original_filename,
                                           const std::string &content_type);
 
-        // Corresponds to GET /files/{filename}
-        // Retrieves a file by reassembling its chunks.
-        bool retrieveFile(const std::string &original_filename, const std::string &output_filepath);
+        // Corresponds to GET /files/{filename}[?version=N]
+        // Retrieves a file (the current version, or a past one still retained) by reassembling
+        // its chunks.
+        bool retrieveFile(const std::string &original_filename, const std::string &output_filepath,
+                          std::optional<uint64_t> version = std::nullopt);
+
+        // Corresponds to GET /files/{filename}/versions
+        // Metadata of every retained version of a file, oldest first; the last one is current.
+        // Throws if the file is not found.
+        std::vector<Metadata::FileMetadata> listFileVersions(const std::string &original_filename);
+
+        // Metadata of the current version of a file, or of a past one still retained.
+        // Throws if it is not found.
+        Metadata::FileMetadata getFileMetadata(const std::string &original_filename,
+                                               std::optional<uint64_t> version = std::nullopt);
+
+        // Where two files (or versions) differ
+        struct FileDiff
+        {
+            struct Range
+            {
+                size_t first_chunk = 0; // Chunks [first_chunk, end_chunk)
+                size_t end_chunk = 0;
+                uint64_t offset = 0;    // The bytes they hold, in the larger file
+                uint64_t length = 0;
+            };
+            std::string merkle_root;
+            std::string other_merkle_root;
+            bool identical = false;
+            std::vector<Range> ranges;
+        };
+
+        // Corresponds to GET /files/{filename}/diff?against={other}
+        // Compares two files, or two versions of one, through their Merkle trees: equal roots
+        // answer at once, otherwise only subtrees that differ are walked. Byte ranges are found
+        // from the headers of the larger file's chunks; no chunk data is read.
+        // Throws if either is not found.
+        FileDiff diffFiles(const std::string &original_filename, std::optional<uint64_t> version,
+                           const std::string &other_filename, std::optional<uint64_t> other_version);
+
+        // Proof that a chunk belongs to a file, for verified range reads: a client fetches chunk
+        // `index` by its CID, checks it hashes to the CID, and checks the CID against the file's
+        // Merkle root (its ETag) with CID::MerkleTree::verify.
+        struct ChunkProof
+        {
+            std::string chunk_cid;
+            size_t index = 0;
+            size_t chunk_count = 0;
+            std::string merkle_root;
+            std::vector<std::string> siblings; // Hex, lowest level first (see CID::MerkleTree::proof)
+        };
+
+        // Corresponds to GET /files/{filename}/proof?chunk={index}
+        // Throws if the file is not found or `index` is out of range.
+        ChunkProof getChunkProof(const std::string &original_filename, size_t index,
+                                 std::optional<uint64_t> version = std::nullopt);
 
         // Corresponds to GET /chunks/{hash}
         // Retrieves a specific chunk by its CID (hash).
         std::vector<char> retrieveChunk(const std::string &chunk_cid);
 
+        // Corresponds to GET /chunks/{hash} when serving straight from disk.
+        // Returns the on-disk path of a chunk so the HTTP layer can stream it from the
+        // page cache instead of copying it through memory. Throws if the CID is malformed
+        // or the chunk is not found; unknown CIDs are rejected by the chunk filter without
+        // touching the disk (so are quarantined ones, which the error names).
+        std::filesystem::path getChunkFilePath(const std::string &chunk_cid);
+
+        // Like getChunkFilePath(), but returns nullopt when the chunk is stored compressed and
+        // its file can't be served as is (use retrieveChunk() then).
+        std::optional<std::filesystem::path> getRawChunkPath(const std::string &chunk_cid);
+
         // Corresponds to DELETE /files/{filename}
-        // Deletes a file and its associated chunks if no other files reference them.
+        // Deletes a file with all its versions. This only records the deletion in the deletion
+        // journal and removes the metadata; the chunk references are released in the background
+        // and chunks no other file uses are reclaimed by the next garbage collection (see
+        // collectGarbage).
         bool deleteFile(const std::string &original_filename);
 
         // Corresponds to PUT /files/{filename}
@@ -48,18 +138,346 @@ namespace FileManager
                                           const std::string &updated_filepath,
                                           const std::string &new_content_type);
 
+        // Corresponds to PATCH /files/{filename}
+        // Overwrites `data.size()` bytes at `offset` (appends when `offset` is nullopt), growing
+        // the file if the patch runs past its end. Only the chunks the patch touches are read,
+        // re-chunked and re-hashed; every other chunk keeps its CID, so the cost is proportional
+        // to the patch, not the file (plus reading the header of each chunk before it, whose sizes
+        // locate the patch). Throws if `offset` is past the end of the file.
+        Metadata::FileMetadata patchFile(const std::string &original_filename,
+                                         std::optional<uint64_t> offset,
+                                         const std::vector<char> &data);
+
+        // Corresponds to POST /files/{filename}/copy?to={new}
+        // Creates (or replaces) `destination_filename` with the current content of
+        // `original_filename` by referencing the same chunks; no chunk data is read or written.
+        // Throws if the source is not found or the destination name is invalid.
+        Metadata::FileMetadata copyFile(const std::string &original_filename, const std::string &destination_filename);
+
+        // Corresponds to POST /chunks/missing
+        // Returns the CIDs from `chunk_cids` that are not stored, in the order given, so clients
+        // only upload chunks the server doesn't have. Throws on a malformed CID.
+        std::vector<std::string> findMissingChunks(const std::vector<std::string> &chunk_cids);
+
+        // Corresponds to PUT /chunks/{hash}
+        // Stores a chunk uploaded on its own, after checking that `data` hashes to `chunk_cid`.
+        // The chunk isn't referenced by any file until a manifest naming it is committed; until
+        // then only the garbage collection grace period keeps it.
+        // Returns true if it was written, false if it was already stored. Throws on a malformed
+        // CID, a hash mismatch or a chunk larger than CHUNK_SIZE.
+        bool putChunk(const std::string &chunk_cid, std::vector<char> data, const std::string &content_type = "");
+
+        // Corresponds to POST /files/{filename}/commit
+        // Creates (or replaces) a file from an ordered list of already stored chunks, taking a
+        // reference on each. Throws if any chunk is missing; nothing is changed then.
+        Metadata::FileMetadata commitManifest(const std::string &original_filename,
+                                              const std::string &content_type,
+                                              const std::vector<std::string> &chunk_cids);
+
+        // --- Resumable uploads ---
+        // Data is appended in order in any number of parts; full chunks are stored as they
+        // complete, so memory use is bounded by the part size and a dropped connection only
+        // loses the part in flight. Sessions survive restarts.
+
+        // Corresponds to POST /uploads
+        Metadata::UploadSession createUploadSession(const std::string &original_filename,
+                                                    const std::string &content_type);
+
+        // Corresponds to GET /uploads/{id}
+        // Throws if the session is not found.
+        Metadata::UploadSession getUploadSession(const std::string &session_id);
+
+        // Corresponds to PATCH /uploads/{id}
+        // Appends `data`, which starts at byte `offset` of the file. Bytes before the session's
+        // received_bytes are ignored, so retried parts are harmless. Throws if `offset` is past
+        // received_bytes (a part is missing). Returns the updated session.
+        Metadata::UploadSession appendToUploadSession(const std::string &session_id, uint64_t offset,
+                                                      const std::vector<char> &data);
+
+        // Corresponds to POST /uploads/{id}/finalize
+        // Stores the remaining data and creates (or replaces) the file; the session is removed.
+        Metadata::FileMetadata finalizeUploadSession(const std::string &session_id);
+
+        // Corresponds to DELETE /uploads/{id}
+        // Discards the session and releases its chunks.
+        bool abortUploadSession(const std::string &session_id);
+
+        // Corresponds to POST /dictionaries
+        // Trains a new zstd dictionary version for `content_type` from a sample of the chunks
+        // of files already stored with that type. New chunks of that type are compressed with
+        // it when compression is Zstd. Throws if there is too little data to train on.
+        Chunks::DictionaryStore::Info trainDictionary(const std::string &content_type);
+
+        // Corresponds to GET /dictionaries
+        std::vector<Chunks::DictionaryStore::Info> listDictionaries() const;
+
+        // Outcome of a garbage collection run
+        struct GarbageCollectionStats
+        {
+            size_t live_chunks = 0;        // Chunks used by a file version or an upload session
+            size_t stored_chunks = 0;      // Chunks found on disk
+            size_t deleted_chunks = 0;
+            uint64_t bytes_freed = 0;
+            size_t skipped_recent = 0;     // Unused, but within the grace period
+            size_t skipped_referenced = 0; // Unused, but referenced by an operation in progress
+            double seconds = 0;
+        };
+
+        // Corresponds to POST /gc (also run every config.gc_interval_s seconds in the background).
+        // Deleting files only drops chunk references; this is what removes the chunk files.
+        // Releases the references of journaled deletions first, so they count as unused. Then
+        // marks every chunk used by a current or past file version or an upload session, then
+        // deletes the other stored chunks in rate-limited batches on the thread pool, skipping
+        // chunks modified within the grace period or referenced by an operation in progress.
+        // Because it works from the metadata on disk, it also reclaims chunks orphaned by
+        // crashes. One run at a time. Throws (before deleting anything) if some metadata can't
+        // be read.
+        GarbageCollectionStats collectGarbage();
+
+        // Outcome of a compaction run
+        struct CompactionStats
+        {
+            size_t stored_chunks = 0;    // Chunks found on disk
+            size_t stale_chunks = 0;     // Stored with an outdated encoding, examined this run
+            size_t rewritten_chunks = 0;
+            uint64_t bytes_before = 0;   // Stored size of the rewritten chunks, before and after
+            uint64_t bytes_after = 0;
+            size_t skipped = 0;          // Stale, but saving too little, in use by a write, or unreadable
+            double seconds = 0;
+        };
+
+        // Corresponds to POST /compact (also run every config.compaction_interval_s seconds in the
+        // background). Chunks are stored one per file, so freed chunks leave no holes to reclaim
+        // (collectGarbage removes their files); what wastes space is live chunks stored with an
+        // encoding that is now outdated. With Zstd compression, this re-encodes chunks stored
+        // with LZ4 or with an older dictionary than the latest one for their file's content type,
+        // in rate-limited batches on the thread pool. Each chunk is checked against its CID,
+        // re-encoded and atomically renamed over its old file; readers see one file or the other,
+        // both decoding to the same bytes. Chunks stored raw are left as they are, since they are
+        // served straight from their files. Chunks examined in an earlier run whose file and
+        // target encoding haven't changed since are skipped. One run at a time.
+        CompactionStats compactChunks();
+
+        // Outcome of a scrub run
+        struct ScrubStats
+        {
+            size_t checked_chunks = 0;
+            uint64_t checked_bytes = 0; // Stored (possibly compressed) bytes read
+            size_t corrupt_chunks = 0;  // Quarantined
+            size_t skipped = 0;         // Deleted, or being written, when we got to them
+            bool resumed = false;       // Continued a pass interrupted earlier (e.g. by a restart)
+            bool pass_complete = false;
+            double seconds = 0;
+        };
+
+        // Corresponds to POST /scrub (also run every config.scrub_interval_s seconds in the
+        // background). Runs a verification pass over every stored chunk, or finishes the one in
+        // progress: chunks are read in CID order and re-hashed in rate-limited batches on the
+        // thread pool, and the position is saved after each batch so a pass interrupted by a
+        // restart resumes where it stopped. A chunk whose content doesn't hash to its CID (or
+        // can't be decoded) is moved to the quarantine, so it is reported as corrupt instead of
+        // being served; storing the same data again (an upload or PUT /chunks) repairs it.
+        // One run at a time.
+        ScrubStats scrubChunks();
+
+        // Corresponds to GET /scrub
+        struct ScrubStatus
+        {
+            bool running = false;
+            Metadata::ScrubProgress progress;     // Of the pass in progress, or the last one
+            std::vector<std::string> quarantined; // CIDs of quarantined chunk files
+        };
+        ScrubStatus getScrubStatus();
+
+        // Reads a file into chunks and generates their CIDs, without storing anything: the first
+        // stage of every upload (also measured on its own by file-chunker-bench).
+        std::vector<std::string> processFileIntoChunks(const std::string &filepath,
+                                                       std::vector<Chunks::Chunk> &out_chunks);
+
     private:
         Config::ChunkConfig config;
         CID::CIDUtility cid_utility; // Static class, but good to have
         Chunks::ChunkReferenceManager ref_manager;
+        Chunks::DictionaryStore dictionaries;
+        Chunks::ChunkFilter chunk_filter; // Which chunks are stored, without asking the filesystem
+
+        // Per-filename reader/writer locks: reads of a file share its lock, anything that replaces
+        // or removes its metadata takes it exclusively. Chunks are hashed and written before the
+        // lock is taken where the old version isn't needed, so writers hold it briefly.
+        Concurrency::FileLockManager file_locks;
+
+        // Deleted files whose chunk references haven't been released yet
+        Metadata::DeletionJournal deletion_journal;
+
+        // Background dictionary training (see config.dictionary_auto_train_uploads).
+        // Declared before thread_pool so they outlive training tasks still queued on it.
+        std::unordered_map<std::string, size_t> uploads_without_dictionary;
+        std::unordered_set<std::string> dictionaries_training;
+        std::mutex dictionary_mutex;
+
         Concurrency::ThreadPool thread_pool;
+        std::unique_ptr<IO::GroupCommitter> committer; // Declared before io_engine: engine callbacks commit
+        std::unique_ptr<IO::IoEngine> io_engine;       // Declared after thread_pool: may run on it
 
-        // Helper to read file into chunks and generate their CIDs
-        std::vector<std::string> processFileIntoChunks(const std::string &filepath,
-                                                       std::vector<Chunks::Chunk> &out_chunks);
+        // One lock per upload session, serializing its appends
+        std::unordered_map<std::string, std::shared_ptr<std::mutex>> upload_session_mutexes;
+        std::mutex upload_sessions_mutex;
+
+        // Chunk writes in progress, so concurrent uploads of the same chunk wait on one write
+        std::unordered_map<std::string, std::shared_future<bool>> pending_chunk_writes;
+        std::mutex pending_writes_mutex;
+
+        // Background work: garbage collection (one run at a time, deletions paced by gc_limiter)
+        // and releasing the references of deleted files (paced by deletion_limiter). Both
+        // threads are woken through background_wakeup, to stop or when a deletion is journaled.
+        std::mutex gc_mutex;
+        Concurrency::RateLimiter gc_limiter;
+        Concurrency::RateLimiter deletion_limiter;
+        std::atomic<bool> stopping{false};
+        std::mutex background_mutex;
+        std::condition_variable background_wakeup;
+        std::thread gc_thread;
+        std::thread deletion_thread;
+        std::mutex deletion_drain_mutex; // Each journaled deletion is released exactly once
+
+        // Background compaction (one run at a time, chunk reads paced by compaction_limiter).
+        // The checkpoint records when the last complete run started and the dictionary each
+        // content type's chunks were re-encoded with (0: none).
+        struct CompactionCheckpoint
+        {
+            std::filesystem::file_time_type started;
+            std::unordered_map<std::string, uint32_t> targets;
+        };
+        std::mutex compaction_mutex;
+        Concurrency::RateLimiter compaction_limiter;
+        std::optional<CompactionCheckpoint> compaction_checkpoint;
+        std::thread compaction_thread;
+
+        // Background scrubbing (one run at a time, chunk reads paced by scrub_limiter). The
+        // progress is kept here as well as on disk for getScrubStatus.
+        std::mutex scrub_mutex;
+        Concurrency::RateLimiter scrub_limiter;
+        Metadata::ScrubProgress scrub_progress;
+        bool scrub_running = false;
+        std::mutex scrub_status_mutex; // Guards scrub_progress and scrub_running
+        std::thread scrub_thread;
+
+        // Chunks in the quarantine that haven't been stored again, so lookups of missing chunks
+        // can say why without asking the filesystem. Loaded at startup, added to by
+        // quarantineChunk and cleared by the writes that repair them.
+        std::unordered_set<std::string> quarantined_chunks;
+        std::mutex quarantine_mutex;
+
+        // A chunk ready to be copied into a reassembled file: either an open file holding the raw
+        // bytes, or (for compressed chunks) the decompressed bytes
+        struct OpenChunk
+        {
+            IO::ScopedFd fd;
+            uint64_t size = 0;
+            bool decoded = false;
+            std::vector<char> data; // Set when `decoded`
+        };
+
+        // Helper to open a chunk for reassembly, optionally warming the page cache with its contents.
+        // Compressed chunks are read and decompressed here.
+        OpenChunk openChunk(const std::string &chunk_cid, bool prefetch);
+
+        // Helper to append a chunk to a reassembled file
+        void writeChunkTo(const IO::ScopedFd &out_fd, const OpenChunk &chunk);
+
+        // Helper to take references on chunks and persist the chunks that weren't stored yet.
+        // By default one reference is taken per occurrence in `chunks`; `references` overrides
+        // that (it may also name chunks that aren't in `chunks` if they are already stored).
+        // References are taken in one batch.
+        // Writes go through the I/O engine with at most `config.max_outstanding_writes` in
+        // flight; returns once every chunk the caller references is on disk (including ones
+        // another upload is still writing). On failure the references taken here are released
+        // again. Chunks are compressed with the dictionary for `content_type`, if there is one.
+        void storeChunks(const std::vector<Chunks::Chunk> &chunks, const std::string &content_type,
+                         const Chunks::ChunkReferenceManager::Deltas *references = nullptr);
+
+        // Helper to pick sample data for dictionary training: evenly spaced slices of the
+        // distinct chunks of all files of `content_type`, up to config.dictionary_sample_bytes.
+        std::vector<std::vector<char>> collectDictionarySamples(const std::string &content_type);
+
+        // Helper to count a stored file towards automatic dictionary training, and start
+        // training on the pool once its content type reaches the threshold.
+        void noteStoredFile(const std::string &content_type);
+
+        // Helper to save metadata that may replace an existing file, whose chunks the caller has
+        // already referenced. The old version joins the history; versions that fall out of it
+        // release their chunk references. Takes the file's lock and sets `metadata.version`.
+        void replaceMetadata(Metadata::FileMetadata &metadata);
+
+        // Helper to find the versions of a file that fall out of the history once `previous`
+        // (the current version, if there is one) becomes a past version.
+        std::vector<Metadata::FileMetadata> versionsToDrop(const std::optional<Metadata::FileMetadata> &previous);
+
+        // Helper to make `metadata` the current version of its file: `previous` is kept as a past
+        // version unless it is in `dropped`, and the `dropped` versions are removed. Sets
+        // `metadata.version` and `metadata.merkle_root`. Reference counts are left to the caller.
+        // Call with the file's exclusive lock held.
+        void commitVersion(Metadata::FileMetadata &metadata, const std::optional<Metadata::FileMetadata> &previous,
+                           const std::vector<Metadata::FileMetadata> &dropped);
+
+        // Helper to concatenate the chunk CIDs of several versions
+        static std::vector<std::string> versionCids(const std::vector<Metadata::FileMetadata> &versions);
+
+        // Helpers for upload sessions
+        std::shared_ptr<std::mutex> uploadSessionMutex(const std::string &session_id);
+        void forgetUploadSession(const std::string &session_id);
+        std::vector<char> readUploadTail(const Metadata::UploadSession &session);
+        void recoverUploadSessions();
+
+        // Helpers for deletions and reference counts. Counts live in memory only: at startup
+        // deletions interrupted by a crash are completed, then the counts are rebuilt from the
+        // metadata on disk, which makes every journaled deletion applied.
+        void replayDeletions();
+        void rebuildReferenceCounts();
+        void deletionLoop();
+        void drainDeletions();
+
+        // Helper to get the uncompressed size of a stored chunk from its file (and header)
+        uint64_t storedChunkSize(const std::string &chunk_cid);
+
+        // Helper to collect the CIDs of chunks, in order
+        static std::vector<std::string> chunkCids(const std::vector<Chunks::Chunk> &chunks);
+
+        // Helpers to release chunk references in one batch (`decrements` are negative, or one
+        // per occurrence in `chunk_cids`). Chunks nobody uses anymore are left for collectGarbage.
+        void releaseChunkReferences(const Chunks::ChunkReferenceManager::Deltas &decrements);
+        void releaseChunkReferences(const std::vector<std::string> &chunk_cids);
+
+        // Helpers for garbage collection
+        void garbageCollectionLoop();
+        std::unordered_set<CID::BinaryCID, CID::BinaryCIDHash> markLiveChunks();
+        GarbageCollectionStats sweepChunks(const std::vector<std::string> &chunk_cids, size_t begin, size_t end);
+
+        // Helper to delete the file of an unreferenced chunk
+        bool removeChunkFile(const std::string &chunk_cid);
+
+        // Helpers for compaction
+        struct StaleChunk
+        {
+            std::string cid;
+            std::string content_type; // Of a file using it; picks the dictionary to re-encode with
+            uint64_t stored_size = 0;
+        };
+        void compactionLoop();
+        std::unordered_map<CID::BinaryCID, std::string, CID::BinaryCIDHash> chunkContentTypes();
+        CompactionStats compactChunkBatch(const std::vector<StaleChunk> &chunks, size_t begin, size_t end);
+
+        // Helpers for scrubbing (chunks are CIDs with their stored sizes)
+        void scrubLoop();
+        void publishScrubProgress(const Metadata::ScrubProgress &progress, bool running);
+        ScrubStats scrubChunkBatch(const std::vector<std::pair<std::string, uint64_t>> &chunks, size_t begin, size_t end);
+
+        // Helper to move a corrupt chunk file to the quarantine. Call with the chunk claimed in
+        // pending_chunk_writes.
+        void quarantineChunk(const std::string &chunk_cid, const std::string &reason);
 
-        // Helper to delete a chunk file if its reference count reaches zero
-        bool deleteChunkFileIfUnreferenced(const std::string &chunk_cid);
+        // Helper to drop a chunk from quarantined_chunks once a write has stored it again
+        void forgetQuarantined(const std::string &chunk_cid);
     };
 
 } // namespace FileManager
\ No newline at end of file
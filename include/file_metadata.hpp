@@ -8,6 +8,7 @@
 
 #include <nlohmann/json.hpp> // For JSON handling
 #include "chunk_config.hpp"  // For directory paths
+#include "group_commit.hpp"  // For durable writes
 
 namespace FileManager {
 namespace Metadata {
@@ -19,6 +20,8 @@ public:
     std::string content_type;
     std::string created_at; // ISO 8601 format (e.g., "YYYY-MM-DDTHH:MM:SSZ")
     std::vector<std::string> chunk_cids; // Ordered list of chunk CIDs
+    uint64_t version = 1; // Starts at 1, +1 every time the file is replaced, updated or patched
+    std::string merkle_root; // Hex root of the Merkle tree over chunk_cids (see CID::MerkleTree); set when committed
 
     // Default constructor
     FileMetadata() = default;
@@ -46,14 +49,43 @@ public:
     // Create FileMetadata object from nlohmann::json object
     static FileMetadata fromJson(const nlohmann::json& j);
 
-    // Save metadata to a JSON file (filename.json)
-    bool save(const Config::ChunkConfig& config) const;
+    // Save metadata to a JSON file (filename.json).
+    // Written to a temp file and renamed over the old one, so readers never see a partial file.
+    // If `committer` is given the sync is batched with other writes; otherwise it's done inline.
+    bool save(const Config::ChunkConfig& config, IO::GroupCommitter* committer = nullptr) const;
 
     // Load metadata from a JSON file
     static FileMetadata load(const Config::ChunkConfig& config, const std::string& filename);
 
+    // Names of all files that have metadata stored (in no particular order)
+    static std::vector<std::string> listAll(const Config::ChunkConfig& config);
+
     // Get the full path where this metadata would be stored
     std::filesystem::path getFullPath(const Config::ChunkConfig& config) const;
+
+    // --- Past versions ---
+    // A past version is just its metadata, kept in versions/<filename>/<version>.json; its
+    // chunks stay referenced for as long as it is kept.
+
+    // Save this metadata as a past version of its file, atomically and durably
+    bool saveVersion(const Config::ChunkConfig& config, IO::GroupCommitter* committer = nullptr) const;
+
+    // Load a given version of a file, current or past. Throws if it is not found.
+    static FileMetadata loadVersion(const Config::ChunkConfig& config, const std::string& filename, uint64_t version);
+
+    // Names of all files that have past versions stored (in no particular order). This can
+    // include files that were just deleted.
+    static std::vector<std::string> listVersioned(const Config::ChunkConfig& config);
+
+    // Version numbers of the past versions of a file, oldest first
+    static std::vector<uint64_t> listVersions(const Config::ChunkConfig& config, const std::string& filename);
+
+    // Remove one past version of a file, or all of them
+    static void removeVersion(const Config::ChunkConfig& config, const std::string& filename, uint64_t version);
+    static void removeAllVersions(const Config::ChunkConfig& config, const std::string& filename);
+
+    // versions/<filename>
+    static std::filesystem::path getVersionsDir(const Config::ChunkConfig& config, const std::string& filename);
 };
 
 } // namespace Metadata
@@ -0,0 +1,97 @@
+// include/group_commit.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <filesystem>
+
+#include "chunk_config.hpp"
+
+namespace FileManager
+{
+    namespace IO
+    {
+
+        // Helpers for crash-safe "write to temp, sync, rename" file replacement.
+        class DurableFile
+        {
+        public:
+            // A unique temporary path next to `final_path` (same directory, so rename is atomic).
+            static std::filesystem::path tempPathFor(const std::filesystem::path &final_path);
+
+            // True for paths produced by tempPathFor().
+            static bool isTempFile(const std::filesystem::path &path);
+
+            // Flush a file's data to stable storage (fdatasync).
+            static void syncData(const std::filesystem::path &path);
+
+            // Same, for a file that is already open as `fd`.
+            static void syncData(int fd, const std::filesystem::path &path);
+
+            // Flush a directory so renames/creates inside it survive a crash. No-op where unsupported.
+            static void syncDirectory(const std::filesystem::path &dir);
+
+            // Write `data` to `final_path` atomically and durably, blocking until done.
+            static void writeAtomically(const std::filesystem::path &final_path, const char *data, size_t size);
+
+            // Remove temp files left in `dir` by a crash. Returns how many were removed.
+            static size_t removeStaleTempFiles(const std::filesystem::path &dir);
+        };
+
+        // Makes fully written temp files durable and renames them into place.
+        // In GroupCommit mode, commits arriving within a short window are batched so that one
+        // sync covers all of them (syncfs on Linux) followed by one directory sync per directory,
+        // instead of two syncs per file. Immediate mode syncs each file on its own, and None only
+        // renames (atomic but not crash-durable).
+        class GroupCommitter
+        {
+        public:
+            using Callback = std::function<void(std::exception_ptr error)>;
+
+            GroupCommitter(Config::ChunkConfig::Durability mode,
+                           std::chrono::microseconds window,
+                           size_t max_batch);
+            ~GroupCommitter();
+
+            GroupCommitter(const GroupCommitter &) = delete;
+            GroupCommitter &operator=(const GroupCommitter &) = delete;
+
+            // Commit `temp_path` as `final_path`. `done` runs on the committer thread (or inline in
+            // None mode) and must be short. On failure the temp file is removed.
+            void commit(std::filesystem::path temp_path, std::filesystem::path final_path, Callback done);
+
+            // Future-based wrapper around commit().
+            std::future<void> commit(std::filesystem::path temp_path, std::filesystem::path final_path);
+
+        private:
+            struct Entry
+            {
+                std::filesystem::path temp_path;
+                std::filesystem::path final_path;
+                Callback done;
+            };
+
+            void run();
+            void commitBatch(std::vector<Entry> &batch);
+            static void finish(Entry &entry, std::exception_ptr error);
+
+            Config::ChunkConfig::Durability mode;
+            std::chrono::microseconds window;
+            size_t max_batch;
+
+            std::mutex queue_mutex;
+            std::condition_variable condition;
+            std::deque<Entry> queue;
+            bool stopping = false;
+            std::thread worker;
+        };
+
+    } // namespace IO
+} // namespace FileManager
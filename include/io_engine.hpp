@@ -0,0 +1,70 @@
+// include/io_engine.hpp
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>     // For std::unique_ptr
+#include <future>     // For std::future
+#include <functional> // For std::function
+#include <exception>  // For std::exception_ptr
+#include <filesystem>
+
+#include "thread_pool.hpp"
+
+namespace FileManager
+{
+    namespace IO
+    {
+
+        // Asynchronous whole-file I/O used for chunk reads and writes.
+        // Requests are queued and completed in the background; completion callbacks run on an
+        // engine-owned thread (io_uring) or a pool worker (fallback), so they must be short and
+        // must not block on other I/O submitted to the same engine.
+        class IoEngine
+        {
+        public:
+            // `error` is null on success.
+            using ReadCallback = std::function<void(std::vector<char> data, std::exception_ptr error)>;
+            using WriteCallback = std::function<void(std::exception_ptr error)>;
+
+            virtual ~IoEngine() = default;
+
+            // Read the whole file at `path`.
+            virtual void submitRead(std::filesystem::path path, ReadCallback on_complete) = 0;
+
+            // Create/truncate `path` and write `size` bytes from `data` into it.
+            // `data` must stay valid until `on_complete` has been called.
+            virtual void submitWrite(std::filesystem::path path, const char *data, size_t size,
+                                     WriteCallback on_complete) = 0;
+
+            // Short name of the backend, for logging ("io_uring" or "thread_pool").
+            virtual const char *name() const = 0;
+
+            // Future-based wrappers around submitRead/submitWrite.
+            std::future<std::vector<char>> read(std::filesystem::path path);
+            std::future<void> write(std::filesystem::path path, const char *data, size_t size);
+
+            // Create the best engine available: io_uring on Linux kernels that support it (unless
+            // `allow_io_uring` is false), otherwise an engine that runs blocking I/O on `fallback_pool`.
+            // `queue_depth` bounds the number of I/Os the io_uring engine keeps in flight.
+            static std::unique_ptr<IoEngine> create(Concurrency::ThreadPool &fallback_pool, unsigned queue_depth,
+                                                    bool allow_io_uring = true);
+        };
+
+        // Runs each request as a blocking read/write task on a ThreadPool.
+        class ThreadPoolIoEngine : public IoEngine
+        {
+        public:
+            explicit ThreadPoolIoEngine(Concurrency::ThreadPool &pool) : pool(pool) {}
+
+            void submitRead(std::filesystem::path path, ReadCallback on_complete) override;
+            void submitWrite(std::filesystem::path path, const char *data, size_t size,
+                             WriteCallback on_complete) override;
+            const char *name() const override { return "thread_pool"; }
+
+        private:
+            Concurrency::ThreadPool &pool;
+        };
+
+    } // namespace IO
+} // namespace FileManager
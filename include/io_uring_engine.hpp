@@ -0,0 +1,98 @@
+// include/io_uring_engine.hpp
+#pragma once
+
+#if defined(__linux__)
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+
+#include "io_engine.hpp"
+#include "zero_copy.hpp" // For ScopedFd
+
+namespace FileManager
+{
+    namespace IO
+    {
+
+        // IoEngine backed by a single io_uring instance, driven through the raw syscalls so no
+        // extra library is needed. One engine thread opens files, fills the submission queue in
+        // batches and reaps completions, keeping up to `queue_depth` chunk I/Os in flight.
+        // New requests wake the engine through an eventfd read that is always armed on the ring.
+        class IoUringEngine : public IoEngine
+        {
+        public:
+            // Throws std::runtime_error if io_uring is unavailable (old kernel, seccomp, ...).
+            explicit IoUringEngine(unsigned queue_depth);
+            ~IoUringEngine() override;
+
+            IoUringEngine(const IoUringEngine &) = delete;
+            IoUringEngine &operator=(const IoUringEngine &) = delete;
+
+            void submitRead(std::filesystem::path path, ReadCallback on_complete) override;
+            void submitWrite(std::filesystem::path path, const char *data, size_t size,
+                             WriteCallback on_complete) override;
+            const char *name() const override { return "io_uring"; }
+
+        private:
+            struct Request
+            {
+                bool is_write = false;
+                std::filesystem::path path;
+                ScopedFd fd;
+                std::vector<char> read_buffer; // Destination for reads
+                const char *write_data = nullptr;
+                size_t size = 0; // Total bytes to transfer
+                size_t done = 0; // Bytes transferred so far
+                ReadCallback on_read;
+                WriteCallback on_write;
+            };
+
+            void enqueue(std::unique_ptr<Request> request);
+            void run();                           // Engine thread main loop
+            void start(std::unique_ptr<Request> request);
+            void queueTransfer(Request *request); // Push an SQE for the remaining bytes
+            void handleCompletion(Request *request, int32_t result);
+            void finish(Request *request, std::exception_ptr error);
+            void armDoorbell();
+            void ringDoorbell();
+            io_uring_sqe *nextSqe();
+            unsigned reapCompletions();
+
+            unsigned queue_depth;
+            size_t in_flight = 0;
+
+            int ring_fd = -1;
+            ScopedFd doorbell_fd;
+            uint64_t doorbell_value = 0;
+
+            // Memory shared with the kernel
+            void *sq_ring_ptr = nullptr;
+            size_t sq_ring_size = 0;
+            void *cq_ring_ptr = nullptr;
+            size_t cq_ring_size = 0;
+            io_uring_sqe *sqes = nullptr;
+            size_t sqes_size = 0;
+            unsigned *sq_head = nullptr;
+            unsigned *sq_tail = nullptr;
+            unsigned *sq_mask = nullptr;
+            unsigned *sq_array = nullptr;
+            unsigned *cq_head = nullptr;
+            unsigned *cq_tail = nullptr;
+            unsigned *cq_mask = nullptr;
+            io_uring_cqe *cqes = nullptr;
+
+            std::mutex pending_mutex;
+            std::deque<std::unique_ptr<Request>> pending;
+            bool stopping = false;
+            std::thread worker;
+        };
+
+    } // namespace IO
+} // namespace FileManager
+
+#endif // defined(__linux__)
@@ -0,0 +1,151 @@
+// include/logger.hpp
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace FileManager
+{
+    namespace Logging
+    {
+
+        enum class Level
+        {
+            Debug,
+            Info,
+            Warn,
+            Error,
+        };
+
+        // One structured field of a log record, e.g. {"filename", name} or {"latency_ms", 12.5}.
+        // Keys must be string literals (they are kept as pointers until the record is written).
+        class Field
+        {
+        public:
+            Field(const char *key, std::string value) : key(key), value(std::move(value)), quoted(true) {}
+            Field(const char *key, const char *value) : Field(key, std::string(value)) {}
+            Field(const char *key, bool value) : key(key), value(value ? "true" : "false"), quoted(false) {}
+            Field(const char *key, double value);
+            template <typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+            Field(const char *key, T value) : key(key), value(std::to_string(value)), quoted(false)
+            {
+            }
+
+            const char *key;
+            std::string value;
+            bool quoted; // Strings are quoted; numbers and booleans are written as is
+        };
+
+        // Lets one in every `every` calls through, for log lines on hot paths. Lock-free.
+        class Sampler
+        {
+        public:
+            explicit Sampler(uint64_t every) : every(every == 0 ? 1 : every) {}
+
+            bool sample() { return calls.fetch_add(1, std::memory_order_relaxed) % every == 0; }
+            uint64_t rate() const { return every; }
+
+        private:
+            const uint64_t every;
+            std::atomic<uint64_t> calls{0};
+        };
+
+        // Process-wide asynchronous logger writing one record per line, as JSON objects or text.
+        //
+        // Logging never blocks on I/O: each thread appends records to its own lock-free ring buffer
+        // and a background thread drains them all, orders them by time and writes them (Warn and
+        // Error to stderr, the rest to stdout). When a thread's ring is full its records are
+        // dropped and counted (fm_log_records_dropped_total) rather than waited for. Errors wake
+        // the writer at once; everything else is written within FLUSH_INTERVAL.
+        //
+        // Configured from the environment on first use:
+        //   FM_LOG_LEVEL (debug|info|warn|error, default info), FM_LOG_FORMAT (json|text, default json)
+        class Logger
+        {
+        public:
+            static Logger &global();
+
+            ~Logger();
+            Logger(const Logger &) = delete;
+            Logger &operator=(const Logger &) = delete;
+
+            bool enabled(Level level) const { return level >= min_level.load(std::memory_order_relaxed); }
+            void setLevel(Level level) { min_level.store(level, std::memory_order_relaxed); }
+
+            void log(Level level, std::string message, std::vector<Field> fields);
+
+            // Write everything logged so far before returning.
+            void flush();
+
+            static constexpr std::chrono::milliseconds FLUSH_INTERVAL{50};
+
+        private:
+            struct Record;
+            struct Ring;
+
+            Logger();
+
+            // The calling thread's ring, registered on first use
+            Ring &ringForThread();
+
+            void writerLoop();
+            void drain();
+
+            std::atomic<Level> min_level{Level::Info};
+            bool json = true;
+
+            std::mutex rings_mutex;
+            std::vector<std::shared_ptr<Ring>> rings;
+            uint64_t next_thread_number = 1;
+
+            std::mutex drain_mutex; // One drain at a time: rings have a single consumer
+            std::atomic<uint64_t> dropped{0};
+
+            std::mutex writer_mutex;
+            std::condition_variable writer_wakeup;
+            std::atomic<bool> urgent{false};
+            bool stopping = false;
+            std::thread writer;
+        };
+
+        inline void debug(std::string message, std::vector<Field> fields = {})
+        {
+            Logger::global().log(Level::Debug, std::move(message), std::move(fields));
+        }
+
+        inline void info(std::string message, std::vector<Field> fields = {})
+        {
+            Logger::global().log(Level::Info, std::move(message), std::move(fields));
+        }
+
+        inline void warn(std::string message, std::vector<Field> fields = {})
+        {
+            Logger::global().log(Level::Warn, std::move(message), std::move(fields));
+        }
+
+        inline void error(std::string message, std::vector<Field> fields = {})
+        {
+            Logger::global().log(Level::Error, std::move(message), std::move(fields));
+        }
+
+        // Log one in every `sampler.rate()` calls, with the rate added as field "sample_rate"
+        inline void info(Sampler &sampler, std::string message, std::vector<Field> fields = {})
+        {
+            Logger &logger = Logger::global();
+            if (logger.enabled(Level::Info) && sampler.sample())
+            {
+                fields.emplace_back("sample_rate", sampler.rate());
+                logger.log(Level::Info, std::move(message), std::move(fields));
+            }
+        }
+
+    } // namespace Logging
+} // namespace FileManager
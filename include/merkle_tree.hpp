@@ -0,0 +1,60 @@
+// include/merkle_tree.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility> // For std::pair
+#include <cstddef>
+
+#include "cid_utility.hpp"
+
+namespace FileManager
+{
+    namespace CID
+    {
+
+        // Merkle tree over the ordered chunk CIDs of a file, so whole files and versions can be
+        // compared, and single chunks checked against a file, without walking every CID.
+        //
+        // Leaves are SHA-256(0x00 || CID) and interior nodes SHA-256(0x01 || left || right), over
+        // binary CIDs, so a leaf can never pass for an interior node. A node without a sibling
+        // is carried up to the next level unchanged. Node i of level l therefore covers chunks
+        // [i * 2^l, (i + 1) * 2^l) in every tree, whatever its size, which lets diff() line up
+        // trees of different sizes. The root of an empty file is SHA-256(0x00).
+        class MerkleTree
+        {
+        public:
+            // Build the tree over hex CIDs. Throws std::runtime_error on a malformed CID.
+            explicit MerkleTree(const std::vector<std::string> &chunk_cids);
+
+            BinaryCID root() const;
+            size_t leafCount() const { return levels.front().size(); }
+
+            // Hex root of the tree over `chunk_cids`, without keeping the tree
+            static std::string rootOf(const std::vector<std::string> &chunk_cids);
+
+            // Sibling hashes on the path from chunk `index` to the root, lowest first; levels where
+            // the node has no sibling contribute nothing. Throws std::out_of_range if `index` is
+            // not below leafCount().
+            std::vector<BinaryCID> proof(size_t index) const;
+
+            // True if `proof` shows that `chunk_cid` is chunk `index` of a file of `leaf_count`
+            // chunks whose tree has root `root`
+            static bool verify(const std::string &chunk_cid, size_t index, size_t leaf_count,
+                               const std::vector<BinaryCID> &proof, const BinaryCID &root);
+
+            // Ranges [first, end) of chunk indexes at which `a` and `b` differ, in order, including
+            // chunks only one of them has. Subtrees with equal hashes are skipped whole, so this
+            // takes O(d log n) comparisons for d differing chunks instead of n.
+            static std::vector<std::pair<size_t, size_t>> diff(const MerkleTree &a, const MerkleTree &b);
+
+        private:
+            std::vector<std::vector<BinaryCID>> levels; // levels[0] are the leaves, levels.back() the root
+
+            const BinaryCID *node(size_t level, size_t index) const;
+            static BinaryCID hashLeaf(const BinaryCID &cid);
+            static BinaryCID hashPair(const BinaryCID &left, const BinaryCID &right);
+        };
+
+    } // namespace CID
+} // namespace FileManager
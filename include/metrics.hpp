@@ -0,0 +1,171 @@
+// include/metrics.hpp
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace FileManager
+{
+    namespace Metrics
+    {
+
+        // Updates are spread over this many cache-line-sized shards, picked per thread, so
+        // threads recording the same metric don't contend on one cache line. Reads sum them.
+        static const size_t SHARDS = 16;
+
+        // Shard of the calling thread (threads are assigned round-robin on first use)
+        size_t shardIndex();
+
+        // Label names and values of one series, e.g. {{"stage", "read"}}
+        using Labels = std::vector<std::pair<std::string, std::string>>;
+
+        // Monotonically increasing count. Lock-free.
+        class Counter
+        {
+        public:
+            void add(uint64_t n = 1)
+            {
+                shards[shardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+            }
+
+            uint64_t value() const;
+
+        private:
+            struct alignas(64) Shard
+            {
+                std::atomic<uint64_t> value{0};
+            };
+            std::array<Shard, SHARDS> shards;
+        };
+
+        // Value that goes up and down (e.g. a queue depth). Lock-free.
+        class Gauge
+        {
+        public:
+            void set(int64_t v) { current.store(v, std::memory_order_relaxed); }
+            void add(int64_t n) { current.fetch_add(n, std::memory_order_relaxed); }
+            int64_t value() const { return current.load(std::memory_order_relaxed); }
+
+        private:
+            std::atomic<int64_t> current{0};
+        };
+
+        // Distribution of durations over log2 buckets: bucket k counts observations of at most
+        // 2^k microseconds (1us to ~67s), plus one overflow bucket. Recording is two relaxed
+        // atomic adds on the calling thread's shard. Lock-free.
+        class Histogram
+        {
+        public:
+            static const size_t BUCKETS = 27;
+
+            void observe(std::chrono::nanoseconds elapsed);
+
+            // Upper bound of bucket `k`, in seconds
+            static double bucketBound(size_t k);
+
+            struct Snapshot
+            {
+                std::array<uint64_t, BUCKETS + 1> buckets{}; // Not cumulative; the last one is overflow
+                uint64_t count = 0;
+                double sum_seconds = 0;
+            };
+            Snapshot snapshot() const;
+
+        private:
+            struct alignas(64) Shard
+            {
+                std::array<std::atomic<uint64_t>, BUCKETS + 1> buckets{};
+                std::atomic<uint64_t> sum_ns{0};
+            };
+            std::array<Shard, SHARDS> shards;
+        };
+
+        // Observes the time from construction to destruction into a histogram.
+        class ScopedTimer
+        {
+        public:
+            explicit ScopedTimer(Histogram &histogram)
+                : histogram(histogram), started(std::chrono::steady_clock::now())
+            {
+            }
+            ~ScopedTimer() { histogram.observe(std::chrono::steady_clock::now() - started); }
+
+            // Time since construction so far, e.g. to log alongside the observation
+            double elapsedMilliseconds() const
+            {
+                return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+            }
+
+            ScopedTimer(const ScopedTimer &) = delete;
+            ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+        private:
+            Histogram &histogram;
+            std::chrono::steady_clock::time_point started;
+        };
+
+        // Process-wide set of named metrics, rendered in the Prometheus text exposition format.
+        //
+        // Registering takes a lock and returns the same metric for the same name and labels, so
+        // callers look metrics up once (e.g. into a static reference) and record without locking.
+        // Metrics live as long as the process. Throws std::runtime_error if a name is registered
+        // again with another type.
+        class Registry
+        {
+        public:
+            static Registry &global();
+
+            Counter &counter(const std::string &name, const std::string &help, const Labels &labels = {});
+            Gauge &gauge(const std::string &name, const std::string &help, const Labels &labels = {});
+            Histogram &histogram(const std::string &name, const std::string &help, const Labels &labels = {});
+
+            // All metrics, in registration order (text/plain; version=0.0.4)
+            std::string renderPrometheus() const;
+
+        private:
+            enum class Type
+            {
+                Counter,
+                Gauge,
+                Histogram,
+            };
+
+            struct Series
+            {
+                Labels labels;
+                std::unique_ptr<Counter> counter;
+                std::unique_ptr<Gauge> gauge;
+                std::unique_ptr<Histogram> histogram;
+            };
+
+            struct Family
+            {
+                std::string name;
+                std::string help;
+                Type type;
+                std::vector<std::unique_ptr<Series>> series;
+            };
+
+            // Find or create the series `labels` of family `name`
+            Series &series(const std::string &name, const std::string &help, Type type, const Labels &labels);
+
+            mutable std::mutex mtx;
+            std::vector<std::unique_ptr<Family>> families;
+            std::unordered_map<std::string, Family *> by_name;
+        };
+
+        // fm_stage_duration_seconds{stage="..."}: where upload and download time goes (read, hash,
+        // dedup_check, compress, chunk_write, metadata_save, refcount, chunk_read, chunk_copy)
+        Histogram &stageDuration(const std::string &stage);
+
+    } // namespace Metrics
+} // namespace FileManager
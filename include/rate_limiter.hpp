@@ -0,0 +1,35 @@
+// include/rate_limiter.hpp
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+namespace FileManager
+{
+    namespace Concurrency
+    {
+
+        // Token bucket limiting background work (e.g. chunk deletions) to a steady rate, so it
+        // doesn't compete with requests for disk bandwidth. Up to `burst` units may be used at
+        // once after an idle period. A rate of 0 means unlimited.
+        class RateLimiter
+        {
+        public:
+            RateLimiter(double units_per_second, double burst);
+
+            // Use `units`, blocking for as long as the bucket is in debt afterwards. Requests
+            // larger than `burst` are allowed; they just wait longer.
+            void acquire(double units);
+
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            const double rate;
+            const double capacity;
+            double available;
+            Clock::time_point last_refill;
+            std::mutex mtx;
+        };
+
+    } // namespace Concurrency
+} // namespace FileManager
@@ -0,0 +1,56 @@
+// include/scrub_progress.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include <nlohmann/json.hpp> // For JSON handling
+#include "chunk_config.hpp"  // For directory paths
+
+namespace FileManager {
+namespace Metadata {
+
+// Progress and results of the integrity scrubber (see FileManager::scrubChunks), persisted in
+// scrub/ so an interrupted pass resumes where it stopped after a restart:
+//
+//   progress.json   this object
+//   quarantine/     chunk files whose content no longer hashes to their CID, moved out of chunks/
+//
+// A pass verifies every stored chunk in CID order; `position` is the last CID verified, so a
+// resumed pass continues with the chunks after it. The counters describe the pass in progress,
+// or the last one once it is complete.
+class ScrubProgress {
+public:
+    bool in_progress = false;
+    std::string position;               // Last CID verified in the current pass
+    std::string pass_started_at;        // ISO 8601 format, like FileMetadata
+    uint64_t checked_chunks = 0;
+    uint64_t checked_bytes = 0;         // Stored (possibly compressed) bytes read
+    uint64_t corrupt_chunks = 0;        // Quarantined
+    uint64_t passes_completed = 0;
+    std::string last_pass_completed_at; // Empty until a pass completes
+
+    // Reset the counters and start a new pass from the first chunk
+    void startPass();
+
+    // Mark the current pass complete
+    void completePass();
+
+    nlohmann::json toJson() const;
+    static ScrubProgress fromJson(const nlohmann::json& j);
+
+    // Save progress.json atomically and durably
+    bool save(const Config::ChunkConfig& config) const;
+
+    // Load the saved progress, or a fresh one if there is none.
+    // Throws if progress.json can't be parsed.
+    static ScrubProgress load(const Config::ChunkConfig& config);
+
+    // CIDs of the chunks in quarantine, sorted
+    static std::vector<std::string> listQuarantined(const Config::ChunkConfig& config);
+};
+
+} // namespace Metadata
+} // namespace FileManager
@@ -9,6 +9,8 @@
 #include <future> // For std::future, std::packaged_task
 #include <functional> // For std::function
 #include <stdexcept> // For std::runtime_error
+#include <chrono>
+#include "metrics.hpp"
 
 namespace FileManager {
 namespace Concurrency {
@@ -34,6 +36,11 @@ private:
     std::mutex queue_mutex;
     std::condition_variable condition;
     bool stop_all; // Flag to signal threads to stop
+
+    // Shared by all pools: tasks waiting, workers running a task, and how long tasks wait
+    Metrics::Gauge& queue_depth;
+    Metrics::Gauge& busy_workers;
+    Metrics::Histogram& queue_wait;
 };
 
 // --- Template method implementation (usually in .hpp for templates) ---
@@ -62,7 +69,11 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
             throw std::runtime_error("enqueue on stopped ThreadPool");
 
         // Push the task into the queue as a void function
-        tasks.emplace([task]() { (*task)(); });
+        tasks.emplace([this, task, queued = std::chrono::steady_clock::now()]() {
+            queue_wait.observe(std::chrono::steady_clock::now() - queued);
+            (*task)();
+        });
+        queue_depth.add(1);
     }
     // Notify one waiting thread that a new task is available
     condition.notify_one();
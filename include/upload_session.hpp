@@ -0,0 +1,62 @@
+// include/upload_session.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include <nlohmann/json.hpp> // For JSON handling
+#include "chunk_config.hpp"  // For directory paths
+
+namespace FileManager {
+namespace Metadata {
+
+// State of a resumable upload, persisted in uploads/<id>/ so it survives restarts:
+//
+//   session.json   this object
+//   <n>.tail       bytes received after the n complete chunks, not yet a full chunk
+//
+// Data must arrive in order. Every full chunk is stored (and referenced) as soon as it
+// is complete, so only the tail is kept outside the chunk store. The tail file is named after
+// the chunk count and only grows while the count stays the same, so after a crash between
+// writing a tail and writing session.json the tail named in session.json is still valid
+// (its first `tail_size` bytes).
+class UploadSession {
+public:
+    std::string id;                      // 32 hex characters
+    std::string original_filename;
+    std::string content_type;
+    std::string created_at;              // ISO 8601 format, like FileMetadata
+    uint64_t received_bytes = 0;         // All bytes before this offset have been received
+    uint64_t tail_size = 0;              // Bytes of received data not yet in a chunk
+    std::vector<std::string> chunk_cids; // Complete chunks so far, in order
+
+    UploadSession() = default;
+
+    // Start a new session with a fresh random id
+    UploadSession(std::string filename, std::string type);
+
+    nlohmann::json toJson() const;
+    static UploadSession fromJson(const nlohmann::json& j);
+
+    // Save session.json atomically and durably
+    bool save(const Config::ChunkConfig& config) const;
+
+    // Load a session by id. Throws if the id is malformed or the session is not found.
+    static UploadSession load(const Config::ChunkConfig& config, const std::string& id);
+
+    // Ids of all sessions on disk
+    static std::vector<std::string> listAll(const Config::ChunkConfig& config);
+
+    // Checks that `id` looks like a session id, so it can be used in a path
+    static bool isValidId(const std::string& id);
+
+    // uploads/<id>
+    std::filesystem::path getDir(const Config::ChunkConfig& config) const;
+
+    // uploads/<id>/<n>.tail for the current chunk count
+    std::filesystem::path getTailPath(const Config::ChunkConfig& config) const;
+};
+
+} // namespace Metadata
+} // namespace FileManager
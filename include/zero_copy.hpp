@@ -0,0 +1,67 @@
+// include/zero_copy.hpp
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <filesystem>
+
+namespace FileManager
+{
+    namespace IO
+    {
+
+        // Owns a POSIX file descriptor and closes it when going out of scope.
+        class ScopedFd
+        {
+        public:
+            ScopedFd() = default;
+            explicit ScopedFd(int fd) : fd_(fd) {}
+            ~ScopedFd();
+
+            ScopedFd(const ScopedFd &) = delete;
+            ScopedFd &operator=(const ScopedFd &) = delete;
+            ScopedFd(ScopedFd &&other) noexcept : fd_(other.release()) {}
+            ScopedFd &operator=(ScopedFd &&other) noexcept;
+
+            int get() const { return fd_; }
+            bool valid() const { return fd_ >= 0; }
+
+            // Give up ownership without closing the descriptor.
+            int release();
+
+            // Write the whole buffer at the current file position. Throws std::runtime_error on failure.
+            void writeAll(const char *data, size_t size) const;
+
+            // Open a file for reading. Throws std::runtime_error on failure.
+            static ScopedFd openForRead(const std::filesystem::path &path);
+
+            // Create (or truncate) a file for writing. Throws std::runtime_error on failure.
+            static ScopedFd openForWrite(const std::filesystem::path &path);
+
+            // Open (or create) a file for appending. Throws std::runtime_error on failure.
+            static ScopedFd openForAppend(const std::filesystem::path &path);
+
+        private:
+            int fd_ = -1;
+        };
+
+        class ZeroCopy
+        {
+        public:
+            // Copy `length` bytes starting at `offset` of `in_fd` to the current position of `out_fd`.
+            // On Linux this uses sendfile(2), so the bytes move from page cache to the destination
+            // (a regular file or a socket) without passing through user space. If the kernel or
+            // the descriptor types don't support it, falls back to a buffered read/write loop.
+            // Throws std::runtime_error on I/O failure or premature end of file.
+            static void transfer(int out_fd, int in_fd, uint64_t offset, uint64_t length);
+
+            // Start pulling a byte range of `fd` into the page cache so a later transfer() finds
+            // it there. Blocks until the read-ahead has been issued; best effort, never throws.
+            static void prefetch(int fd, uint64_t offset, uint64_t length);
+
+        private:
+            static void bufferedTransfer(int out_fd, int in_fd, uint64_t offset, uint64_t length);
+        };
+
+    } // namespace IO
+} // namespace FileManager
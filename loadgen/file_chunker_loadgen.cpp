@@ -0,0 +1,946 @@
+// loadgen/file_chunker_loadgen.cpp
+// End-to-end load generator for file-manager-service (target file-chunker-loadgen, built with
+// -DFM_BUILD_LOADGEN=ON). Drives a running server over many keep-alive HTTP/1.1 connections with
+// a weighted mix of uploads, downloads, updates, deletions and chunk reads, then reports
+// throughput and latency percentiles per route.
+//
+// Each connection is a closed loop (one request in flight), so offered load is set by the number
+// of connections. Latency is measured from the first byte sent to the last byte received.
+//
+//   file-chunker-loadgen --connections=64 --duration=60 --mix=post:10,get:50,chunk:40
+//   file-chunker-loadgen --sizes=64K:50,1M:30,16M:20 --dedup=0.5 --format=json
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "chunk_config.hpp"
+
+using Clock = std::chrono::steady_clock;
+using FileManager::Config::ChunkConfig;
+
+namespace
+{
+    enum Route
+    {
+        POST_FILE,
+        GET_FILE,
+        PUT_FILE,
+        DELETE_FILE,
+        GET_CHUNK,
+        ROUTE_COUNT,
+    };
+
+    const char *const ROUTE_KEYS[ROUTE_COUNT] = {"post", "get", "put", "delete", "chunk"};
+    const char *const ROUTE_NAMES[ROUTE_COUNT] = {"POST /files", "GET /files/<name>", "PUT /files/<name>",
+                                                  "DELETE /files/<name>", "GET /chunks/<cid>"};
+
+    template <typename T>
+    struct Weighted
+    {
+        T value;
+        double weight;
+    };
+
+    struct Options
+    {
+        std::string host = "127.0.0.1";
+        std::string port = "8080";
+        size_t connections = 32;
+        double duration_s = 30;
+        size_t initial_files = 0; // Uploaded before measuring; defaults to 4 per connection
+        std::vector<Weighted<Route>> mix = {{POST_FILE, 10}, {GET_FILE, 45}, {PUT_FILE, 10}, {DELETE_FILE, 5}, {GET_CHUNK, 30}};
+        std::vector<Weighted<uint64_t>> sizes = {{64 << 10, 50}, {1 << 20, 35}, {16 << 20, 15}};
+        double dedup = 0.3;
+        uint64_t seed = 1;
+        std::string prefix = "loadgen-" + std::to_string(::getpid());
+        bool keep = false;
+        bool json = false;
+    };
+
+    const char *const USAGE =
+        "Usage: file-chunker-loadgen [--option=value ...]\n"
+        "  --host=127.0.0.1         Server address\n"
+        "  --port=8080              Server port\n"
+        "  --connections=32         Concurrent connections, one request in flight on each\n"
+        "  --duration=30            Seconds to measure for\n"
+        "  --files=<4 per conn>     Files uploaded before measuring, for reads to hit\n"
+        "  --mix=post:10,get:45,put:10,delete:5,chunk:30\n"
+        "                           Relative weights of the routes\n"
+        "  --sizes=64K:50,1M:35,16M:15\n"
+        "                           Relative weights of upload sizes (K, M and G suffixes)\n"
+        "  --dedup=0.3              Fraction of full chunks repeating content sent before\n"
+        "  --seed=1                 Seed of the request and content generators\n"
+        "  --prefix=loadgen-<pid>   Prefix of the names of the files created\n"
+        "  --keep                   Leave the files created on the server\n"
+        "  --format=text|json       Report format\n";
+
+    // --- Command line ---
+
+    uint64_t parseNumber(const std::string &text, const std::string &what)
+    {
+        char *end = nullptr;
+        errno = 0;
+        unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+        if (text.empty() || errno != 0 || *end != '\0')
+        {
+            throw std::runtime_error("Invalid " + what + ": " + text);
+        }
+        return value;
+    }
+
+    double parseFraction(const std::string &text, const std::string &what)
+    {
+        char *end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        if (text.empty() || *end != '\0' || !(value >= 0))
+        {
+            throw std::runtime_error("Invalid " + what + ": " + text);
+        }
+        return value;
+    }
+
+    // "64K", "16M", "1G" or a byte count
+    uint64_t parseSize(std::string text)
+    {
+        uint64_t scale = 1;
+        if (!text.empty())
+        {
+            switch (text.back())
+            {
+            case 'K':
+            case 'k':
+                scale = 1ull << 10;
+                break;
+            case 'M':
+            case 'm':
+                scale = 1ull << 20;
+                break;
+            case 'G':
+            case 'g':
+                scale = 1ull << 30;
+                break;
+            }
+            if (scale != 1)
+            {
+                text.pop_back();
+            }
+        }
+        return parseNumber(text, "size") * scale;
+    }
+
+    // "key:weight,key:weight,..."
+    template <typename T>
+    std::vector<Weighted<T>> parseWeights(const std::string &text, const std::function<T(const std::string &)> &parseKey)
+    {
+        std::vector<Weighted<T>> weights;
+        double total = 0;
+        size_t start = 0;
+        while (start <= text.size())
+        {
+            size_t end = text.find(',', start);
+            if (end == std::string::npos)
+            {
+                end = text.size();
+            }
+            const std::string item = text.substr(start, end - start);
+            const size_t colon = item.find(':');
+            if (colon == std::string::npos)
+            {
+                throw std::runtime_error("Expected key:weight, got: " + item);
+            }
+            Weighted<T> entry{parseKey(item.substr(0, colon)), parseFraction(item.substr(colon + 1), "weight")};
+            total += entry.weight;
+            weights.push_back(entry);
+            start = end + 1;
+        }
+        if (total <= 0)
+        {
+            throw std::runtime_error("Weights must not all be zero: " + text);
+        }
+        return weights;
+    }
+
+    Options parseOptions(int argc, char **argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const size_t equals = arg.find('=');
+            const std::string name = arg.substr(0, equals);
+            const std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+            if (name == "--host")
+                options.host = value;
+            else if (name == "--port")
+                options.port = value;
+            else if (name == "--connections")
+                options.connections = std::max<uint64_t>(1, parseNumber(value, "connection count"));
+            else if (name == "--duration")
+                options.duration_s = parseFraction(value, "duration");
+            else if (name == "--files")
+                options.initial_files = parseNumber(value, "file count");
+            else if (name == "--mix")
+                options.mix = parseWeights<Route>(value, [](const std::string &key)
+                                                  {
+                                                      for (int r = 0; r < ROUTE_COUNT; ++r)
+                                                      {
+                                                          if (key == ROUTE_KEYS[r])
+                                                              return static_cast<Route>(r);
+                                                      }
+                                                      throw std::runtime_error("Unknown route: " + key); });
+            else if (name == "--sizes")
+                options.sizes = parseWeights<uint64_t>(value, parseSize);
+            else if (name == "--dedup")
+                options.dedup = std::min(1.0, parseFraction(value, "dedup ratio"));
+            else if (name == "--seed")
+                options.seed = parseNumber(value, "seed");
+            else if (name == "--prefix")
+                options.prefix = value;
+            else if (name == "--keep")
+                options.keep = true;
+            else if (name == "--format" && (value == "text" || value == "json"))
+                options.json = value == "json";
+            else
+                throw std::runtime_error("Unknown option: " + arg);
+        }
+        if (options.initial_files == 0)
+        {
+            options.initial_files = 4 * options.connections;
+        }
+        return options;
+    }
+
+    template <typename T>
+    const T &pickWeighted(const std::vector<Weighted<T>> &weights, std::mt19937_64 &rng)
+    {
+        double total = 0;
+        for (const auto &entry : weights)
+        {
+            total += entry.weight;
+        }
+        double point = std::uniform_real_distribution<double>(0, total)(rng);
+        for (const auto &entry : weights)
+        {
+            if (point < entry.weight)
+            {
+                return entry.value;
+            }
+            point -= entry.weight;
+        }
+        return weights.back().value;
+    }
+
+    // --- HTTP/1.1 client ---
+
+    struct Response
+    {
+        int status = 0;
+        std::string body; // Kept only when asked for
+        uint64_t bytes = 0;
+    };
+
+    // One keep-alive connection, reopened whenever the server closes it
+    class Connection
+    {
+    public:
+        explicit Connection(const addrinfo &address) : address(address) {}
+        ~Connection() { close(); }
+
+        Connection(const Connection &) = delete;
+        Connection &operator=(const Connection &) = delete;
+
+        // Sends head + body and reads the whole response. Throws std::runtime_error on transport
+        // errors. A request that finds an idle connection closed is retried once on a new one.
+        Response request(const std::string &head, const std::string &body, bool keep_body)
+        {
+            const bool reused = fd >= 0;
+            try
+            {
+                return attempt(head, body, keep_body);
+            }
+            catch (const std::runtime_error &)
+            {
+                close();
+                if (!reused || received_any)
+                {
+                    throw;
+                }
+            }
+            return attempt(head, body, keep_body);
+        }
+
+        void close()
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+            buffer.clear();
+        }
+
+    private:
+        void open()
+        {
+            fd = ::socket(address.ai_family, address.ai_socktype | SOCK_CLOEXEC, address.ai_protocol);
+            if (fd < 0)
+            {
+                throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+            }
+            if (::connect(fd, address.ai_addr, address.ai_addrlen) != 0)
+            {
+                const int error = errno;
+                close();
+                throw std::runtime_error(std::string("connect: ") + std::strerror(error));
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        void sendAll(const char *data, size_t size)
+        {
+            while (size > 0)
+            {
+                ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+                if (sent < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error(std::string("send: ") + std::strerror(errno));
+                }
+                data += sent;
+                size -= static_cast<size_t>(sent);
+            }
+        }
+
+        // Appends more bytes to `buffer`; false at end of stream
+        bool fill()
+        {
+            char block[64 * 1024];
+            for (;;)
+            {
+                ssize_t n = ::recv(fd, block, sizeof(block), 0);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0)
+                    throw std::runtime_error(std::string("recv: ") + std::strerror(errno));
+                if (n == 0)
+                    return false;
+                received_any = true;
+                buffer.append(block, static_cast<size_t>(n));
+                return true;
+            }
+        }
+
+        Response attempt(const std::string &head, const std::string &body, bool keep_body)
+        {
+            if (fd < 0)
+            {
+                open();
+            }
+            received_any = false;
+            sendAll(head.data(), head.size());
+            sendAll(body.data(), body.size());
+
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos)
+            {
+                if (!fill())
+                {
+                    throw std::runtime_error("Connection closed before the response headers");
+                }
+            }
+
+            Response response;
+            if (buffer.compare(0, 5, "HTTP/") != 0 || buffer.size() < 12)
+            {
+                throw std::runtime_error("Malformed status line");
+            }
+            response.status = std::atoi(buffer.c_str() + 9);
+
+            // Header names are case-insensitive; lowercase a copy of the header block to search
+            std::string headers = buffer.substr(0, header_end + 2);
+            std::transform(headers.begin(), headers.end(), headers.begin(), [](unsigned char c)
+                           { return static_cast<char>(std::tolower(c)); });
+            if (headers.find("\r\ntransfer-encoding: chunked") != std::string::npos)
+            {
+                throw std::runtime_error("Chunked responses are not supported");
+            }
+            const bool close_after = headers.find("\r\nconnection: close") != std::string::npos;
+            const size_t length_at = headers.find("\r\ncontent-length:");
+            const bool has_length = length_at != std::string::npos;
+            uint64_t remaining = has_length ? std::strtoull(headers.c_str() + length_at + 17, nullptr, 10) : 0;
+
+            buffer.erase(0, header_end + 4);
+            response.bytes = header_end + 4;
+            for (;;)
+            {
+                const size_t take = has_length ? static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size())) : buffer.size();
+                if (keep_body)
+                {
+                    response.body.append(buffer, 0, take);
+                }
+                buffer.erase(0, take);
+                response.bytes += take;
+                remaining -= has_length ? take : 0;
+                if (has_length && remaining == 0)
+                {
+                    break;
+                }
+                if (!fill())
+                {
+                    if (has_length)
+                    {
+                        throw std::runtime_error("Connection closed mid-body");
+                    }
+                    break; // Body delimited by the end of the stream
+                }
+            }
+            if (close_after || !has_length)
+            {
+                close();
+            }
+            return response;
+        }
+
+        const addrinfo &address;
+        int fd = -1;
+        std::string buffer; // Received but not yet consumed
+        bool received_any = false;
+    };
+
+    std::string requestHead(const char *method, const std::string &target, const Options &options,
+                            const std::string &content_type = "", size_t content_length = 0)
+    {
+        std::string head = std::string(method) + " " + target + " HTTP/1.1\r\nHost: " + options.host + ":" + options.port + "\r\n";
+        if (!content_type.empty())
+        {
+            head += "Content-Type: " + content_type + "\r\n";
+        }
+        if (content_length > 0 || !content_type.empty())
+        {
+            head += "Content-Length: " + std::to_string(content_length) + "\r\n";
+        }
+        return head + "\r\n";
+    }
+
+    // --- Generated content and files ---
+
+    // Chunk-sized blocks of pseudo-random (incompressible) bytes, each defined by a seed. Full
+    // blocks are remembered so that later uploads can repeat them, at chunk-aligned offsets where
+    // the server will deduplicate them.
+    class ContentPool
+    {
+    public:
+        ContentPool(uint64_t seed, double dedup) : next_seed(seed << 32), dedup(dedup) {}
+
+        void appendFile(std::string &out, uint64_t size, std::mt19937_64 &rng)
+        {
+            const uint64_t chunk_size = ChunkConfig::CHUNK_SIZE;
+            for (uint64_t offset = 0; offset < size; offset += chunk_size)
+            {
+                const uint64_t block_size = std::min(chunk_size, size - offset);
+                appendBlock(out, block_size == chunk_size ? fullBlockSeed(rng) : next_seed++, block_size);
+            }
+        }
+
+    private:
+        static const size_t MAX_REMEMBERED = 4096;
+
+        uint64_t fullBlockSeed(std::mt19937_64 &rng)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!seeds.empty() && std::uniform_real_distribution<double>(0, 1)(rng) < dedup)
+            {
+                return seeds[std::uniform_int_distribution<size_t>(0, seeds.size() - 1)(rng)];
+            }
+            uint64_t seed = next_seed++;
+            if (seeds.size() < MAX_REMEMBERED)
+                seeds.push_back(seed);
+            else
+                seeds[std::uniform_int_distribution<size_t>(0, seeds.size() - 1)(rng)] = seed;
+            return seed;
+        }
+
+        static void appendBlock(std::string &out, uint64_t seed, uint64_t size)
+        {
+            const size_t start = out.size();
+            out.resize(start + size);
+            uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1; // splitmix64
+            for (uint64_t i = 0; i < size; i += 8)
+            {
+                uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                z ^= z >> 31;
+                std::memcpy(&out[start + i], &z, std::min<uint64_t>(8, size - i));
+            }
+        }
+
+        std::mutex mtx;
+        std::vector<uint64_t> seeds;
+        std::atomic<uint64_t> next_seed;
+        const double dedup;
+    };
+
+    struct FileEntry
+    {
+        std::string name;
+        std::vector<std::string> chunk_cids;
+    };
+
+    // Files known to exist on the server, shared by all connections
+    class FileSet
+    {
+    public:
+        void add(FileEntry entry)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            files.push_back(std::move(entry));
+        }
+
+        // Records new chunks of a file, unless it was deleted in the meantime
+        void replace(FileEntry entry)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (FileEntry &existing : files)
+            {
+                if (existing.name == entry.name)
+                {
+                    existing = std::move(entry);
+                    return;
+                }
+            }
+        }
+
+        // Copy of a random file, if any
+        bool pick(std::mt19937_64 &rng, FileEntry &out)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (files.empty())
+                return false;
+            out = files[std::uniform_int_distribution<size_t>(0, files.size() - 1)(rng)];
+            return true;
+        }
+
+        // Removes a random file so that no other request picks it while it is being deleted
+        bool take(std::mt19937_64 &rng, FileEntry &out)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (files.empty())
+                return false;
+            const size_t index = std::uniform_int_distribution<size_t>(0, files.size() - 1)(rng);
+            out = std::move(files[index]);
+            files[index] = std::move(files.back());
+            files.pop_back();
+            return true;
+        }
+
+        std::vector<FileEntry> takeAll()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            return std::move(files);
+        }
+
+    private:
+        std::mutex mtx;
+        std::vector<FileEntry> files;
+    };
+
+    // --- Measurements ---
+
+    struct RouteStats
+    {
+        std::vector<uint64_t> latencies_ns; // Of every response, whatever its status
+        uint64_t non_2xx = 0;
+        uint64_t transport_errors = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t bytes_received = 0;
+
+        void merge(const RouteStats &other)
+        {
+            latencies_ns.insert(latencies_ns.end(), other.latencies_ns.begin(), other.latencies_ns.end());
+            non_2xx += other.non_2xx;
+            transport_errors += other.transport_errors;
+            bytes_sent += other.bytes_sent;
+            bytes_received += other.bytes_received;
+        }
+    };
+
+    // Nearest-rank percentile of sorted values, in milliseconds
+    double percentileMs(const std::vector<uint64_t> &sorted, double q)
+    {
+        if (sorted.empty())
+            return 0;
+        size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(sorted.size())));
+        return static_cast<double>(sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1]) / 1e6;
+    }
+
+    // --- Load ---
+
+    class LoadGenerator
+    {
+    public:
+        LoadGenerator(const Options &options, const addrinfo &address)
+            : options(options), address(address), content(options.seed, options.dedup)
+        {
+        }
+
+        // Uploads options.initial_files files, unmeasured
+        void populate()
+        {
+            std::atomic<size_t> remaining{options.initial_files};
+            runConnections([&](Connection &connection, std::mt19937_64 &rng, std::vector<RouteStats> &stats)
+                           {
+                               size_t before = remaining.load();
+                               while (before > 0)
+                               {
+                                   if (remaining.compare_exchange_weak(before, before - 1))
+                                   {
+                                       upload(connection, rng, stats[POST_FILE]);
+                                       before = remaining.load();
+                                   }
+                               } });
+            std::vector<RouteStats> ignored(ROUTE_COUNT);
+            collect(ignored);
+            if (ignored[POST_FILE].transport_errors + ignored[POST_FILE].non_2xx > 0)
+            {
+                throw std::runtime_error("Uploading the initial files failed; is the server running at " +
+                                         options.host + ":" + options.port + "?");
+            }
+        }
+
+        // Runs the mix for options.duration_s and returns the wall time it took
+        double run()
+        {
+            const Clock::time_point started = Clock::now();
+            const Clock::time_point deadline = started + std::chrono::duration_cast<Clock::duration>(
+                                                             std::chrono::duration<double>(options.duration_s));
+            runConnections([&](Connection &connection, std::mt19937_64 &rng, std::vector<RouteStats> &stats)
+                           {
+                               while (Clock::now() < deadline)
+                               {
+                                   issue(pickWeighted(options.mix, rng), connection, rng, stats);
+                               } });
+            return std::chrono::duration<double>(Clock::now() - started).count();
+        }
+
+        // Deletes every file created (unmeasured)
+        void cleanUp()
+        {
+            std::vector<FileEntry> all = files.takeAll();
+            std::atomic<size_t> next{0};
+            runConnections([&](Connection &connection, std::mt19937_64 &, std::vector<RouteStats> &)
+                           {
+                               for (size_t i = next++; i < all.size(); i = next++)
+                               {
+                                   try
+                                   {
+                                       connection.request(requestHead("DELETE", "/files/" + all[i].name, options), "", false);
+                                   }
+                                   catch (const std::runtime_error &)
+                                   {
+                                       connection.close();
+                                   }
+                               } });
+            std::vector<RouteStats> ignored(ROUTE_COUNT);
+            collect(ignored);
+        }
+
+        // Moves the per-connection measurements into `out` (indexed by Route)
+        void collect(std::vector<RouteStats> &out)
+        {
+            for (auto &connection_stats : per_connection)
+            {
+                for (int r = 0; r < ROUTE_COUNT; ++r)
+                {
+                    out[r].merge(connection_stats[r]);
+                }
+            }
+            per_connection.clear();
+        }
+
+    private:
+        using Work = std::function<void(Connection &, std::mt19937_64 &, std::vector<RouteStats> &)>;
+
+        void runConnections(const Work &work)
+        {
+            const size_t first = per_connection.size();
+            per_connection.resize(first + options.connections, std::vector<RouteStats>(ROUTE_COUNT));
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < options.connections; ++i)
+            {
+                threads.emplace_back([&, i]
+                                     {
+                                         Connection connection(address);
+                                         std::mt19937_64 rng(options.seed * 1000003 + (first + i));
+                                         work(connection, rng, per_connection[first + i]); });
+            }
+            for (std::thread &thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        // Times one request and records it under `stats`; returns the response if one arrived
+        bool measure(Connection &connection, const std::string &head, const std::string &body, bool keep_body,
+                     RouteStats &stats, Response &response)
+        {
+            const Clock::time_point started = Clock::now();
+            try
+            {
+                response = connection.request(head, body, keep_body);
+            }
+            catch (const std::runtime_error &)
+            {
+                ++stats.transport_errors;
+                connection.close();
+                std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Don't spin on a dead server
+                return false;
+            }
+            stats.latencies_ns.push_back(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count()));
+            stats.bytes_sent += head.size() + body.size();
+            stats.bytes_received += response.bytes;
+            if (response.status < 200 || response.status >= 300)
+            {
+                ++stats.non_2xx;
+                return false;
+            }
+            return true;
+        }
+
+        // multipart/form-data body with the generated file as part "file", as POST and PUT expect
+        std::string multipartBody(const std::string &name, std::mt19937_64 &rng, const std::string &boundary)
+        {
+            std::string body = "--" + boundary + "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"" + name +
+                               "\"\r\nContent-Type: application/octet-stream\r\n\r\n";
+            const uint64_t size = pickWeighted(options.sizes, rng);
+            body.reserve(body.size() + size + boundary.size() + 8);
+            content.appendFile(body, size, rng);
+            body += "\r\n--" + boundary + "--\r\n";
+            return body;
+        }
+
+        // Uploads (POST) a new file, or replaces (PUT) an existing one, and records its chunks
+        void upload(Connection &connection, std::mt19937_64 &rng, RouteStats &stats, const std::string *existing = nullptr)
+        {
+            const std::string name = existing ? *existing : options.prefix + "-" + std::to_string(next_file++) + ".bin";
+            const std::string boundary = "----file-chunker-loadgen-" + std::to_string(rng());
+            const std::string body = multipartBody(name, rng, boundary);
+            const std::string head = requestHead(existing ? "PUT" : "POST", existing ? "/files/" + name : "/files", options,
+                                                 "multipart/form-data; boundary=" + boundary, body.size());
+            Response response;
+            if (!measure(connection, head, body, true, stats, response))
+            {
+                return;
+            }
+            FileEntry entry{name, {}};
+            try
+            {
+                entry.chunk_cids = nlohmann::json::parse(response.body).at("chunk_cids").get<std::vector<std::string>>();
+            }
+            catch (const nlohmann::json::exception &)
+            {
+                // Still a valid file to read and delete; just no chunks to fetch directly
+            }
+            if (existing)
+                files.replace(std::move(entry));
+            else
+                files.add(std::move(entry));
+        }
+
+        void issue(Route route, Connection &connection, std::mt19937_64 &rng, std::vector<RouteStats> &stats)
+        {
+            FileEntry file;
+            Response response;
+            switch (route)
+            {
+            case GET_FILE:
+                if (files.pick(rng, file))
+                {
+                    measure(connection, requestHead("GET", "/files/" + file.name, options), "", false, stats[route], response);
+                    return;
+                }
+                break;
+            case PUT_FILE:
+                if (files.pick(rng, file))
+                {
+                    upload(connection, rng, stats[route], &file.name);
+                    return;
+                }
+                break;
+            case DELETE_FILE:
+                if (files.take(rng, file))
+                {
+                    measure(connection, requestHead("DELETE", "/files/" + file.name, options), "", false, stats[route], response);
+                    return;
+                }
+                break;
+            case GET_CHUNK:
+                if (files.pick(rng, file) && !file.chunk_cids.empty())
+                {
+                    const std::string &cid = file.chunk_cids[std::uniform_int_distribution<size_t>(0, file.chunk_cids.size() - 1)(rng)];
+                    measure(connection, requestHead("GET", "/chunks/" + cid, options), "", false, stats[route], response);
+                    return;
+                }
+                break;
+            default:
+                break;
+            }
+            upload(connection, rng, stats[POST_FILE]); // POST, or nothing to read or delete yet
+        }
+
+        const Options &options;
+        const addrinfo &address;
+        ContentPool content;
+        FileSet files;
+        std::atomic<uint64_t> next_file{0};
+        std::vector<std::vector<RouteStats>> per_connection; // [connection][route]
+    };
+
+    // --- Report ---
+
+    void printReport(const Options &options, std::vector<RouteStats> &stats, double elapsed_s)
+    {
+        RouteStats total;
+        for (RouteStats &route : stats)
+        {
+            std::sort(route.latencies_ns.begin(), route.latencies_ns.end());
+            total.merge(route);
+        }
+        std::sort(total.latencies_ns.begin(), total.latencies_ns.end());
+
+        auto summarize = [elapsed_s](const RouteStats &route)
+        {
+            const double requests = static_cast<double>(route.latencies_ns.size());
+            return nlohmann::json{
+                {"requests", route.latencies_ns.size()},
+                {"requests_per_second", requests / elapsed_s},
+                {"mib_per_second", static_cast<double>(route.bytes_sent + route.bytes_received) / (1 << 20) / elapsed_s},
+                {"p50_ms", percentileMs(route.latencies_ns, 0.50)},
+                {"p99_ms", percentileMs(route.latencies_ns, 0.99)},
+                {"p999_ms", percentileMs(route.latencies_ns, 0.999)},
+                {"max_ms", percentileMs(route.latencies_ns, 1.0)},
+                {"non_2xx", route.non_2xx},
+                {"transport_errors", route.transport_errors},
+            };
+        };
+
+        if (options.json)
+        {
+            nlohmann::json report;
+            report["connections"] = options.connections;
+            report["duration_s"] = elapsed_s;
+            report["dedup"] = options.dedup;
+            for (int r = 0; r < ROUTE_COUNT; ++r)
+            {
+                if (!stats[r].latencies_ns.empty() || stats[r].transport_errors > 0)
+                    report["routes"][ROUTE_NAMES[r]] = summarize(stats[r]);
+            }
+            report["total"] = summarize(total);
+            std::printf("%s\n", report.dump(2).c_str());
+            return;
+        }
+
+        std::printf("%zu connections, %.1f s, dedup %.2f\n\n", options.connections, elapsed_s, options.dedup);
+        std::printf("%-22s %10s %10s %10s %10s %10s %10s %10s %8s %8s\n", "route", "requests", "req/s", "MiB/s",
+                    "p50 ms", "p99 ms", "p999 ms", "max ms", "non-2xx", "errors");
+        auto printRow = [&summarize](const char *name, const RouteStats &route)
+        {
+            const nlohmann::json row = summarize(route);
+            std::printf("%-22s %10llu %10.1f %10.1f %10.2f %10.2f %10.2f %10.2f %8llu %8llu\n", name,
+                        static_cast<unsigned long long>(row["requests"].get<uint64_t>()), row["requests_per_second"].get<double>(),
+                        row["mib_per_second"].get<double>(), row["p50_ms"].get<double>(), row["p99_ms"].get<double>(),
+                        row["p999_ms"].get<double>(), row["max_ms"].get<double>(),
+                        static_cast<unsigned long long>(route.non_2xx), static_cast<unsigned long long>(route.transport_errors));
+        };
+        for (int r = 0; r < ROUTE_COUNT; ++r)
+        {
+            if (!stats[r].latencies_ns.empty() || stats[r].transport_errors > 0)
+                printRow(ROUTE_NAMES[r], stats[r]);
+        }
+        printRow("total", total);
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::string(argv[i]) == "--help" || std::string(argv[i]) == "-h")
+            {
+                std::fputs(USAGE, stdout);
+                return 0;
+            }
+        }
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n\n%s", e.what(), USAGE);
+        return 2;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    if (int error = ::getaddrinfo(options.host.c_str(), options.port.c_str(), &hints, &addresses))
+    {
+        std::fprintf(stderr, "Cannot resolve %s:%s: %s\n", options.host.c_str(), options.port.c_str(), ::gai_strerror(error));
+        return 1;
+    }
+
+    int status = 0;
+    try
+    {
+        LoadGenerator generator(options, *addresses);
+        std::fprintf(stderr, "Uploading %zu files...\n", options.initial_files);
+        generator.populate();
+        std::fprintf(stderr, "Running for %.1f s on %zu connections...\n", options.duration_s, options.connections);
+        const double elapsed_s = generator.run();
+        std::vector<RouteStats> stats(ROUTE_COUNT);
+        generator.collect(stats);
+        if (!options.keep)
+        {
+            std::fprintf(stderr, "Deleting the files created...\n");
+            generator.cleanUp();
+        }
+        printReport(options, stats, elapsed_s);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        status = 1;
+    }
+    ::freeaddrinfo(addresses);
+    return status;
+}
@@ -1,11 +1,16 @@
 // main.cpp
-#include <iostream>
 #include <vector>
 #include <string>
 #include <filesystem>
 #include <fstream>
 #include <chrono> // For timing operations
 #include <memory> // For std::make_shared
+#include <optional>
+#include <cstdlib> // For std::strtoull, std::getenv
+#include <algorithm> // For std::max
+#include <ctime>     // For timegm, std::gmtime, std::strftime
+#include <iomanip>   // For std::get_time
+#include <sstream>
 
 // Crow includes
 #include <crow.h>
@@ -15,6 +20,8 @@
 #include "file_manager.hpp"
 #include "chunk_config.hpp"
 #include "file_metadata.hpp" // For metadata handling
+#include "metrics.hpp"       // For GET /metrics
+#include "logger.hpp"        // For structured logging
 
 namespace fs = std::filesystem;
 
@@ -31,18 +38,116 @@ std::string getContentType(const std::string& filename) {
     return "application/octet-stream"; // Default
 }
 
+// --- HTTP validators for files (see GET /files/<filename>) ---
+// The Merkle root over a file's chunk CIDs changes whenever any byte does, so it serves as a
+// strong ETag; the same content has the same ETag under any name or version.
+std::string fileETag(const FileManager::Metadata::FileMetadata& metadata) {
+    return "\"" + metadata.merkle_root + "\"";
+}
+
+// Parse a UTC timestamp in the given std::get_time format. Returns nullopt if it doesn't match.
+std::optional<std::time_t> parseUtcTime(const std::string& value, const char* format) {
+    std::tm tm{};
+    std::istringstream in(value);
+    in >> std::get_time(&tm, format);
+    if (in.fail()) {
+        return std::nullopt;
+    }
+    return timegm(&tm);
+}
+
+// Helper to set ETag and Last-Modified (from created_at, when the version was committed)
+void setFileValidators(crow::response& res, const FileManager::Metadata::FileMetadata& metadata) {
+    res.set_header("ETag", fileETag(metadata));
+    if (std::optional<std::time_t> created = parseUtcTime(metadata.created_at, "%Y-%m-%dT%H:%M:%SZ")) {
+        char buf[64];
+        std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", std::gmtime(&*created));
+        res.set_header("Last-Modified", buf);
+    }
+}
+
+// True if an If-Match / If-None-Match header lists `etag` or is "*". Weak comparison
+// (If-None-Match) ignores a W/ prefix; strong comparison (If-Match) never matches a weak tag.
+bool etagListMatches(const std::string& header, const std::string& etag, bool weak) {
+    std::istringstream tags(header);
+    std::string tag;
+    while (std::getline(tags, tag, ',')) {
+        tag.erase(0, tag.find_first_not_of(" \t"));
+        tag.erase(tag.find_last_not_of(" \t") + 1);
+        if (tag == "*") {
+            return true;
+        }
+        if (tag.rfind("W/", 0) == 0) {
+            if (!weak) {
+                continue;
+            }
+            tag.erase(0, 2);
+        }
+        if (tag == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Evaluate a request's preconditions against a file version, in the order HTTP specifies:
+// If-Match, then If-None-Match, or If-Modified-Since when there is no If-None-Match.
+// Returns the response to send instead of the file (412 or 304), if any.
+std::optional<crow::response> checkFilePreconditions(const crow::request& req,
+                                                     const FileManager::Metadata::FileMetadata& metadata) {
+    const std::string etag = fileETag(metadata);
+    const std::string& if_match = req.get_header_value("If-Match");
+    if (!if_match.empty() && !etagListMatches(if_match, etag, false)) {
+        return crow::response(412, "Precondition Failed: The file has changed.");
+    }
+
+    bool not_modified = false;
+    const std::string& if_none_match = req.get_header_value("If-None-Match");
+    const std::string& if_modified_since = req.get_header_value("If-Modified-Since");
+    if (!if_none_match.empty()) {
+        not_modified = etagListMatches(if_none_match, etag, true);
+    } else if (!if_modified_since.empty()) {
+        std::optional<std::time_t> since = parseUtcTime(if_modified_since, "%a, %d %b %Y %H:%M:%S GMT");
+        std::optional<std::time_t> created = parseUtcTime(metadata.created_at, "%Y-%m-%dT%H:%M:%SZ");
+        not_modified = since && created && *created <= *since;
+    }
+    if (not_modified) {
+        crow::response res(304);
+        setFileValidators(res, metadata);
+        return res;
+    }
+    return std::nullopt;
+}
+
+// Helper to read an optional unsigned query parameter into `value`.
+// Returns false if it is present but not a number.
+bool parseUnsignedParam(const crow::request& req, const char* name, std::optional<uint64_t>& value) {
+    const char* raw = req.url_params.get(name);
+    if (raw == nullptr) {
+        return true;
+    }
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(raw, &end, 10);
+    if (*raw == '\0' || *end != '\0') {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
 int main() {
     // Determine optimal number of threads for the FileManager's thread pool
+    // (defaults to a reasonable number if hardware_concurrency returns 0)
     const size_t num_fm_threads = std::thread::hardware_concurrency();
-    // Default to a reasonable number if hardware_concurrency returns 0 or too few
-    FileManager::FileManager fm(num_fm_threads == 0 ? 4 : num_fm_threads);
 
     // --- Crow Application Setup ---
     crow::SimpleApp app; // Create a Crow app instance
 
     // Shared pointer for FileManager instance to be captured by lambda routes
-    // This allows the FileManager to persist across requests
-    auto fm_ptr = std::make_shared<FileManager::FileManager>(num_fm_threads == 0 ? 4 : num_fm_threads);
+    // This allows the FileManager to persist across requests. There must be only one
+    // FileManager per store: on startup it removes temp files left behind by a crash.
+    auto fm_ptr = std::make_shared<FileManager::FileManager>(num_fm_threads == 0 ? 4 : num_fm_threads,
+                                                             FileManager::Config::ChunkConfig::fromEnvironment());
 
     // --- Base URL & Port ---
     // The base URL will be http://localhost:8080/
@@ -62,7 +167,7 @@ int main() {
         crow::multipart::message multipart_data(req);
         std::string original_filename_from_form;
         std::string content_type_from_form;
-        crow::multipart::part* file_part = nullptr;
+        const crow::multipart::part* file_part = nullptr;
 
         for (const auto& part : multipart_data.parts) {
             if (part.get_name() == "file") {
@@ -119,23 +224,53 @@ int main() {
             response_json["size"] = metadata.file_size_bytes;
             response_json["content_type"] = metadata.content_type;
             response_json["created_at"] = metadata.created_at;
+            response_json["version"] = metadata.version;
+            response_json["merkle_root"] = metadata.merkle_root;
             response_json["chunk_cids"] = crow::json::wvalue::list(metadata.chunk_cids.begin(), metadata.chunk_cids.end());
 
             return crow::response(201, response_json); // 201 Created
         } catch (const std::exception& e) {
-            std::cerr << "Error during file upload: " << e.what() << std::endl;
+            FileManager::Logging::error("Error during file upload", {{"error", e.what()}});
             fs::remove(temp_filepath); // Ensure temp file is cleaned up on error
             return crow::response(500, "Internal Server Error: " + std::string(e.what()));
         }
     });
 
-    // --- GET /files/<filename>: Retrieve a file ---
+    // --- GET /files/<filename>[?version=<n>]: Retrieve a file (HEAD: just its headers) ---
+    // Without a version the current one is returned; past versions are kept up to
+    // FM_FILE_VERSIONS_RETAINED (see GET /files/<filename>/versions).
+    // Responses carry an ETag (the file's Merkle root) and Last-Modified, and If-Match,
+    // If-None-Match and If-Modified-Since are honoured (412 / 304) before any chunk is read.
+    // Crow routes HEAD here and drops the body; HEAD is answered from the metadata alone.
     CROW_ROUTE(app, "/files/<string>")
     ([fm_ptr](const crow::request& req, std::string filename) {
+        std::optional<uint64_t> version;
+        if (const char* version_param = req.url_params.get("version")) {
+            char* end = nullptr;
+            unsigned long long parsed = std::strtoull(version_param, &end, 10);
+            if (*version_param == '\0' || *end != '\0') {
+                return crow::response(400, "Bad Request: Invalid 'version' query parameter.");
+            }
+            version = parsed;
+        }
         fs::path temp_output_path = fs::temp_directory_path() / ("retrieved_" + filename);
 
         try {
-            if (fm_ptr->retrieveFile(filename, temp_output_path.string())) {
+            // Pin the version first, so the ETag describes exactly the content sent
+            FileManager::Metadata::FileMetadata metadata = fm_ptr->getFileMetadata(filename, version);
+            if (std::optional<crow::response> precondition = checkFilePreconditions(req, metadata)) {
+                return std::move(*precondition);
+            }
+            if (req.method == "HEAD"_method) {
+                crow::response res(200);
+                res.set_header("Content-Type", getContentType(filename));
+                res.set_header("Content-Length", std::to_string(metadata.file_size_bytes));
+                res.manual_length_header = true; // There is no body to measure
+                setFileValidators(res, metadata);
+                return res;
+            }
+
+            if (fm_ptr->retrieveFile(filename, temp_output_path.string(), metadata.version)) {
                 std::ifstream ifs(temp_output_path, std::ios::binary);
                 if (!ifs.is_open()) {
                     return crow::response(500, "Internal Server Error: Could not open retrieved file.");
@@ -151,13 +286,14 @@ int main() {
                 crow::response res(200);
                 res.set_header("Content-Type", getContentType(filename));
                 res.set_header("Content-Disposition", "attachment; filename=\"" + filename + "\"");
+                setFileValidators(res, metadata);
                 res.write(std::string(buffer.begin(), buffer.end()));
                 return res;
             } else {
                 return crow::response(404, "File not found or retrieval failed.");
             }
         } catch (const std::runtime_error& e) {
-            std::cerr << "Error retrieving file: " << e.what() << std::endl;
+            FileManager::Logging::error("Error retrieving file", {{"error", e.what()}});
             fs::remove(temp_output_path); // Clean up temp file on error
             if (std::string(e.what()).find("not found") != std::string::npos) {
                 return crow::response(404, "File not found.");
@@ -166,19 +302,142 @@ int main() {
         }
     });
 
+    // --- GET /files/<filename>/versions: List the retained versions of a file ---
+    // Oldest first; the last entry is the current version.
+    CROW_ROUTE(app, "/files/<string>/versions")
+    ([fm_ptr](std::string filename) {
+        try {
+            std::vector<crow::json::wvalue> entries;
+            for (const auto& metadata : fm_ptr->listFileVersions(filename)) {
+                crow::json::wvalue entry;
+                entry["version"] = metadata.version;
+                entry["merkle_root"] = metadata.merkle_root;
+                entry["size"] = metadata.file_size_bytes;
+                entry["content_type"] = metadata.content_type;
+                entry["created_at"] = metadata.created_at;
+                entries.push_back(std::move(entry));
+            }
+            crow::json::wvalue response_json;
+            response_json["filename"] = filename;
+            response_json["versions"] = std::move(entries);
+            return crow::response(200, response_json);
+        } catch (const std::exception& e) {
+            FileManager::Logging::error("Error listing versions", {{"error", e.what()}});
+            if (std::string(e.what()).find("not found") != std::string::npos) {
+                return crow::response(404, "File not found.");
+            }
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    // --- GET /files/<filename>/diff?against=<other>[&version=<n>][&against_version=<m>] ---
+    // Compares two files (or two versions of one, when <other> is the same name) through their
+    // Merkle trees, without reading any chunk data, and lists the chunk and byte ranges that differ.
+    CROW_ROUTE(app, "/files/<string>/diff")
+    ([fm_ptr](const crow::request& req, std::string filename) {
+        const char* against = req.url_params.get("against");
+        if (against == nullptr || *against == '\0') {
+            return crow::response(400, "Bad Request: Missing 'against' query parameter.");
+        }
+        std::optional<uint64_t> version, against_version;
+        if (!parseUnsignedParam(req, "version", version)) {
+            return crow::response(400, "Bad Request: Invalid 'version' query parameter.");
+        }
+        if (!parseUnsignedParam(req, "against_version", against_version)) {
+            return crow::response(400, "Bad Request: Invalid 'against_version' query parameter.");
+        }
+
+        try {
+            FileManager::FileManager::FileDiff diff = fm_ptr->diffFiles(filename, version, against, against_version);
+            std::vector<crow::json::wvalue> ranges;
+            for (const auto& range : diff.ranges) {
+                crow::json::wvalue entry;
+                entry["first_chunk"] = range.first_chunk;
+                entry["end_chunk"] = range.end_chunk;
+                entry["offset"] = range.offset;
+                entry["length"] = range.length;
+                ranges.push_back(std::move(entry));
+            }
+            crow::json::wvalue response_json;
+            response_json["identical"] = diff.identical;
+            response_json["merkle_root"] = diff.merkle_root;
+            response_json["against_merkle_root"] = diff.other_merkle_root;
+            response_json["ranges"] = std::move(ranges);
+            return crow::response(200, response_json);
+        } catch (const std::runtime_error& e) {
+            FileManager::Logging::error("Error comparing files", {{"error", e.what()}});
+            if (std::string(e.what()).find("not found") != std::string::npos) {
+                return crow::response(404, "File not found.");
+            }
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    // --- GET /files/<filename>/proof?chunk=<index>[&version=<n>]: Merkle proof for one chunk ---
+    // For verified range reads: fetch the chunk from /chunks/<cid>, check it hashes to <cid>,
+    // then check <cid> against the file's Merkle root (its ETag) with the sibling hashes.
+    CROW_ROUTE(app, "/files/<string>/proof")
+    ([fm_ptr](const crow::request& req, std::string filename) {
+        std::optional<uint64_t> index, version;
+        if (!parseUnsignedParam(req, "chunk", index) || !index) {
+            return crow::response(400, "Bad Request: Missing or invalid 'chunk' query parameter.");
+        }
+        if (!parseUnsignedParam(req, "version", version)) {
+            return crow::response(400, "Bad Request: Invalid 'version' query parameter.");
+        }
+
+        try {
+            FileManager::FileManager::ChunkProof proof = fm_ptr->getChunkProof(filename, *index, version);
+            std::vector<crow::json::wvalue> siblings;
+            for (const auto& sibling : proof.siblings) {
+                siblings.emplace_back(sibling);
+            }
+            crow::json::wvalue response_json;
+            response_json["chunk"] = proof.chunk_cid;
+            response_json["index"] = proof.index;
+            response_json["chunk_count"] = proof.chunk_count;
+            response_json["merkle_root"] = proof.merkle_root;
+            response_json["siblings"] = std::move(siblings);
+            return crow::response(200, response_json);
+        } catch (const std::runtime_error& e) {
+            FileManager::Logging::error("Error building chunk proof", {{"error", e.what()}});
+            std::string message = e.what();
+            if (message.find("not found") != std::string::npos) {
+                return crow::response(404, "File not found.");
+            }
+            if (message.find("out of range") != std::string::npos) {
+                return crow::response(416, message);
+            }
+            return crow::response(500, "Internal Server Error: " + message);
+        }
+    });
+
     // --- GET /chunks/<hash>: Retrieve a specific chunk ---
+    // Uncompressed chunk files are handed to Crow as a static file, so they are streamed from the
+    // page cache in fixed-size blocks instead of being copied into a vector and then a std::string.
+    // Crow does not expose the connection socket to handlers, so sendfile(2) can't be used here;
+    // this is the plain-file fallback and keeps per-request memory independent of chunk size.
+    // Compressed chunks are decompressed in memory.
     CROW_ROUTE(app, "/chunks/<string>")
     ([fm_ptr](const crow::request& req, std::string chunk_hash) {
         try {
-            std::vector<char> chunk_data = fm_ptr->retrieveChunk(chunk_hash);
+            std::optional<fs::path> chunk_path = fm_ptr->getRawChunkPath(chunk_hash);
 
-            crow::response res(200);
+            crow::response res;
+            if (chunk_path) {
+                res.set_static_file_info_unsafe(chunk_path->string()); // CID already validated by FileManager
+                if (res.code != 200) {
+                    return crow::response(404, "Chunk not found.");
+                }
+            } else {
+                std::vector<char> chunk_data = fm_ptr->retrieveChunk(chunk_hash);
+                res.write(std::string(chunk_data.begin(), chunk_data.end()));
+            }
             res.set_header("Content-Type", "application/octet-stream"); // Generic for binary data
             res.set_header("Content-Disposition", "attachment; filename=\"" + chunk_hash + ".chunk\"");
-            res.write(std::string(chunk_data.begin(), chunk_data.end()));
             return res;
         } catch (const std::runtime_error& e) {
-            std::cerr << "Error retrieving chunk: " << e.what() << std::endl;
+            FileManager::Logging::error("Error retrieving chunk", {{"error", e.what()}});
             if (std::string(e.what()).find("not found") != std::string::npos) {
                 return crow::response(404, "Chunk not found.");
             }
@@ -186,17 +445,197 @@ int main() {
         }
     });
 
+    // --- PATCH /files/<filename>?offset=<n>: Modify part of a file ---
+    // The body replaces bytes starting at <n>, extending the file if it runs past the end.
+    // Without an offset the body is appended. Only the chunks the patch touches are rewritten.
+    CROW_ROUTE(app, "/files/<string>").methods("PATCH"_method)
+    ([fm_ptr](const crow::request& req, std::string filename) {
+        std::optional<uint64_t> offset;
+        if (const char* offset_param = req.url_params.get("offset")) {
+            char* end = nullptr;
+            unsigned long long parsed = std::strtoull(offset_param, &end, 10);
+            if (*offset_param == '\0' || *end != '\0') {
+                return crow::response(400, "Bad Request: Invalid 'offset' query parameter.");
+            }
+            offset = parsed;
+        }
+
+        try {
+            FileManager::Metadata::FileMetadata metadata =
+                fm_ptr->patchFile(filename, offset, std::vector<char>(req.body.begin(), req.body.end()));
+
+            crow::json::wvalue response_json;
+            response_json["filename"] = metadata.original_filename;
+            response_json["size"] = metadata.file_size_bytes;
+            response_json["content_type"] = metadata.content_type;
+            response_json["created_at"] = metadata.created_at;
+            response_json["version"] = metadata.version;
+            response_json["merkle_root"] = metadata.merkle_root;
+            response_json["chunk_cids"] = crow::json::wvalue::list(metadata.chunk_cids.begin(), metadata.chunk_cids.end());
+            return crow::response(200, response_json);
+        } catch (const std::exception& e) {
+            std::string what = e.what();
+            FileManager::Logging::error("Error patching file", {{"error", what}});
+            if (what.find("beyond the end") != std::string::npos) {
+                return crow::response(416, what); // 416 Range Not Satisfiable
+            }
+            if (what.find("not found") != std::string::npos) {
+                return crow::response(404, "File not found.");
+            }
+            return crow::response(500, "Internal Server Error: " + what);
+        }
+    });
+
+    // --- POST /chunks/missing: Ask which chunks the server doesn't have ---
+    // Expects JSON {"cids": ["<hash>", ...]} and answers {"missing": [...]}. Together with
+    // PUT /chunks/<hash> and POST /files/<filename>/commit this lets clients chunk and hash
+    // files themselves and upload only the chunks that are new.
+    CROW_ROUTE(app, "/chunks/missing").methods("POST"_method)
+    ([fm_ptr](const crow::request& req) {
+        std::vector<std::string> cids;
+        try {
+            crow::json::rvalue body = crow::json::load(req.body);
+            if (!body) {
+                return crow::response(400, "Bad Request: Expected a JSON body.");
+            }
+            for (const auto& cid : body["cids"].lo()) {
+                cids.push_back(cid.s());
+            }
+        } catch (const std::exception&) {
+            return crow::response(400, "Bad Request: Expected {\"cids\": [...]}.");
+        }
+
+        try {
+            std::vector<std::string> missing = fm_ptr->findMissingChunks(cids);
+            crow::json::wvalue response_json;
+            response_json["missing"] = crow::json::wvalue::list(missing.begin(), missing.end());
+            return crow::response(200, response_json);
+        } catch (const std::exception& e) {
+            if (std::string(e.what()).find("Invalid CID") != std::string::npos) {
+                return crow::response(400, "Bad Request: " + std::string(e.what()));
+            }
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    // --- PUT /chunks/<hash>: Upload a single chunk ---
+    // The body is the raw chunk; it is rejected unless its SHA-256 matches <hash>.
+    // Optional query parameter content_type picks the compression dictionary.
+    CROW_ROUTE(app, "/chunks/<string>").methods("PUT"_method)
+    ([fm_ptr](const crow::request& req, std::string chunk_hash) {
+        const char* content_type = req.url_params.get("content_type");
+        try {
+            bool written = fm_ptr->putChunk(chunk_hash, std::vector<char>(req.body.begin(), req.body.end()),
+                                            content_type != nullptr ? content_type : "");
+            return crow::response(written ? 201 : 200); // 201 Created, or 200 if already stored
+        } catch (const std::exception& e) {
+            std::string what = e.what();
+            FileManager::Logging::error("Error storing chunk", {{"error", what}});
+            if (what.find("Invalid CID") != std::string::npos || what.find("hash mismatch") != std::string::npos) {
+                return crow::response(400, "Bad Request: " + what);
+            }
+            if (what.find("too large") != std::string::npos) {
+                return crow::response(413, what);
+            }
+            return crow::response(500, "Internal Server Error: " + what);
+        }
+    });
+
+    // --- POST /files/<filename>/commit: Create a file from uploaded chunks ---
+    // Expects JSON {"content_type": "...", "chunks": ["<hash>", ...]} listing the file's chunks
+    // in order. Every chunk must already be stored; otherwise 409 with {"missing": [...]}.
+    CROW_ROUTE(app, "/files/<string>/commit").methods("POST"_method)
+    ([fm_ptr](const crow::request& req, std::string filename) {
+        std::string content_type;
+        std::vector<std::string> cids;
+        try {
+            crow::json::rvalue body = crow::json::load(req.body);
+            if (!body) {
+                return crow::response(400, "Bad Request: Expected a JSON body.");
+            }
+            for (const auto& cid : body["chunks"].lo()) {
+                cids.push_back(cid.s());
+            }
+            content_type = body.has("content_type") ? std::string(body["content_type"].s()) : getContentType(filename);
+        } catch (const std::exception&) {
+            return crow::response(400, "Bad Request: Expected {\"content_type\": \"...\", \"chunks\": [...]}.");
+        }
+
+        try {
+            FileManager::Metadata::FileMetadata metadata = fm_ptr->commitManifest(filename, content_type, cids);
+
+            crow::json::wvalue response_json;
+            response_json["filename"] = metadata.original_filename;
+            response_json["size"] = metadata.file_size_bytes;
+            response_json["content_type"] = metadata.content_type;
+            response_json["created_at"] = metadata.created_at;
+            response_json["version"] = metadata.version;
+            response_json["merkle_root"] = metadata.merkle_root;
+            response_json["chunk_cids"] = crow::json::wvalue::list(metadata.chunk_cids.begin(), metadata.chunk_cids.end());
+            return crow::response(201, response_json); // 201 Created
+        } catch (const std::exception& e) {
+            std::string what = e.what();
+            FileManager::Logging::error("Error committing manifest", {{"error", what}});
+            if (what.find("Invalid CID") != std::string::npos) {
+                return crow::response(400, "Bad Request: " + what);
+            }
+            if (what.find("not found") != std::string::npos) {
+                std::vector<std::string> missing = fm_ptr->findMissingChunks(cids);
+                crow::json::wvalue response_json;
+                response_json["missing"] = crow::json::wvalue::list(missing.begin(), missing.end());
+                return crow::response(409, response_json); // 409 Conflict
+            }
+            return crow::response(500, "Internal Server Error: " + what);
+        }
+    });
+
+    // --- POST /files/<filename>/copy?to=<new>: Copy a file on the server ---
+    // The copy shares all chunks with the original, so it costs one metadata write whatever
+    // the file's size. An existing file named <new> is replaced (and kept as a past version).
+    CROW_ROUTE(app, "/files/<string>/copy").methods("POST"_method)
+    ([fm_ptr](const crow::request& req, std::string filename) {
+        const char* destination = req.url_params.get("to");
+        if (destination == nullptr) {
+            return crow::response(400, "Bad Request: Missing 'to' query parameter.");
+        }
+
+        try {
+            FileManager::Metadata::FileMetadata metadata = fm_ptr->copyFile(filename, destination);
+
+            crow::json::wvalue response_json;
+            response_json["filename"] = metadata.original_filename;
+            response_json["size"] = metadata.file_size_bytes;
+            response_json["content_type"] = metadata.content_type;
+            response_json["created_at"] = metadata.created_at;
+            response_json["version"] = metadata.version;
+            response_json["merkle_root"] = metadata.merkle_root;
+            response_json["chunk_cids"] = crow::json::wvalue::list(metadata.chunk_cids.begin(), metadata.chunk_cids.end());
+            return crow::response(201, response_json); // 201 Created
+        } catch (const std::exception& e) {
+            std::string what = e.what();
+            FileManager::Logging::error("Error copying file", {{"error", what}});
+            if (what.find("Invalid file name") != std::string::npos) {
+                return crow::response(400, "Bad Request: " + what);
+            }
+            if (what.find("not found") != std::string::npos) {
+                return crow::response(404, "File not found.");
+            }
+            return crow::response(500, "Internal Server Error: " + what);
+        }
+    });
+
     // --- DELETE /files/<filename>: Delete a file ---
+    // The file is gone once this returns; its chunks are released and reclaimed in the background.
     CROW_ROUTE(app, "/files/<string>").methods("DELETE"_method)
     ([fm_ptr](const crow::request& req, std::string filename) {
         try {
             if (fm_ptr->deleteFile(filename)) {
-                return crow::response(204); // 204 No Content on successful deletion
+                return crow::response(202); // 202 Accepted: storage is freed asynchronously
             } else {
                 return crow::response(404, "File not found or deletion failed."); // Might be due to file not existing
             }
         } catch (const std::exception& e) {
-            std::cerr << "Error deleting file: " << e.what() << std::endl;
+            FileManager::Logging::error("Error deleting file", {{"error", e.what()}});
             if (std::string(e.what()).find("not found") != std::string::npos) {
                 return crow::response(404, "File not found.");
             }
@@ -214,7 +653,7 @@ int main() {
 
         crow::multipart::message multipart_data(req);
         std::string content_type_from_form;
-        crow::multipart::part* file_part = nullptr;
+        const crow::multipart::part* file_part = nullptr;
 
         for (const auto& part : multipart_data.parts) {
             if (part.get_name() == "file") {
@@ -259,11 +698,13 @@ int main() {
             response_json["size"] = updated_metadata.file_size_bytes;
             response_json["content_type"] = updated_metadata.content_type;
             response_json["created_at"] = updated_metadata.created_at;
+            response_json["version"] = updated_metadata.version;
+            response_json["merkle_root"] = updated_metadata.merkle_root;
             response_json["chunk_cids"] = crow::json::wvalue::list(updated_metadata.chunk_cids.begin(), updated_metadata.chunk_cids.end());
 
             return crow::response(200, response_json); // 200 OK for update
         } catch (const std::exception& e) {
-            std::cerr << "Error during file update: " << e.what() << std::endl;
+            FileManager::Logging::error("Error during file update", {{"error", e.what()}});
             fs::remove(temp_filepath); // Ensure temp file is cleaned up on error
             if (std::string(e.what()).find("not found") != std::string::npos) {
                 return crow::response(404, "File to update not found.");
@@ -272,12 +713,292 @@ int main() {
         }
     });
 
+    // --- Resumable uploads ---
+    // POST /uploads                        {"filename": "...", "content_type": "..."} -> session
+    // PATCH /uploads/<id>?offset=<n>       raw bytes of the file starting at byte n
+    // GET /uploads/<id>                    what has been received so far
+    // POST /uploads/<id>/finalize          create the file
+    // DELETE /uploads/<id>                 abort
+    // Parts are stored as they arrive, so a client that loses its connection asks for the
+    // received range and continues from there, even across server restarts.
+    auto upload_session_json = [](const FileManager::Metadata::UploadSession& session) {
+        crow::json::wvalue response_json;
+        response_json["id"] = session.id;
+        response_json["filename"] = session.original_filename;
+        response_json["content_type"] = session.content_type;
+        response_json["created_at"] = session.created_at;
+        response_json["received"] = session.received_bytes;
+        // Data is accepted in order, so the received range is always [0, received)
+        std::vector<crow::json::wvalue> ranges;
+        if (session.received_bytes > 0) {
+            crow::json::wvalue range;
+            range["start"] = 0;
+            range["end"] = session.received_bytes;
+            ranges.push_back(std::move(range));
+        }
+        response_json["ranges"] = std::move(ranges);
+        return response_json;
+    };
+
+    auto upload_session_error = [](const std::exception& e) {
+        std::string what = e.what();
+        FileManager::Logging::error("Upload session error", {{"error", what}});
+        if (what.find("not found") != std::string::npos) {
+            return crow::response(404, "Upload session not found.");
+        }
+        if (what.find("Offset mismatch") != std::string::npos) {
+            return crow::response(409, what); // 409 Conflict: resume from the received offset
+        }
+        return crow::response(500, "Internal Server Error: " + what);
+    };
+
+    CROW_ROUTE(app, "/uploads").methods("POST"_method)
+    ([fm_ptr, upload_session_json](const crow::request& req) {
+        std::string filename;
+        std::string content_type;
+        try {
+            crow::json::rvalue body = crow::json::load(req.body);
+            if (!body || !body.has("filename")) {
+                return crow::response(400, "Bad Request: Expected {\"filename\": \"...\"}.");
+            }
+            filename = std::string(body["filename"].s());
+            content_type = body.has("content_type") ? std::string(body["content_type"].s()) : getContentType(filename);
+        } catch (const std::exception&) {
+            return crow::response(400, "Bad Request: Expected {\"filename\": \"...\"}.");
+        }
+
+        try {
+            return crow::response(201, upload_session_json(fm_ptr->createUploadSession(filename, content_type)));
+        } catch (const std::exception& e) {
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    CROW_ROUTE(app, "/uploads/<string>").methods("PATCH"_method)
+    ([fm_ptr, upload_session_json, upload_session_error](const crow::request& req, std::string session_id) {
+        const char* offset_param = req.url_params.get("offset");
+        char* end = nullptr;
+        unsigned long long offset = offset_param != nullptr ? std::strtoull(offset_param, &end, 10) : 0;
+        if (offset_param == nullptr || *offset_param == '\0' || *end != '\0') {
+            return crow::response(400, "Bad Request: 'offset' query parameter missing or invalid.");
+        }
+
+        try {
+            FileManager::Metadata::UploadSession session =
+                fm_ptr->appendToUploadSession(session_id, offset, std::vector<char>(req.body.begin(), req.body.end()));
+            return crow::response(200, upload_session_json(session));
+        } catch (const std::exception& e) {
+            return upload_session_error(e);
+        }
+    });
+
+    CROW_ROUTE(app, "/uploads/<string>")
+    ([fm_ptr, upload_session_json, upload_session_error](const crow::request& req, std::string session_id) {
+        try {
+            return crow::response(200, upload_session_json(fm_ptr->getUploadSession(session_id)));
+        } catch (const std::exception& e) {
+            return upload_session_error(e);
+        }
+    });
+
+    CROW_ROUTE(app, "/uploads/<string>/finalize").methods("POST"_method)
+    ([fm_ptr, upload_session_error](const crow::request& req, std::string session_id) {
+        try {
+            FileManager::Metadata::FileMetadata metadata = fm_ptr->finalizeUploadSession(session_id);
+
+            crow::json::wvalue response_json;
+            response_json["filename"] = metadata.original_filename;
+            response_json["size"] = metadata.file_size_bytes;
+            response_json["content_type"] = metadata.content_type;
+            response_json["created_at"] = metadata.created_at;
+            response_json["version"] = metadata.version;
+            response_json["merkle_root"] = metadata.merkle_root;
+            response_json["chunk_cids"] = crow::json::wvalue::list(metadata.chunk_cids.begin(), metadata.chunk_cids.end());
+            return crow::response(201, response_json); // 201 Created
+        } catch (const std::exception& e) {
+            return upload_session_error(e);
+        }
+    });
+
+    CROW_ROUTE(app, "/uploads/<string>").methods("DELETE"_method)
+    ([fm_ptr, upload_session_error](const crow::request& req, std::string session_id) {
+        try {
+            fm_ptr->abortUploadSession(session_id);
+            return crow::response(204);
+        } catch (const std::exception& e) {
+            return upload_session_error(e);
+        }
+    });
+
+    // --- POST /dictionaries?content_type=<type>: Train a compression dictionary ---
+    // Trains a new zstd dictionary version from the chunks already stored for files of the given
+    // content type. Used for new chunks of that type when FM_COMPRESSION=zstd.
+    CROW_ROUTE(app, "/dictionaries").methods("POST"_method)
+    ([fm_ptr](const crow::request& req) {
+        const char* content_type = req.url_params.get("content_type");
+        if (content_type == nullptr || *content_type == '\0') {
+            return crow::response(400, "Bad Request: 'content_type' query parameter missing.");
+        }
+
+        try {
+            FileManager::Chunks::DictionaryStore::Info info = fm_ptr->trainDictionary(content_type);
+
+            crow::json::wvalue response_json;
+            response_json["id"] = info.id;
+            response_json["content_type"] = info.content_type;
+            response_json["version"] = info.version;
+            response_json["size"] = info.size;
+            return crow::response(201, response_json); // 201 Created
+        } catch (const std::exception& e) {
+            FileManager::Logging::error("Error training dictionary", {{"error", e.what()}});
+            if (std::string(e.what()).find("Not enough sample data") != std::string::npos) {
+                return crow::response(422, std::string(e.what()));
+            }
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    // --- GET /dictionaries: List trained compression dictionaries ---
+    CROW_ROUTE(app, "/dictionaries")
+    ([fm_ptr]() {
+        std::vector<crow::json::wvalue> entries;
+        for (const auto& info : fm_ptr->listDictionaries()) {
+            crow::json::wvalue entry;
+            entry["id"] = info.id;
+            entry["content_type"] = info.content_type;
+            entry["version"] = info.version;
+            entry["size"] = info.size;
+            entries.push_back(std::move(entry));
+        }
+        crow::json::wvalue response_json;
+        response_json["dictionaries"] = std::move(entries);
+        return crow::response(200, response_json);
+    });
+
+
+    // --- POST /gc: Run garbage collection now ---
+    // Chunks no longer used by any file are removed by a background collection every
+    // FM_GC_INTERVAL_S seconds; this runs one immediately and reports what it did.
+    CROW_ROUTE(app, "/gc").methods("POST"_method)
+    ([fm_ptr]() {
+        try {
+            FileManager::FileManager::GarbageCollectionStats stats = fm_ptr->collectGarbage();
+            crow::json::wvalue response_json;
+            response_json["live_chunks"] = stats.live_chunks;
+            response_json["stored_chunks"] = stats.stored_chunks;
+            response_json["deleted_chunks"] = stats.deleted_chunks;
+            response_json["bytes_freed"] = stats.bytes_freed;
+            response_json["skipped_recent"] = stats.skipped_recent;
+            response_json["skipped_referenced"] = stats.skipped_referenced;
+            response_json["seconds"] = stats.seconds;
+            return crow::response(200, response_json);
+        } catch (const std::exception& e) {
+            FileManager::Logging::error("Error during garbage collection", {{"error", e.what()}});
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    // --- POST /compact: Re-encode chunks stored with an outdated encoding now ---
+    // With FM_COMPRESSION=zstd, chunks stored with LZ4 or an older dictionary are re-encoded by
+    // a background compaction every FM_COMPACTION_INTERVAL_S seconds; this runs one immediately
+    // and reports what it did.
+    CROW_ROUTE(app, "/compact").methods("POST"_method)
+    ([fm_ptr]() {
+        try {
+            FileManager::FileManager::CompactionStats stats = fm_ptr->compactChunks();
+            crow::json::wvalue response_json;
+            response_json["stored_chunks"] = stats.stored_chunks;
+            response_json["stale_chunks"] = stats.stale_chunks;
+            response_json["rewritten_chunks"] = stats.rewritten_chunks;
+            response_json["bytes_before"] = stats.bytes_before;
+            response_json["bytes_after"] = stats.bytes_after;
+            response_json["skipped"] = stats.skipped;
+            response_json["seconds"] = stats.seconds;
+            return crow::response(200, response_json);
+        } catch (const std::exception& e) {
+            FileManager::Logging::error("Error during compaction", {{"error", e.what()}});
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    // --- POST /scrub: Run (or finish) an integrity scrub pass now ---
+    // Every stored chunk is re-hashed every FM_SCRUB_INTERVAL_S seconds in the background and
+    // chunks that no longer match their CID are quarantined; this runs a pass immediately (or
+    // finishes the one in progress) and reports what it did.
+    CROW_ROUTE(app, "/scrub").methods("POST"_method)
+    ([fm_ptr]() {
+        try {
+            FileManager::FileManager::ScrubStats stats = fm_ptr->scrubChunks();
+            crow::json::wvalue response_json;
+            response_json["checked_chunks"] = stats.checked_chunks;
+            response_json["checked_bytes"] = stats.checked_bytes;
+            response_json["corrupt_chunks"] = stats.corrupt_chunks;
+            response_json["skipped"] = stats.skipped;
+            response_json["resumed"] = stats.resumed;
+            response_json["pass_complete"] = stats.pass_complete;
+            response_json["seconds"] = stats.seconds;
+            return crow::response(200, response_json);
+        } catch (const std::exception& e) {
+            FileManager::Logging::error("Error during scrubbing", {{"error", e.what()}});
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    // --- GET /scrub: Integrity scrubber status ---
+    // The pass in progress (or the last one) and the CIDs of quarantined chunks.
+    CROW_ROUTE(app, "/scrub")
+    ([fm_ptr]() {
+        try {
+            FileManager::FileManager::ScrubStatus status = fm_ptr->getScrubStatus();
+            crow::json::wvalue response_json;
+            response_json["running"] = status.running;
+            response_json["in_progress"] = status.progress.in_progress;
+            response_json["position"] = status.progress.position;
+            response_json["pass_started_at"] = status.progress.pass_started_at;
+            response_json["checked_chunks"] = status.progress.checked_chunks;
+            response_json["checked_bytes"] = status.progress.checked_bytes;
+            response_json["corrupt_chunks"] = status.progress.corrupt_chunks;
+            response_json["passes_completed"] = status.progress.passes_completed;
+            response_json["last_pass_completed_at"] = status.progress.last_pass_completed_at;
+            std::vector<crow::json::wvalue> quarantined;
+            for (const auto& cid : status.quarantined) {
+                quarantined.emplace_back(cid);
+            }
+            response_json["quarantined"] = std::move(quarantined);
+            return crow::response(200, response_json);
+        } catch (const std::exception& e) {
+            FileManager::Logging::error("Error getting scrub status", {{"error", e.what()}});
+            return crow::response(500, "Internal Server Error: " + std::string(e.what()));
+        }
+    });
+
+    // --- GET /metrics: Prometheus metrics ---
+    // Per-stage latency histograms (fm_stage_duration_seconds), thread pool queue depth, chunk
+    // filter lookups, dedup and reference count counters, in the Prometheus text format.
+    CROW_ROUTE(app, "/metrics")
+    ([]() {
+        crow::response res(200, FileManager::Metrics::Registry::global().renderPrometheus());
+        res.set_header("Content-Type", "text/plain; version=0.0.4");
+        return res;
+    });
+
 
     // Start the Crow server on port 8080
     // Crow can bind to multiple ports or interfaces.
     // For local testing, 8080 is common.
-    std::cout << "Starting File Manager Service on http://localhost:8080" << std::endl;
-    app.port(8080).multithreaded().run(); // .multithreaded() makes Crow use multiple threads to handle requests
+    // Requests on different files don't contend (see FileLockManager), so the number of request
+    // threads can be raised past the core count with FM_HTTP_THREADS.
+    unsigned long long http_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (const char* value = std::getenv("FM_HTTP_THREADS")) {
+        unsigned long long parsed = std::strtoull(value, nullptr, 10);
+        if (parsed > 0 && parsed <= 65535) {
+            http_threads = parsed;
+        } else {
+            FileManager::Logging::warn("Ignoring invalid environment variable", {{"name", "FM_HTTP_THREADS"}, {"value", value}});
+        }
+    }
+    FileManager::Logging::info("Starting File Manager Service", {{"url", "http://localhost:8080"}, {"request_threads", http_threads}});
+    app.port(8080).concurrency(static_cast<std::uint16_t>(http_threads)).run();
 
     return 0;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "chunk.hpp"
 #include <fstream>
 #include <iostream> // For logging
+#include "zero_copy.hpp" // For ScopedFd
 
 namespace fs = std::filesystem;
 
@@ -10,34 +11,103 @@ namespace FileManager
     namespace Chunks
     {
 
-        bool Chunk::save(const Config::ChunkConfig &config)
+        namespace
+        {
+            // Decode stored chunk bytes, checking them against the CID when config.verify_on_read is set
+            std::vector<char> decodeChunk(const Config::ChunkConfig &config, const std::string &chunk_cid,
+                                          std::vector<char> stored, const DictionaryStore *dictionaries)
+            {
+                std::vector<char> data = ChunkCodec::decode(std::move(stored), dictionaries);
+                if (config.verify_on_read && CID::CIDUtility::generateSHA256(data) != chunk_cid)
+                {
+                    throw std::runtime_error("Chunk " + chunk_cid + " is corrupt: content does not match its CID.");
+                }
+                return data;
+            }
+        } // namespace
+
+        bool Chunk::save(const Config::ChunkConfig &config, ChunkFilter *filter) const
         {
             fs::path chunk_dir = config.getChunksDirPath();
             fs::path chunk_path = chunk_dir / cid;
 
-            if (fs::exists(chunk_path))
+            if ((filter == nullptr || filter->mightContain(cid)) && fs::exists(chunk_path))
             {
                 // Chunk already exists (deduplication)
                 // std::cout << "Chunk already exists, skipping save: " << cid << std::endl;
                 return true;
             }
 
-            std::ofstream ofs(chunk_path, std::ios::binary);
-            if (!ofs.is_open())
-            {
-                throw std::runtime_error("Failed to open file for writing chunk: " + chunk_path.string());
-            }
-            ofs.write(data.data(), data.size());
-            if (!ofs.good())
+            std::vector<char> encoded = ChunkCodec::encode(data, config);
+            const std::vector<char> &stored = encoded.empty() ? data : encoded;
+            IO::DurableFile::writeAtomically(chunk_path, stored.data(), stored.size());
+            if (filter != nullptr)
             {
-                throw std::runtime_error("Failed to write all data to chunk file: " + chunk_path.string());
+                filter->add(cid);
             }
-            ofs.close();
             // std::cout << "Chunk saved: " << cid << std::endl;
             return true;
         }
 
-        std::vector<char> Chunk::loadData(const Config::ChunkConfig &config, const std::string &chunk_cid)
+        std::future<bool> Chunk::writeAsync(const Config::ChunkConfig &config, IO::IoEngine &engine,
+                                            IO::GroupCommitter &committer, const std::vector<char> &encoded) const
+        {
+            const std::vector<char> &stored = encoded.empty() ? data : encoded;
+            fs::path final_path = getFullPath(config);
+            fs::path temp_path = IO::DurableFile::tempPathFor(final_path);
+            auto promise = std::make_shared<std::promise<bool>>();
+            std::future<bool> result = promise->get_future();
+
+            engine.submitWrite(temp_path, stored.data(), stored.size(),
+                               [promise, &committer, temp_path, final_path](std::exception_ptr error)
+                               {
+                                   if (error)
+                                   {
+                                       std::error_code ec;
+                                       fs::remove(temp_path, ec);
+                                       promise->set_exception(error);
+                                       return;
+                                   }
+                                   try
+                                   {
+                                       committer.commit(temp_path, final_path, [promise](std::exception_ptr commit_error)
+                                                        {
+                                                            if (commit_error)
+                                                                promise->set_exception(commit_error);
+                                                            else
+                                                                promise->set_value(true); });
+                                   }
+                                   catch (...)
+                                   {
+                                       std::error_code ec;
+                                       fs::remove(temp_path, ec);
+                                       promise->set_exception(std::current_exception());
+                                   }
+                               });
+            return result;
+        }
+
+        void Chunk::write(const Config::ChunkConfig &config, IO::GroupCommitter &committer,
+                          const std::vector<char> &encoded) const
+        {
+            const std::vector<char> &stored = encoded.empty() ? data : encoded;
+            fs::path final_path = getFullPath(config);
+            fs::path temp_path = IO::DurableFile::tempPathFor(final_path);
+            try
+            {
+                IO::ScopedFd::openForWrite(temp_path).writeAll(stored.data(), stored.size());
+            }
+            catch (...)
+            {
+                std::error_code ec;
+                fs::remove(temp_path, ec);
+                throw;
+            }
+            committer.commit(temp_path, final_path).get(); // Removes the temp file on failure
+        }
+
+        std::vector<char> Chunk::loadData(const Config::ChunkConfig &config, const std::string &chunk_cid,
+                                          const DictionaryStore *dictionaries)
         {
             fs::path chunk_dir = config.getChunksDirPath();
             fs::path chunk_path = chunk_dir / chunk_cid;
@@ -66,7 +136,20 @@ namespace FileManager
                 throw std::runtime_error("Failed to read all data from chunk file: " + chunk_path.string());
             }
             ifs.close();
-            return buffer;
+            return decodeChunk(config, chunk_cid, std::move(buffer), dictionaries);
+        }
+
+        std::future<std::vector<char>> Chunk::loadDataAsync(const Config::ChunkConfig &config, IO::IoEngine &engine,
+                                                            const std::string &chunk_cid,
+                                                            const DictionaryStore *dictionaries)
+        {
+            fs::path chunk_path = config.getChunksDirPath() / chunk_cid;
+            if (!fs::exists(chunk_path))
+            {
+                throw std::runtime_error("Chunk file not found: " + chunk_path.string());
+            }
+            return std::async(std::launch::deferred, [&config, chunk_cid, stored = engine.read(chunk_path), dictionaries]() mutable
+                              { return decodeChunk(config, chunk_cid, stored.get(), dictionaries); });
         }
 
         std::filesystem::path Chunk::getFullPath(const Config::ChunkConfig &config) const
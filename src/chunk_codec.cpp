@@ -0,0 +1,268 @@
+// src/chunk_codec.cpp
+#include "chunk_codec.hpp"
+#include <cmath>     // For std::log2
+#include <cstring>   // For std::memcmp, std::memcpy
+#include <memory>    // For std::unique_ptr
+#include <stdexcept> // For std::runtime_error
+
+#include <lz4.h>
+#include <zstd.h>
+
+namespace FileManager
+{
+    namespace Chunks
+    {
+
+        namespace
+        {
+            const char MAGIC[4] = {'\x89', 'F', 'M', 'C'};
+            const uint8_t FORMAT_VERSION = 1;
+
+            // Sanity limit on the uncompressed length recorded in a header
+            const uint64_t MAX_RAW_LENGTH = uint64_t(1) << 31;
+
+            // Entropy probe: sample this many windows of this many bytes
+            const size_t PROBE_WINDOWS = 8;
+            const size_t PROBE_WINDOW_SIZE = 512;
+            // Samples above this many bits per byte are treated as incompressible
+            const double INCOMPRESSIBLE_BITS_PER_BYTE = 7.5;
+
+            // zstd contexts are expensive to create; keep one per thread
+            struct ZstdCCtxDeleter
+            {
+                void operator()(ZSTD_CCtx *ctx) const { ZSTD_freeCCtx(ctx); }
+            };
+            struct ZstdDCtxDeleter
+            {
+                void operator()(ZSTD_DCtx *ctx) const { ZSTD_freeDCtx(ctx); }
+            };
+
+            ZSTD_CCtx *threadCCtx()
+            {
+                thread_local std::unique_ptr<ZSTD_CCtx, ZstdCCtxDeleter> ctx(ZSTD_createCCtx());
+                return ctx.get();
+            }
+
+            ZSTD_DCtx *threadDCtx()
+            {
+                thread_local std::unique_ptr<ZSTD_DCtx, ZstdDCtxDeleter> ctx(ZSTD_createDCtx());
+                return ctx.get();
+            }
+
+            bool startsWithMagic(const char *data, size_t size)
+            {
+                return size >= sizeof(MAGIC) && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+            }
+        } // namespace
+
+        std::vector<char> ChunkCodec::withHeader(Codec codec, uint64_t raw_length, size_t payload_capacity)
+        {
+            std::vector<char> out(HEADER_SIZE + payload_capacity);
+            std::memcpy(out.data(), MAGIC, sizeof(MAGIC));
+            out[4] = static_cast<char>(FORMAT_VERSION);
+            out[5] = static_cast<char>(codec);
+            out[6] = 0;
+            out[7] = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                out[8 + i] = static_cast<char>((raw_length >> (8 * i)) & 0xff);
+            }
+            return out;
+        }
+
+        std::vector<char> ChunkCodec::encode(const std::vector<char> &raw, const Config::ChunkConfig &config,
+                                             const ZstdDictionary *dictionary)
+        {
+            bool must_frame = startsWithMagic(raw.data(), raw.size());
+
+            if (config.compression != Config::ChunkConfig::Compression::None && looksCompressible(raw))
+            {
+                std::vector<char> out;
+                size_t payload = 0;
+
+                if (config.compression == Config::ChunkConfig::Compression::LZ4)
+                {
+                    int bound = LZ4_compressBound(static_cast<int>(raw.size()));
+                    out = withHeader(Codec::LZ4, raw.size(), static_cast<size_t>(bound));
+                    int written = LZ4_compress_default(raw.data(), out.data() + HEADER_SIZE,
+                                                       static_cast<int>(raw.size()), bound);
+                    payload = written > 0 ? static_cast<size_t>(written) : 0;
+                }
+                else
+                {
+                    size_t bound = ZSTD_compressBound(raw.size());
+                    out = withHeader(Codec::Zstd, raw.size(), bound);
+                    size_t written = dictionary != nullptr
+                                         ? ZSTD_compress_usingCDict(threadCCtx(), out.data() + HEADER_SIZE, bound,
+                                                                    raw.data(), raw.size(), dictionary->compressionDict())
+                                         : ZSTD_compressCCtx(threadCCtx(), out.data() + HEADER_SIZE, bound,
+                                                             raw.data(), raw.size(), config.zstd_level);
+                    payload = ZSTD_isError(written) ? 0 : written;
+                }
+
+                size_t stored = HEADER_SIZE + payload;
+                double saving = raw.empty() ? 0.0 : 1.0 - static_cast<double>(stored) / static_cast<double>(raw.size());
+                if (payload > 0 && saving >= config.min_compression_saving)
+                {
+                    out.resize(stored);
+                    return out;
+                }
+            }
+
+            if (must_frame)
+            {
+                std::vector<char> out = withHeader(Codec::None, raw.size(), raw.size());
+                std::memcpy(out.data() + HEADER_SIZE, raw.data(), raw.size());
+                return out;
+            }
+            return {}; // Store raw
+        }
+
+        std::optional<ChunkCodec::Header> ChunkCodec::parseHeader(const char *data, size_t size)
+        {
+            if (!startsWithMagic(data, size))
+            {
+                return std::nullopt;
+            }
+            if (size < HEADER_SIZE)
+            {
+                throw std::runtime_error("Corrupt chunk: truncated header.");
+            }
+            if (static_cast<uint8_t>(data[4]) != FORMAT_VERSION)
+            {
+                throw std::runtime_error("Corrupt chunk: unsupported format version " +
+                                         std::to_string(static_cast<uint8_t>(data[4])));
+            }
+
+            Header header;
+            uint8_t codec = static_cast<uint8_t>(data[5]);
+            if (codec > static_cast<uint8_t>(Codec::Zstd))
+            {
+                throw std::runtime_error("Corrupt chunk: unknown codec " + std::to_string(codec));
+            }
+            header.codec = static_cast<Codec>(codec);
+
+            header.raw_length = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                header.raw_length |= static_cast<uint64_t>(static_cast<uint8_t>(data[8 + i])) << (8 * i);
+            }
+            if (header.raw_length > MAX_RAW_LENGTH)
+            {
+                throw std::runtime_error("Corrupt chunk: implausible length " + std::to_string(header.raw_length));
+            }
+            return header;
+        }
+
+        uint32_t ChunkCodec::dictionaryId(const char *data, size_t size)
+        {
+            std::optional<Header> header = parseHeader(data, size);
+            if (!header || header->codec != Codec::Zstd)
+            {
+                return 0;
+            }
+            return ZSTD_getDictID_fromFrame(data + HEADER_SIZE, size - HEADER_SIZE);
+        }
+
+        std::vector<char> ChunkCodec::decode(std::vector<char> stored, const DictionaryStore *dictionaries)
+        {
+            std::optional<Header> header = parseHeader(stored.data(), stored.size());
+            if (!header)
+            {
+                return stored; // Raw chunk
+            }
+
+            const char *payload = stored.data() + HEADER_SIZE;
+            size_t payload_size = stored.size() - HEADER_SIZE;
+            std::vector<char> raw(static_cast<size_t>(header->raw_length));
+
+            switch (header->codec)
+            {
+            case Codec::None:
+                if (payload_size != raw.size())
+                {
+                    throw std::runtime_error("Corrupt chunk: length mismatch.");
+                }
+                std::memcpy(raw.data(), payload, payload_size);
+                break;
+            case Codec::LZ4:
+            {
+                int got = LZ4_decompress_safe(payload, raw.data(), static_cast<int>(payload_size),
+                                              static_cast<int>(raw.size()));
+                if (got < 0 || static_cast<size_t>(got) != raw.size())
+                {
+                    throw std::runtime_error("Corrupt chunk: LZ4 decompression failed.");
+                }
+                break;
+            }
+            case Codec::Zstd:
+            {
+                size_t got;
+                unsigned dictionary_id = ZSTD_getDictID_fromFrame(payload, payload_size);
+                if (dictionary_id != 0)
+                {
+                    std::shared_ptr<const ZstdDictionary> dictionary =
+                        dictionaries != nullptr ? dictionaries->find(dictionary_id) : nullptr;
+                    if (!dictionary)
+                    {
+                        throw std::runtime_error("Chunk needs zstd dictionary " + std::to_string(dictionary_id) +
+                                                 ", which is not available.");
+                    }
+                    got = ZSTD_decompress_usingDDict(threadDCtx(), raw.data(), raw.size(), payload, payload_size,
+                                                     dictionary->decompressionDict());
+                }
+                else
+                {
+                    got = ZSTD_decompressDCtx(threadDCtx(), raw.data(), raw.size(), payload, payload_size);
+                }
+                if (ZSTD_isError(got) || got != raw.size())
+                {
+                    throw std::runtime_error(std::string("Corrupt chunk: zstd decompression failed: ") +
+                                             (ZSTD_isError(got) ? ZSTD_getErrorName(got) : "length mismatch"));
+                }
+                break;
+            }
+            }
+            return raw;
+        }
+
+        bool ChunkCodec::looksCompressible(const std::vector<char> &raw)
+        {
+            if (raw.size() < 64)
+            {
+                return false; // Header overhead outweighs any gain
+            }
+
+            size_t histogram[256] = {};
+            size_t sampled = 0;
+            if (raw.size() <= PROBE_WINDOWS * PROBE_WINDOW_SIZE)
+            {
+                for (char c : raw)
+                    ++histogram[static_cast<uint8_t>(c)];
+                sampled = raw.size();
+            }
+            else
+            {
+                size_t stride = (raw.size() - PROBE_WINDOW_SIZE) / (PROBE_WINDOWS - 1);
+                for (size_t w = 0; w < PROBE_WINDOWS; ++w)
+                {
+                    const char *window = raw.data() + w * stride;
+                    for (size_t i = 0; i < PROBE_WINDOW_SIZE; ++i)
+                        ++histogram[static_cast<uint8_t>(window[i])];
+                }
+                sampled = PROBE_WINDOWS * PROBE_WINDOW_SIZE;
+            }
+
+            double entropy = 0.0;
+            for (size_t count : histogram)
+            {
+                if (count == 0)
+                    continue;
+                double p = static_cast<double>(count) / static_cast<double>(sampled);
+                entropy -= p * std::log2(p);
+            }
+            return entropy < INCOMPRESSIBLE_BITS_PER_BYTE;
+        }
+
+    } // namespace Chunks
+} // namespace FileManager
@@ -1,7 +1,11 @@
 // src/chunk_config.cpp
 #include "chunk_config.hpp"
-#include <iostream>  // For error logging (can be replaced by a proper logger)
+#include "logger.hpp"
 #include <stdexcept> // For std::runtime_error
+#include <cstdlib>   // For std::getenv, std::strtoull, std::strtol
+#include <algorithm> // For std::clamp
+#include <climits>   // For INT_MIN, INT_MAX
+#include <zstd.h>    // For ZSTD_minCLevel, ZSTD_maxCLevel
 
 namespace fs = std::filesystem;
 
@@ -10,6 +14,14 @@ namespace FileManager
     namespace Config
     {
 
+        const std::string ChunkConfig::CHUNKS_DIR_NAME = "chunks";
+        const std::string ChunkConfig::METADATA_DIR_NAME = "metadata";
+        const std::string ChunkConfig::VERSIONS_DIR_NAME = "versions";
+        const std::string ChunkConfig::DICTIONARIES_DIR_NAME = "dictionaries";
+        const std::string ChunkConfig::UPLOADS_DIR_NAME = "uploads";
+        const std::string ChunkConfig::DELETIONS_DIR_NAME = "deletions";
+        const std::string ChunkConfig::SCRUB_DIR_NAME = "scrub";
+
         fs::path ChunkConfig::ensureDirectoryExists(const std::string &dir_name)
         {
             // Get the current executable's path to make directories relative to it.
@@ -23,7 +35,7 @@ namespace FileManager
                 {
                     if (fs::create_directories(dir_path))
                     {
-                        std::cout << "Created directory: " << dir_path << std::endl;
+                        Logging::info("Created directory", {{"path", dir_path.string()}});
                     }
                     else
                     {
@@ -44,6 +56,121 @@ namespace FileManager
             return dir_path;
         }
 
+        namespace
+        {
+            // Overwrite `value` with an unsigned environment variable, if it is set and valid.
+            void readEnvSize(const char *name, size_t &value)
+            {
+                const char *raw = std::getenv(name);
+                if (raw == nullptr || *raw == '\0')
+                {
+                    return;
+                }
+                char *end = nullptr;
+                unsigned long long parsed = std::strtoull(raw, &end, 10);
+                if (*end != '\0')
+                {
+                    Logging::warn("Ignoring invalid environment variable", {{"name", name}, {"value", raw}});
+                    return;
+                }
+                value = static_cast<size_t>(parsed);
+            }
+
+            // Overwrite `value` with a signed environment variable, if it is set and valid.
+            void readEnvInt(const char *name, int &value)
+            {
+                const char *raw = std::getenv(name);
+                if (raw == nullptr || *raw == '\0')
+                {
+                    return;
+                }
+                char *end = nullptr;
+                long parsed = std::strtol(raw, &end, 10);
+                if (*end != '\0')
+                {
+                    Logging::warn("Ignoring invalid environment variable", {{"name", name}, {"value", raw}});
+                    return;
+                }
+                value = static_cast<int>(std::clamp<long>(parsed, INT_MIN, INT_MAX));
+            }
+        } // namespace
+
+        ChunkConfig ChunkConfig::fromEnvironment()
+        {
+            ChunkConfig config;
+            readEnvSize("FM_READ_AHEAD_CHUNKS", config.read_ahead_chunks);
+            readEnvSize("FM_MAX_OUTSTANDING_WRITES", config.max_outstanding_writes);
+            readEnvSize("FM_GROUP_COMMIT_WINDOW_US", config.group_commit_window_us);
+            readEnvSize("FM_GROUP_COMMIT_MAX_BATCH", config.group_commit_max_batch);
+
+            if (const char *durability = std::getenv("FM_DURABILITY"))
+            {
+                std::string value(durability);
+                if (value == "none")
+                    config.durability = Durability::None;
+                else if (value == "immediate")
+                    config.durability = Durability::Immediate;
+                else if (value == "group")
+                    config.durability = Durability::GroupCommit;
+                else if (!value.empty())
+                    Logging::warn("Ignoring invalid environment variable", {{"name", "FM_DURABILITY"}, {"value", value}});
+            }
+
+            if (const char *io_engine = std::getenv("FM_IO_ENGINE"))
+            {
+                std::string value(io_engine);
+                if (value == "auto")
+                    config.io_backend = IoBackend::Auto;
+                else if (value == "thread_pool")
+                    config.io_backend = IoBackend::ThreadPool;
+                else if (!value.empty())
+                    Logging::warn("Ignoring invalid environment variable", {{"name", "FM_IO_ENGINE"}, {"value", value}});
+            }
+
+            if (const char *compression = std::getenv("FM_COMPRESSION"))
+            {
+                std::string value(compression);
+                if (value == "none")
+                    config.compression = Compression::None;
+                else if (value == "lz4")
+                    config.compression = Compression::LZ4;
+                else if (value == "zstd")
+                    config.compression = Compression::Zstd;
+                else if (!value.empty())
+                    Logging::warn("Ignoring invalid environment variable", {{"name", "FM_COMPRESSION"}, {"value", value}});
+            }
+
+            // Negative levels are zstd's fast modes
+            readEnvInt("FM_ZSTD_LEVEL", config.zstd_level);
+            config.zstd_level = std::clamp(config.zstd_level, ZSTD_minCLevel(), ZSTD_maxCLevel());
+
+            readEnvSize("FM_DICTIONARY_SIZE", config.dictionary_size);
+            readEnvSize("FM_DICTIONARY_SAMPLE_BYTES", config.dictionary_sample_bytes);
+            readEnvSize("FM_DICTIONARY_AUTO_TRAIN_UPLOADS", config.dictionary_auto_train_uploads);
+            readEnvSize("FM_CHUNK_FILTER_CAPACITY", config.chunk_filter_capacity);
+            readEnvSize("FM_FILE_LOCK_STRIPES", config.file_lock_stripes);
+            readEnvSize("FM_FILE_VERSIONS_RETAINED", config.file_versions_retained);
+            readEnvSize("FM_GC_INTERVAL_S", config.gc_interval_s);
+            readEnvSize("FM_GC_GRACE_PERIOD_S", config.gc_grace_period_s);
+            readEnvSize("FM_GC_BATCH_SIZE", config.gc_batch_size);
+            readEnvSize("FM_GC_MAX_DELETES_PER_SECOND", config.gc_max_deletes_per_second);
+            readEnvSize("FM_DELETION_SEGMENT_BYTES", config.deletion_segment_bytes);
+            readEnvSize("FM_DELETION_BATCH_REFERENCES", config.deletion_batch_references);
+            readEnvSize("FM_DELETION_MAX_RELEASES_PER_SECOND", config.deletion_max_releases_per_second);
+            readEnvSize("FM_COMPACTION_INTERVAL_S", config.compaction_interval_s);
+            readEnvSize("FM_COMPACTION_MIN_SAVING_PERCENT", config.compaction_min_saving_percent);
+            readEnvSize("FM_COMPACTION_BATCH_SIZE", config.compaction_batch_size);
+            readEnvSize("FM_COMPACTION_MAX_BYTES_PER_SECOND", config.compaction_max_bytes_per_second);
+            readEnvSize("FM_SCRUB_INTERVAL_S", config.scrub_interval_s);
+            readEnvSize("FM_SCRUB_BATCH_SIZE", config.scrub_batch_size);
+            readEnvSize("FM_SCRUB_MAX_BYTES_PER_SECOND", config.scrub_max_bytes_per_second);
+
+            size_t verify_on_read = config.verify_on_read ? 1 : 0;
+            readEnvSize("FM_VERIFY_ON_READ", verify_on_read);
+            config.verify_on_read = verify_on_read != 0;
+            return config;
+        }
+
         fs::path ChunkConfig::getChunksDirPath()
         {
             return ensureDirectoryExists(CHUNKS_DIR_NAME);
@@ -54,5 +181,35 @@ namespace FileManager
             return ensureDirectoryExists(METADATA_DIR_NAME);
         }
 
+        fs::path ChunkConfig::getVersionsDirPath()
+        {
+            return ensureDirectoryExists(VERSIONS_DIR_NAME);
+        }
+
+        fs::path ChunkConfig::getDictionariesDirPath()
+        {
+            return ensureDirectoryExists(DICTIONARIES_DIR_NAME);
+        }
+
+        fs::path ChunkConfig::getUploadsDirPath()
+        {
+            return ensureDirectoryExists(UPLOADS_DIR_NAME);
+        }
+
+        fs::path ChunkConfig::getDeletionsDirPath()
+        {
+            return ensureDirectoryExists(DELETIONS_DIR_NAME);
+        }
+
+        fs::path ChunkConfig::getScrubDirPath()
+        {
+            return ensureDirectoryExists(SCRUB_DIR_NAME);
+        }
+
+        fs::path ChunkConfig::getQuarantineDirPath()
+        {
+            return ensureDirectoryExists(SCRUB_DIR_NAME + "/quarantine");
+        }
+
     } // namespace Config
 } // namespace FileManager
\ No newline at end of file
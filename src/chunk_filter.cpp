@@ -0,0 +1,131 @@
+// src/chunk_filter.cpp
+#include "chunk_filter.hpp"
+#include "cid_utility.hpp"   // For isValidCID
+#include "group_commit.hpp"  // For DurableFile::isTempFile
+#include "metrics.hpp"
+#include <algorithm>  // For std::max
+#include <functional> // For std::hash
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+namespace FileManager
+{
+    namespace Chunks
+    {
+
+        namespace
+        {
+            uint64_t parseHexWord(const std::string &hex, size_t offset)
+            {
+                uint64_t value = 0;
+                for (size_t i = offset; i < offset + 16; ++i)
+                {
+                    char c = hex[i];
+                    value = (value << 4) | static_cast<uint64_t>(c <= '9' ? c - '0' : c - 'a' + 10);
+                }
+                return value;
+            }
+
+            Metrics::Counter &absent_lookups = Metrics::Registry::global().counter(
+                "fm_chunk_filter_lookups_total", "Chunk filter lookups, by answer", {{"result", "absent"}});
+            Metrics::Counter &maybe_present_lookups = Metrics::Registry::global().counter(
+                "fm_chunk_filter_lookups_total", "Chunk filter lookups, by answer", {{"result", "maybe_present"}});
+        } // namespace
+
+        ChunkFilter::ChunkFilter(const fs::path &chunks_dir, size_t expected_chunks)
+        {
+            std::vector<std::string> stored;
+            std::error_code ec;
+            for (const auto &entry : fs::directory_iterator(chunks_dir, ec))
+            {
+                std::string name = entry.path().filename().string();
+                if (!IO::DurableFile::isTempFile(entry.path()) && CID::CIDUtility::isValidCID(name))
+                {
+                    stored.push_back(std::move(name));
+                }
+            }
+
+            capacity = std::max<size_t>({expected_chunks, stored.size() * 2, 1024});
+            counters = std::vector<std::atomic<uint8_t>>(capacity * COUNTERS_PER_CHUNK);
+            for (const std::string &cid : stored)
+            {
+                add(cid);
+            }
+            Logging::info("Chunk filter built", {{"chunks", stored.size()}, {"capacity", capacity}});
+        }
+
+        void ChunkFilter::slotsFor(const std::string &chunk_cid, size_t (&slots)[HASHES]) const
+        {
+            uint64_t h1, h2;
+            if (CID::CIDUtility::isValidCID(chunk_cid))
+            {
+                h1 = parseHexWord(chunk_cid, 0);
+                h2 = parseHexWord(chunk_cid, 16);
+            }
+            else
+            {
+                h1 = std::hash<std::string>{}(chunk_cid);
+                h2 = (h1 >> 17) | (h1 << 47);
+            }
+            h2 |= 1; // Odd stride, so the probes don't collapse onto one slot
+
+            for (size_t i = 0; i < HASHES; ++i)
+            {
+                slots[i] = static_cast<size_t>((h1 + i * h2) % counters.size());
+            }
+        }
+
+        void ChunkFilter::add(const std::string &chunk_cid)
+        {
+            size_t slots[HASHES];
+            slotsFor(chunk_cid, slots);
+            for (size_t slot : slots)
+            {
+                uint8_t value = counters[slot].load(std::memory_order_relaxed);
+                while (value != UINT8_MAX &&
+                       !counters[slot].compare_exchange_weak(value, value + 1, std::memory_order_release, std::memory_order_relaxed))
+                {
+                }
+            }
+            if (count.fetch_add(1, std::memory_order_relaxed) == capacity)
+            {
+                Logging::warn("Chunk filter is over capacity; raise FM_CHUNK_FILTER_CAPACITY to keep false positives low",
+                              {{"capacity", capacity}});
+            }
+        }
+
+        void ChunkFilter::remove(const std::string &chunk_cid)
+        {
+            size_t slots[HASHES];
+            slotsFor(chunk_cid, slots);
+            for (size_t slot : slots)
+            {
+                uint8_t value = counters[slot].load(std::memory_order_relaxed);
+                // Saturated counters have lost their true count, so they are never decremented
+                while (value != 0 && value != UINT8_MAX &&
+                       !counters[slot].compare_exchange_weak(value, value - 1, std::memory_order_release, std::memory_order_relaxed))
+                {
+                }
+            }
+            count.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        bool ChunkFilter::mightContain(const std::string &chunk_cid) const
+        {
+            size_t slots[HASHES];
+            slotsFor(chunk_cid, slots);
+            for (size_t slot : slots)
+            {
+                if (counters[slot].load(std::memory_order_acquire) == 0)
+                {
+                    absent_lookups.add();
+                    return false;
+                }
+            }
+            maybe_present_lookups.add();
+            return true;
+        }
+
+    } // namespace Chunks
+} // namespace FileManager
@@ -1,44 +1,68 @@
 // src/chunk_reference_manager.cpp
 #include "chunk_reference_manager.hpp"
-#include <iostream> // For logging
+#include "metrics.hpp"
+#include "logger.hpp"
 
 namespace FileManager
 {
     namespace Chunks
     {
 
+        namespace
+        {
+            Metrics::Histogram &refcount_seconds = Metrics::stageDuration("refcount");
+            Metrics::Counter &increments_total = Metrics::Registry::global().counter(
+                "fm_refcount_ops_total", "Chunk reference count updates, by direction", {{"op", "increment"}});
+            Metrics::Counter &decrements_total = Metrics::Registry::global().counter(
+                "fm_refcount_ops_total", "Chunk reference count updates, by direction", {{"op", "decrement"}});
+        } // namespace
+
         ChunkReferenceManager::ChunkReferenceManager()
         {
-            std::cout << "ChunkReferenceManager initialized." << std::endl;
+            Logging::debug("ChunkReferenceManager initialized");
             // In a real system, you might load saved counts from a persistent store here.
         }
 
-        void ChunkReferenceManager::increment(const std::string &chunk_cid)
+        int ChunkReferenceManager::increment(const std::string &chunk_cid)
         {
+            CID::BinaryCID key = CID::CIDUtility::toBinary(chunk_cid);
+            increments_total.add();
             std::lock_guard<std::mutex> lock(mtx);
-            reference_counts[chunk_cid]++;
-            // std::cout << "Incremented ref count for " << chunk_cid << ". New count: " << reference_counts[chunk_cid] << std::endl;
+            int count = ++reference_counts[key];
+            // std::cout << "Incremented ref count for " << chunk_cid << ". New count: " << count << std::endl;
+            return count;
         }
 
         int ChunkReferenceManager::decrement(const std::string &chunk_cid)
         {
+            CID::BinaryCID key = CID::CIDUtility::toBinary(chunk_cid);
+            decrements_total.add();
             std::lock_guard<std::mutex> lock(mtx);
-            auto it = reference_counts.find(chunk_cid);
+            auto it = reference_counts.find(key);
             if (it == reference_counts.end() || it->second <= 0)
             {
                 // This indicates an error state or a bug in logic
                 // std::cerr << "Warning: Attempted to decrement non-existent or zero-count chunk: " << chunk_cid << std::endl;
                 return 0; // Or throw an error depending on desired strictness
             }
-            it->second--;
-            // std::cout << "Decremented ref count for " << chunk_cid << ". New count: " << it->second << std::endl;
-            return it->second;
+            int count = --it->second;
+            if (count == 0)
+            {
+                reference_counts.erase(it);
+            }
+            // std::cout << "Decremented ref count for " << chunk_cid << ". New count: " << count << std::endl;
+            return count;
         }
 
         int ChunkReferenceManager::getCount(const std::string &chunk_cid) const
         {
+            if (!CID::CIDUtility::isValidCID(chunk_cid))
+            {
+                return 0;
+            }
+            CID::BinaryCID key = CID::CIDUtility::toBinary(chunk_cid);
             std::lock_guard<std::mutex> lock(mtx);
-            auto it = reference_counts.find(chunk_cid);
+            auto it = reference_counts.find(key);
             if (it == reference_counts.end())
             {
                 return 0;
@@ -46,5 +70,84 @@ namespace FileManager
             return it->second;
         }
 
+        ChunkReferenceManager::Deltas ChunkReferenceManager::diff(const std::vector<std::string> &old_cids,
+                                                                  const std::vector<std::string> &new_cids)
+        {
+            Deltas deltas;
+            deltas.reserve(old_cids.size() + new_cids.size());
+            for (const std::string &cid : new_cids)
+            {
+                ++deltas[CID::CIDUtility::toBinary(cid)];
+            }
+            for (const std::string &cid : old_cids)
+            {
+                auto it = deltas.emplace(CID::CIDUtility::toBinary(cid), 0).first;
+                if (--it->second == 0)
+                {
+                    deltas.erase(it); // Referenced as often before as after: unchanged
+                }
+            }
+            return deltas;
+        }
+
+        void ChunkReferenceManager::split(const Deltas &deltas, Deltas &increments, Deltas &decrements)
+        {
+            for (const auto &[cid, delta] : deltas)
+            {
+                (delta > 0 ? increments : decrements).emplace(cid, delta);
+            }
+        }
+
+        ChunkReferenceManager::Deltas ChunkReferenceManager::negate(const Deltas &deltas)
+        {
+            Deltas negated;
+            negated.reserve(deltas.size());
+            for (const auto &[cid, delta] : deltas)
+            {
+                negated.emplace(cid, -delta);
+            }
+            return negated;
+        }
+
+        ChunkReferenceManager::DeltaResult ChunkReferenceManager::applyDeltas(const Deltas &deltas)
+        {
+            Metrics::ScopedTimer timer(refcount_seconds); // Includes waiting for the lock
+            DeltaResult result;
+            uint64_t increments = 0;
+            uint64_t decrements = 0;
+            std::lock_guard<std::mutex> lock(mtx);
+            for (const auto &[cid, delta] : deltas)
+            {
+                if (delta > 0)
+                {
+                    ++increments;
+                    int &count = reference_counts[cid];
+                    if (count == 0)
+                    {
+                        result.referenced.push_back(CID::CIDUtility::toHex(cid));
+                    }
+                    count += static_cast<int>(delta);
+                }
+                else if (delta < 0)
+                {
+                    ++decrements;
+                    auto it = reference_counts.find(cid);
+                    if (it == reference_counts.end())
+                    {
+                        continue; // Nothing to release (e.g. counts lost in a restart)
+                    }
+                    it->second += static_cast<int>(delta);
+                    if (it->second <= 0)
+                    {
+                        reference_counts.erase(it);
+                        result.released.push_back(CID::CIDUtility::toHex(cid));
+                    }
+                }
+            }
+            increments_total.add(increments);
+            decrements_total.add(decrements);
+            return result;
+        }
+
     } // namespace Chunks
-} // namespace FileManager
\ No newline at end of file
+} // namespace FileManager
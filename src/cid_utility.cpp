@@ -56,5 +56,51 @@ namespace FileManager
             return ss.str();
         }
 
+        bool CIDUtility::isValidCID(const std::string &cid)
+        {
+            if (cid.size() != SHA256_DIGEST_LENGTH * 2)
+            {
+                return false;
+            }
+            for (char c : cid)
+            {
+                bool is_hex = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+                if (!is_hex)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        BinaryCID CIDUtility::toBinary(const std::string &cid)
+        {
+            if (!isValidCID(cid))
+            {
+                throw std::runtime_error("Invalid CID: " + cid);
+            }
+            auto nibble = [](char c)
+            { return static_cast<uint8_t>(c <= '9' ? c - '0' : c - 'a' + 10); };
+
+            BinaryCID binary;
+            for (size_t i = 0; i < binary.size(); ++i)
+            {
+                binary[i] = static_cast<uint8_t>((nibble(cid[2 * i]) << 4) | nibble(cid[2 * i + 1]));
+            }
+            return binary;
+        }
+
+        std::string CIDUtility::toHex(const BinaryCID &cid)
+        {
+            static const char digits[] = "0123456789abcdef";
+            std::string hex(cid.size() * 2, '0');
+            for (size_t i = 0; i < cid.size(); ++i)
+            {
+                hex[2 * i] = digits[cid[i] >> 4];
+                hex[2 * i + 1] = digits[cid[i] & 0x0f];
+            }
+            return hex;
+        }
+
     } // namespace CID
 } // namespace FileManager
\ No newline at end of file
@@ -0,0 +1,200 @@
+// src/deletion_journal.cpp
+#include "deletion_journal.hpp"
+#include "group_commit.hpp" // For DurableFile
+#include "logger.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm> // For std::max
+#include <cstdio>    // For std::snprintf
+#include <iterator>  // For std::next
+#include <fstream>
+#include <stdexcept> // For std::runtime_error
+
+namespace fs = std::filesystem;
+
+namespace FileManager {
+namespace Metadata {
+
+namespace {
+const std::string APPLIED_FILE_NAME = "applied.json";
+const std::string SEGMENT_EXTENSION = ".log";
+
+nlohmann::json recordToJson(const DeletionJournal::Record& r) {
+    return nlohmann::json{
+        {"seq", r.sequence},
+        {"filename", r.filename},
+        {"version", r.version},
+        {"created_at", r.created_at},
+        {"chunks", r.chunk_cids}
+    };
+}
+
+DeletionJournal::Record recordFromJson(const nlohmann::json& j) {
+    DeletionJournal::Record r;
+    j.at("seq").get_to(r.sequence);
+    j.at("filename").get_to(r.filename);
+    j.at("version").get_to(r.version);
+    j.at("created_at").get_to(r.created_at);
+    j.at("chunks").get_to(r.chunk_cids);
+    return r;
+}
+
+// Zero-padded so segments sort by name as well
+std::string segmentName(uint64_t first_sequence) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%020llu", static_cast<unsigned long long>(first_sequence));
+    return buf + SEGMENT_EXTENSION;
+}
+} // namespace
+
+DeletionJournal::DeletionJournal(const Config::ChunkConfig& config)
+    : dir(config.getDeletionsDirPath()),
+      segment_bytes(config.deletion_segment_bytes),
+      sync(config.durability != Config::ChunkConfig::Durability::None) {
+    load();
+}
+
+void DeletionJournal::load() {
+    IO::DurableFile::removeStaleTempFiles(dir);
+
+    std::ifstream applied_ifs(dir / APPLIED_FILE_NAME);
+    if (applied_ifs.is_open()) {
+        try {
+            nlohmann::json j;
+            applied_ifs >> j;
+            j.at("applied").get_to(applied);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Error parsing deletion journal " + (dir / APPLIED_FILE_NAME).string() + ": " + e.what());
+        }
+    }
+    next_sequence = applied + 1;
+
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        const fs::path& path = entry.path();
+        std::string stem = path.stem().string();
+        if (entry.is_regular_file() && path.extension() == SEGMENT_EXTENSION && !stem.empty() &&
+            stem.find_first_not_of("0123456789") == std::string::npos) {
+            segments.emplace(std::stoull(stem), path);
+        }
+    }
+
+    for (const auto& [first_sequence, path] : segments) {
+        std::ifstream ifs(path);
+        std::string line;
+        while (std::getline(ifs, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            Record record;
+            try {
+                record = recordFromJson(nlohmann::json::parse(line));
+            } catch (const std::exception& e) {
+                Logging::warn("Skipping damaged deletion journal entry", {{"path", path.string()}, {"error", e.what()}});
+                continue;
+            }
+            next_sequence = std::max(next_sequence, record.sequence + 1);
+            if (record.sequence > applied) {
+                records.push_back(std::move(record));
+            }
+        }
+    }
+    removeAppliedSegments();
+}
+
+uint64_t DeletionJournal::append(Record record) {
+    std::lock_guard<std::mutex> lock(mtx);
+    record.sequence = next_sequence;
+    std::string line = recordToJson(record).dump() + "\n";
+
+    if (!segment_fd.valid() || segment_size >= segment_bytes) {
+        startSegment(record.sequence);
+    }
+    try {
+        segment_fd.writeAll(line.data(), line.size());
+        if (sync) {
+            IO::DurableFile::syncData(segment_fd.get(), segments.rbegin()->second);
+        }
+    } catch (...) {
+        segment_fd = IO::ScopedFd(); // Don't append after a possibly torn line,
+        ++next_sequence;             // nor reuse its segment's name
+        throw;
+    }
+    segment_size += line.size();
+    ++next_sequence;
+    records.push_back(std::move(record));
+    return records.back().sequence;
+}
+
+std::vector<DeletionJournal::Record> DeletionJournal::pending(size_t max_references) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<Record> batch;
+    size_t references = 0;
+    for (const Record& record : records) {
+        if (!batch.empty() && references + record.chunk_cids.size() > max_references) {
+            break;
+        }
+        references += record.chunk_cids.size();
+        batch.push_back(record);
+    }
+    return batch;
+}
+
+size_t DeletionJournal::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return records.size();
+}
+
+void DeletionJournal::markApplied(uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (sequence <= applied) {
+        return;
+    }
+    while (!records.empty() && records.front().sequence <= sequence) {
+        records.pop_front();
+    }
+    applied = sequence;
+    saveApplied();
+    removeAppliedSegments();
+}
+
+void DeletionJournal::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    records.clear();
+    applied = next_sequence - 1;
+    saveApplied();
+    segment_fd = IO::ScopedFd();
+    removeAppliedSegments();
+}
+
+void DeletionJournal::startSegment(uint64_t first_sequence) {
+    fs::path path = dir / segmentName(first_sequence);
+    segment_fd = IO::ScopedFd::openForAppend(path);
+    segment_size = 0;
+    segments[first_sequence] = path;
+    if (sync) {
+        IO::DurableFile::syncDirectory(dir); // So the new segment itself survives a crash
+    }
+}
+
+void DeletionJournal::saveApplied() {
+    std::string contents = nlohmann::json{{"applied", applied}}.dump();
+    IO::DurableFile::writeAtomically(dir / APPLIED_FILE_NAME, contents.data(), contents.size());
+}
+
+void DeletionJournal::removeAppliedSegments() {
+    // A segment holds the sequences up to the next segment's first one. The segment being
+    // appended to is kept, as is any segment that may still hold pending records.
+    for (auto it = segments.begin(); it != segments.end();) {
+        auto next = std::next(it);
+        bool appending = segment_fd.valid() && next == segments.end();
+        uint64_t last_sequence = next != segments.end() ? next->first - 1 : next_sequence - 1;
+        if (appending || last_sequence > applied) {
+            break;
+        }
+        std::error_code ec;
+        fs::remove(it->second, ec);
+        it = segments.erase(it);
+    }
+}
+
+} // namespace Metadata
+} // namespace FileManager
@@ -0,0 +1,248 @@
+// src/dictionary_store.cpp
+#include "dictionary_store.hpp"
+#include "group_commit.hpp" // For DurableFile
+#include "logger.hpp"
+#include <fstream>
+#include <numeric>   // For std::accumulate
+#include <stdexcept> // For std::runtime_error
+#include <mutex>     // For std::unique_lock
+
+#include <zdict.h>
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+
+namespace FileManager
+{
+    namespace Chunks
+    {
+
+        namespace
+        {
+            const std::string DICTIONARY_EXTENSION = ".zdict";
+            const std::string INDEX_FILE_NAME = "index.json";
+
+            // zstd won't train on fewer samples than this
+            const size_t MIN_SAMPLES = 8;
+
+            std::vector<char> readFile(const fs::path &path)
+            {
+                std::ifstream ifs(path, std::ios::binary);
+                if (!ifs.is_open())
+                {
+                    throw std::runtime_error("Failed to open dictionary file: " + path.string());
+                }
+                return std::vector<char>((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            }
+        } // namespace
+
+        ZstdDictionary::ZstdDictionary(uint32_t id, std::string content_type, std::vector<char> bytes, int compression_level)
+            : id(id), content_type(std::move(content_type)), bytes(std::move(bytes))
+        {
+            cdict = ZSTD_createCDict(this->bytes.data(), this->bytes.size(), compression_level);
+            ddict = ZSTD_createDDict(this->bytes.data(), this->bytes.size());
+            if (cdict == nullptr || ddict == nullptr)
+            {
+                ZSTD_freeCDict(cdict);
+                ZSTD_freeDDict(ddict);
+                throw std::runtime_error("Failed to load zstd dictionary " + std::to_string(id));
+            }
+        }
+
+        ZstdDictionary::~ZstdDictionary()
+        {
+            ZSTD_freeCDict(cdict);
+            ZSTD_freeDDict(ddict);
+        }
+
+        DictionaryStore::DictionaryStore(const Config::ChunkConfig &config)
+            : dir(config.getDictionariesDirPath()),
+              compression_level(config.zstd_level),
+              max_dictionary_size(config.dictionary_size)
+        {
+            IO::DurableFile::removeStaleTempFiles(dir);
+
+            // Which content type each dictionary belongs to, in version order
+            fs::path index_path = dir / INDEX_FILE_NAME;
+            std::map<std::string, std::vector<uint32_t>> indexed;
+            std::unordered_map<uint32_t, std::string> type_of;
+            if (fs::exists(index_path))
+            {
+                try
+                {
+                    std::ifstream ifs(index_path);
+                    nlohmann::json j = nlohmann::json::parse(ifs);
+                    j.at("content_types").get_to(indexed);
+                }
+                catch (const std::exception &e)
+                {
+                    throw std::runtime_error("Error parsing dictionary index " + index_path.string() + ": " + e.what());
+                }
+                for (const auto &[content_type, ids] : indexed)
+                {
+                    for (uint32_t id : ids)
+                        type_of[id] = content_type;
+                }
+            }
+
+            // Load every dictionary file, indexed or not: chunks may have been written with a
+            // dictionary whose index update was lost in a crash.
+            for (const auto &entry : fs::directory_iterator(dir))
+            {
+                if (!entry.is_regular_file() || entry.path().extension() != DICTIONARY_EXTENSION)
+                {
+                    continue;
+                }
+                std::vector<char> bytes = readFile(entry.path());
+                uint32_t id = ZDICT_getDictID(bytes.data(), bytes.size());
+                if (id == 0)
+                {
+                    Logging::warn("Ignoring invalid zstd dictionary", {{"path", entry.path().string()}});
+                    continue;
+                }
+                auto type = type_of.find(id);
+                by_id[id] = std::make_shared<const ZstdDictionary>(
+                    id, type == type_of.end() ? std::string() : type->second, std::move(bytes), compression_level);
+            }
+
+            for (const auto &[content_type, ids] : indexed)
+            {
+                for (uint32_t id : ids)
+                {
+                    if (by_id.count(id))
+                        versions[content_type].push_back(id);
+                    else
+                        Logging::warn("Dictionary is missing", {{"dictionary_id", id}, {"content_type", content_type}});
+                }
+            }
+
+            if (!by_id.empty())
+            {
+                Logging::info("Loaded zstd dictionaries", {{"dictionaries", by_id.size()}});
+            }
+        }
+
+        std::shared_ptr<const ZstdDictionary> DictionaryStore::latest(const std::string &content_type) const
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = versions.find(content_type);
+            if (it == versions.end() || it->second.empty())
+            {
+                return nullptr;
+            }
+            return by_id.at(it->second.back());
+        }
+
+        std::shared_ptr<const ZstdDictionary> DictionaryStore::find(uint32_t id) const
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = by_id.find(id);
+            return it == by_id.end() ? nullptr : it->second;
+        }
+
+        DictionaryStore::Info DictionaryStore::train(const std::string &content_type,
+                                                     const std::vector<std::vector<char>> &samples)
+        {
+            if (samples.size() < MIN_SAMPLES)
+            {
+                throw std::runtime_error("Not enough sample data to train a dictionary for '" + content_type +
+                                         "': " + std::to_string(samples.size()) + " samples.");
+            }
+
+            // ZDICT takes the samples concatenated, plus their sizes
+            std::vector<char> sample_buffer;
+            std::vector<size_t> sample_sizes;
+            sample_buffer.reserve(std::accumulate(samples.begin(), samples.end(), size_t(0),
+                                                  [](size_t total, const std::vector<char> &s)
+                                                  { return total + s.size(); }));
+            for (const auto &sample : samples)
+            {
+                sample_buffer.insert(sample_buffer.end(), sample.begin(), sample.end());
+                sample_sizes.push_back(sample.size());
+            }
+
+            std::vector<char> bytes(max_dictionary_size);
+            size_t size = ZDICT_trainFromBuffer(bytes.data(), bytes.size(), sample_buffer.data(),
+                                                sample_sizes.data(), static_cast<unsigned>(sample_sizes.size()));
+            if (ZDICT_isError(size))
+            {
+                throw std::runtime_error("Failed to train dictionary for '" + content_type + "': " +
+                                         ZDICT_getErrorName(size));
+            }
+            bytes.resize(size);
+
+            uint32_t id = ZDICT_getDictID(bytes.data(), bytes.size());
+            auto dictionary = std::make_shared<const ZstdDictionary>(id, content_type, std::move(bytes), compression_level);
+
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            if (by_id.count(id))
+            {
+                // Ids are random; a clash is vanishingly rare, and the caller can simply retrain
+                throw std::runtime_error("Trained dictionary id " + std::to_string(id) + " is already in use.");
+            }
+
+            // Dictionary file first, then the index: a crash in between leaves an unindexed
+            // dictionary that is still loaded for decoding
+            fs::path path = dir / (std::to_string(id) + DICTIONARY_EXTENSION);
+            IO::DurableFile::writeAtomically(path, dictionary->bytes.data(), dictionary->bytes.size());
+            by_id[id] = dictionary;
+            versions[content_type].push_back(id);
+            try
+            {
+                saveIndex();
+            }
+            catch (...)
+            {
+                versions[content_type].pop_back();
+                throw;
+            }
+
+            Info info = infoFor(*dictionary);
+            Logging::info("Trained zstd dictionary", {{"dictionary_id", id},
+                                                      {"version", info.version},
+                                                      {"size", info.size},
+                                                      {"content_type", content_type},
+                                                      {"samples", samples.size()}});
+            return info;
+        }
+
+        std::vector<DictionaryStore::Info> DictionaryStore::list() const
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            std::vector<Info> infos;
+            for (const auto &[content_type, ids] : versions)
+            {
+                for (uint32_t id : ids)
+                    infos.push_back(infoFor(*by_id.at(id)));
+            }
+            return infos;
+        }
+
+        DictionaryStore::Info DictionaryStore::infoFor(const ZstdDictionary &dictionary) const
+        {
+            Info info;
+            info.id = dictionary.id;
+            info.content_type = dictionary.content_type;
+            info.size = dictionary.bytes.size();
+            auto it = versions.find(dictionary.content_type);
+            if (it != versions.end())
+            {
+                for (size_t i = 0; i < it->second.size(); ++i)
+                {
+                    if (it->second[i] == dictionary.id)
+                        info.version = i + 1;
+                }
+            }
+            return info;
+        }
+
+        void DictionaryStore::saveIndex() const
+        {
+            nlohmann::json j;
+            j["content_types"] = versions;
+            std::string contents = j.dump(4);
+            IO::DurableFile::writeAtomically(dir / INDEX_FILE_NAME, contents.data(), contents.size());
+        }
+
+    } // namespace Chunks
+} // namespace FileManager
@@ -0,0 +1,35 @@
+// src/file_lock_manager.cpp
+#include "file_lock_manager.hpp"
+#include <functional> // For std::hash
+#include <stdexcept>  // For std::runtime_error
+
+namespace FileManager
+{
+    namespace Concurrency
+    {
+
+        FileLockManager::FileLockManager(size_t num_stripes) : stripes(num_stripes)
+        {
+            if (num_stripes == 0)
+            {
+                throw std::runtime_error("FileLockManager cannot be initialized with 0 stripes.");
+            }
+        }
+
+        std::shared_lock<std::shared_mutex> FileLockManager::lockShared(const std::string &name)
+        {
+            return std::shared_lock<std::shared_mutex>(stripeFor(name));
+        }
+
+        std::unique_lock<std::shared_mutex> FileLockManager::lockExclusive(const std::string &name)
+        {
+            return std::unique_lock<std::shared_mutex>(stripeFor(name));
+        }
+
+        std::shared_mutex &FileLockManager::stripeFor(const std::string &name)
+        {
+            return stripes[std::hash<std::string>{}(name) % stripes.size()];
+        }
+
+    } // namespace Concurrency
+} // namespace FileManager
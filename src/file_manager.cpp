@@ -1,21 +1,162 @@
 // src/file_manager.cpp
 #include "file_manager.hpp"
+#include "metrics.hpp"
+#include "logger.hpp"
 #include <fstream>
-#include <iostream>
-#include <set>       // For updateFile comparison
-#include <algorithm> // For std::set_difference, std::remove
+#include <algorithm> // For std::min, std::max, std::copy, std::remove_if
+#include <unordered_set>
+#include <deque>
+#include <unistd.h> // For pread
 
 namespace fs = std::filesystem;
 
 namespace FileManager
 {
 
-    FileManager::FileManager(size_t num_threads) : thread_pool(num_threads)
+    namespace
     {
-        // Ensure base directories exist on startup
-        config.getChunksDirPath();
-        config.getMetadataDirPath();
-        std::cout << "FileManager initialized." << std::endl;
+        // Dictionary training samples are cut from chunks in slices of this size, close to the
+        // chunk sizes dictionaries help most with
+        const size_t DICTIONARY_SAMPLE_SLICE = 16 * 1024;
+
+        // Scrub batches queued on the pool at once; the position is saved as the oldest finishes
+        const size_t SCRUB_BATCHES_IN_FLIGHT = 4;
+
+        // Exported at GET /metrics (see Metrics::Registry)
+        Metrics::Histogram &read_seconds = Metrics::stageDuration("read");
+        Metrics::Histogram &hash_seconds = Metrics::stageDuration("hash");
+        Metrics::Histogram &dedup_check_seconds = Metrics::stageDuration("dedup_check");
+        Metrics::Histogram &compress_seconds = Metrics::stageDuration("compress");
+        Metrics::Histogram &chunk_write_seconds = Metrics::stageDuration("chunk_write");
+        Metrics::Histogram &metadata_save_seconds = Metrics::stageDuration("metadata_save");
+        Metrics::Histogram &chunk_read_seconds = Metrics::stageDuration("chunk_read");
+        Metrics::Histogram &chunk_copy_seconds = Metrics::stageDuration("chunk_copy");
+
+        Metrics::Histogram &operationDuration(const std::string &operation)
+        {
+            return Metrics::Registry::global().histogram("fm_operation_duration_seconds",
+                                                         "Duration of whole-file operations",
+                                                         {{"operation", operation}});
+        }
+        Metrics::Histogram &upload_seconds = operationDuration("upload");
+        Metrics::Histogram &download_seconds = operationDuration("download");
+        Metrics::Histogram &update_seconds = operationDuration("update");
+        Metrics::Histogram &patch_seconds = operationDuration("patch");
+        Metrics::Histogram &commit_seconds = operationDuration("commit");
+        Metrics::Histogram &delete_seconds = operationDuration("delete");
+
+        Metrics::Counter &chunksStored(const std::string &result)
+        {
+            return Metrics::Registry::global().counter("fm_chunks_stored_total",
+                                                       "Chunks stored, by whether they were written or already present",
+                                                       {{"result", result}});
+        }
+        Metrics::Counter &chunks_written = chunksStored("written");
+        Metrics::Counter &chunks_deduplicated = chunksStored("deduplicated");
+        Metrics::Counter &chunk_bytes_written = Metrics::Registry::global().counter(
+            "fm_chunk_bytes_written_total", "Bytes of chunk files written, after compression");
+        Metrics::Counter &gc_deleted_chunks = Metrics::Registry::global().counter(
+            "fm_gc_deleted_chunks_total", "Unreferenced chunks deleted by garbage collection");
+        Metrics::Counter &compaction_rewritten_chunks = Metrics::Registry::global().counter(
+            "fm_compaction_rewritten_chunks_total", "Chunks re-encoded by compaction");
+        Metrics::Counter &scrub_checked_chunks = Metrics::Registry::global().counter(
+            "fm_scrub_checked_chunks_total", "Chunks checked against their CID by the scrubber");
+        Metrics::Counter &scrub_corrupt_chunks = Metrics::Registry::global().counter(
+            "fm_scrub_corrupt_chunks_total", "Corrupt chunks found and quarantined by the scrubber");
+
+        // Chunk reads are served per request; log only a sample of them
+        Logging::Sampler chunk_log_sampler(100);
+    } // namespace
+
+    FileManager::FileManager(size_t num_threads, Config::ChunkConfig config)
+        : config(std::move(config)),
+          dictionaries(this->config),
+          chunk_filter(this->config.getChunksDirPath(), this->config.chunk_filter_capacity),
+          file_locks(this->config.file_lock_stripes),
+          deletion_journal(this->config),
+          thread_pool(num_threads),
+          committer(std::make_unique<IO::GroupCommitter>(this->config.durability,
+                                                         std::chrono::microseconds(this->config.group_commit_window_us),
+                                                         this->config.group_commit_max_batch)),
+          io_engine(IO::IoEngine::create(thread_pool, Config::ChunkConfig::IO_QUEUE_DEPTH,
+                                         this->config.io_backend == Config::ChunkConfig::IoBackend::Auto)),
+          gc_limiter(static_cast<double>(this->config.gc_max_deletes_per_second), static_cast<double>(this->config.gc_batch_size)),
+          deletion_limiter(static_cast<double>(this->config.deletion_max_releases_per_second),
+                           static_cast<double>(this->config.deletion_batch_references)),
+          compaction_limiter(static_cast<double>(this->config.compaction_max_bytes_per_second),
+                             static_cast<double>(Config::ChunkConfig::CHUNK_SIZE)),
+          scrub_limiter(static_cast<double>(this->config.scrub_max_bytes_per_second),
+                        static_cast<double>(Config::ChunkConfig::CHUNK_SIZE))
+    {
+        // Ensure base directories exist on startup, and drop writes interrupted by a crash
+        IO::DurableFile::removeStaleTempFiles(config.getChunksDirPath());
+        IO::DurableFile::removeStaleTempFiles(config.getMetadataDirPath());
+        for (const auto &entry : fs::directory_iterator(config.getVersionsDirPath()))
+        {
+            if (entry.is_directory())
+            {
+                IO::DurableFile::removeStaleTempFiles(entry.path());
+            }
+        }
+        recoverUploadSessions();
+        replayDeletions();
+        rebuildReferenceCounts();
+        deletion_journal.clear();
+        try
+        {
+            scrub_progress = Metadata::ScrubProgress::load(config);
+        }
+        catch (const std::exception &e)
+        {
+            Logging::error("Error loading scrub progress, starting over", {{"error", e.what()}});
+        }
+        for (std::string &cid : Metadata::ScrubProgress::listQuarantined(this->config))
+        {
+            if (!chunk_filter.mightContain(cid)) // Otherwise it was stored again since
+            {
+                quarantined_chunks.insert(std::move(cid));
+            }
+        }
+
+        deletion_thread = std::thread(&FileManager::deletionLoop, this);
+        if (this->config.gc_interval_s > 0)
+        {
+            gc_thread = std::thread(&FileManager::garbageCollectionLoop, this);
+        }
+        if (this->config.compaction_interval_s > 0)
+        {
+            compaction_thread = std::thread(&FileManager::compactionLoop, this);
+        }
+        if (this->config.scrub_interval_s > 0)
+        {
+            scrub_thread = std::thread(&FileManager::scrubLoop, this);
+        }
+        Logging::info("FileManager initialized");
+    }
+
+    FileManager::~FileManager()
+    {
+        {
+            std::lock_guard<std::mutex> lock(background_mutex);
+            stopping = true;
+        }
+        background_wakeup.notify_all();
+        if (gc_thread.joinable())
+        {
+            gc_thread.join();
+        }
+        if (compaction_thread.joinable())
+        {
+            compaction_thread.join();
+        }
+        if (scrub_thread.joinable())
+        {
+            scrub_thread.join();
+        }
+        if (deletion_thread.joinable())
+        {
+            deletion_thread.join();
+        }
     }
 
     // Helper to read file into chunks and generate their CIDs
@@ -40,11 +181,21 @@ namespace FileManager
 
         std::vector<char> buffer(Config::ChunkConfig::CHUNK_SIZE);
         size_t chunk_index = 0;
+        auto read_chunk = [&ifs, &buffer]()
+        {
+            Metrics::ScopedTimer timer(read_seconds);
+            return static_cast<bool>(ifs.read(buffer.data(), Config::ChunkConfig::CHUNK_SIZE));
+        };
+        auto hash_chunk = [&out_chunks](const std::vector<char> &data)
+        {
+            Metrics::ScopedTimer timer(hash_seconds);
+            out_chunks.emplace_back(data);
+        };
 
-        while (ifs.read(buffer.data(), Config::ChunkConfig::CHUNK_SIZE))
+        while (read_chunk())
         {
             // Full chunk read
-            out_chunks.emplace_back(buffer);
+            hash_chunk(buffer);
             hash_futures.push_back(thread_pool.enqueue([&out_chunks, idx = chunk_index]()
                                                        {
                                                            return out_chunks[idx].cid; // CID already calculated in Chunk constructor
@@ -56,7 +207,7 @@ namespace FileManager
         if (ifs.gcount() > 0)
         {
             buffer.resize(static_cast<size_t>(ifs.gcount()));
-            out_chunks.emplace_back(buffer);
+            hash_chunk(buffer);
             hash_futures.push_back(thread_pool.enqueue([&out_chunks, idx = chunk_index]()
                                                        { return out_chunks[idx].cid; }));
             chunk_index++;
@@ -78,7 +229,8 @@ namespace FileManager
         const std::string &original_filename,
         const std::string &content_type)
     {
-        std::cout << "Uploading file: " << original_filename << std::endl;
+        Logging::debug("Uploading file", {{"filename", original_filename}});
+        Metrics::ScopedTimer timer(upload_seconds);
         std::vector<Chunks::Chunk> chunks;
         std::vector<std::string> chunk_cids;
         uint64_t file_size = fs::file_size(input_filepath);
@@ -86,55 +238,102 @@ namespace FileManager
         // Process file into chunks and get their CIDs
         chunk_cids = processFileIntoChunks(input_filepath, chunks);
 
-        // Save unique chunks and increment reference counts
-        for (const auto &chunk : chunks)
-        {
-            // Check if chunk exists using the reference manager or by trying to load.
-            // A direct check `if (ref_manager.getCount(chunk.cid) == 0)` is efficient,
-            // but `chunk.save()` also handles `fs::exists` check internally.
-            // For robustness, ensure `save` only writes if not present.
-            chunk.save(config); // Save handles deduplication
-            ref_manager.increment(chunk.cid);
-        }
+        // Reference and persist chunks; everything is on disk before metadata is committed
+        storeChunks(chunks, content_type);
 
-        // Create and save metadata
+        // Create and save metadata, releasing the chunks of any file it replaces
         Metadata::FileMetadata metadata(original_filename, file_size, content_type, chunk_cids);
-        metadata.save(config);
+        try
+        {
+            replaceMetadata(metadata);
+        }
+        catch (...)
+        {
+            releaseChunkReferences(chunk_cids);
+            throw;
+        }
+        noteStoredFile(content_type);
 
-        std::cout << "File '" << original_filename << "' uploaded successfully." << std::endl;
+        Logging::info("File uploaded", {{"filename", original_filename},
+                                        {"size", file_size},
+                                        {"chunks", chunk_cids.size()},
+                                        {"latency_ms", timer.elapsedMilliseconds()}});
         return metadata;
     }
 
     // Corresponds to GET /files/{filename}
-    bool FileManager::retrieveFile(const std::string &original_filename, const std::string &output_filepath)
+    bool FileManager::retrieveFile(const std::string &original_filename, const std::string &output_filepath,
+                                   std::optional<uint64_t> version)
     {
-        std::cout << "Retrieving file: " << original_filename << std::endl;
+        Logging::debug("Retrieving file", {{"filename", original_filename}});
+        Metrics::ScopedTimer timer(download_seconds);
         try
         {
-            Metadata::FileMetadata metadata = Metadata::FileMetadata::load(config, original_filename);
+            // Held until the file is reassembled, so its chunks can't be released underneath us
+            auto file_lock = file_locks.lockShared(original_filename);
+            Metadata::FileMetadata metadata = version ? Metadata::FileMetadata::loadVersion(config, original_filename, *version)
+                                                      : Metadata::FileMetadata::load(config, original_filename);
 
-            std::ofstream ofs(output_filepath, std::ios::binary);
-            if (!ofs.is_open())
+            // Raw chunks are copied file-to-file with sendfile, so their bytes never enter user space.
+            IO::ScopedFd out_fd = IO::ScopedFd::openForWrite(output_filepath);
+            const std::vector<std::string> &cids = metadata.chunk_cids;
+            const size_t read_ahead = config.read_ahead_chunks;
+
+            if (read_ahead == 0)
             {
-                throw std::runtime_error("Failed to open output file for writing: " + output_filepath);
+                for (const std::string &cid : cids)
+                {
+                    OpenChunk chunk = openChunk(cid, false);
+                    writeChunkTo(out_fd, chunk);
+                }
             }
-
-            for (const std::string &cid : metadata.chunk_cids)
+            else
             {
-                std::vector<char> chunk_data = Chunks::Chunk::loadData(config, cid);
-                ofs.write(chunk_data.data(), chunk_data.size());
-                if (!ofs.good())
+                // Keep `read_ahead` chunks loading into the page cache on the pool while chunk N is
+                // copied out in order: never more than that besides the one being copied.
+                std::deque<std::future<OpenChunk>> loading;
+                size_t next_to_load = 0;
+                auto load_until = [&](size_t end)
+                {
+                    while (next_to_load < cids.size() && next_to_load < end)
+                    {
+                        const std::string &cid = cids[next_to_load++];
+                        loading.push_back(thread_pool.enqueue([this, &cid]()
+                                                              { return openChunk(cid, true); }));
+                    }
+                };
+                try
                 {
-                    throw std::runtime_error("Failed to write chunk data to output file during retrieval.");
+                    for (size_t i = 0; i < cids.size(); ++i)
+                    {
+                        load_until(i + 1); // Chunk i itself, on the first pass
+                        OpenChunk chunk = loading.front().get();
+                        loading.pop_front();
+                        load_until(i + 1 + read_ahead);
+                        writeChunkTo(out_fd, chunk);
+                    }
+                }
+                catch (...)
+                {
+                    // Outstanding loads reference `metadata`; let them finish before unwinding.
+                    // The one that failed was already consumed by get().
+                    for (auto &fut : loading)
+                    {
+                        if (fut.valid())
+                            fut.wait();
+                    }
+                    throw;
                 }
             }
-            ofs.close();
-            std::cout << "File '" << original_filename << "' retrieved to '" << output_filepath << "' successfully." << std::endl;
+            Logging::info("File retrieved", {{"filename", original_filename},
+                                             {"version", metadata.version},
+                                             {"chunks", cids.size()},
+                                             {"latency_ms", timer.elapsedMilliseconds()}});
             return true;
         }
         catch (const std::exception &e)
         {
-            std::cerr << "Error retrieving file '" << original_filename << "': " << e.what() << std::endl;
+            Logging::error("Error retrieving file", {{"filename", original_filename}, {"error", e.what()}});
             // Clean up partially written file if error occurs
             if (fs::exists(output_filepath))
             {
@@ -144,151 +343,2094 @@ namespace FileManager
         }
     }
 
+    // Corresponds to GET /files/{filename}/versions
+    std::vector<Metadata::FileMetadata> FileManager::listFileVersions(const std::string &original_filename)
+    {
+        auto file_lock = file_locks.lockShared(original_filename);
+        Metadata::FileMetadata current = Metadata::FileMetadata::load(config, original_filename);
+        std::vector<Metadata::FileMetadata> versions;
+        for (uint64_t version : Metadata::FileMetadata::listVersions(config, original_filename))
+        {
+            if (version < current.version)
+            {
+                versions.push_back(Metadata::FileMetadata::loadVersion(config, original_filename, version));
+            }
+        }
+        versions.push_back(std::move(current));
+        return versions;
+    }
+
+    // Metadata of the current or a past version of a file
+    Metadata::FileMetadata FileManager::getFileMetadata(const std::string &original_filename, std::optional<uint64_t> version)
+    {
+        auto file_lock = file_locks.lockShared(original_filename);
+        return version ? Metadata::FileMetadata::loadVersion(config, original_filename, *version)
+                       : Metadata::FileMetadata::load(config, original_filename);
+    }
+
+    // Corresponds to GET /files/{filename}/diff?against={other}
+    FileManager::FileDiff FileManager::diffFiles(const std::string &original_filename, std::optional<uint64_t> version,
+                                                 const std::string &other_filename, std::optional<uint64_t> other_version)
+    {
+        Metadata::FileMetadata metadata = getFileMetadata(original_filename, version);
+        Metadata::FileMetadata other = getFileMetadata(other_filename, other_version);
+
+        FileDiff diff;
+        diff.merkle_root = metadata.merkle_root;
+        diff.other_merkle_root = other.merkle_root;
+        diff.identical = metadata.merkle_root == other.merkle_root;
+        if (diff.identical)
+        {
+            return diff;
+        }
+
+        // Byte offsets come from the larger file's own chunk sizes: chunks committed from a
+        // manifest need not be CHUNK_SIZE bytes. Only the headers of the chunks up to the last
+        // differing one are read.
+        const Metadata::FileMetadata &larger = other.file_size_bytes > metadata.file_size_bytes ? other : metadata;
+        std::vector<uint64_t> chunk_offsets{0}; // chunk_offsets[i]: where chunk i of the larger file starts
+        auto offsetOf = [&](size_t index)
+        {
+            while (chunk_offsets.size() <= index && chunk_offsets.size() <= larger.chunk_cids.size())
+            {
+                chunk_offsets.push_back(chunk_offsets.back() + storedChunkSize(larger.chunk_cids[chunk_offsets.size() - 1]));
+            }
+            return std::min(chunk_offsets[std::min(index, chunk_offsets.size() - 1)], larger.file_size_bytes);
+        };
+
+        for (const auto &[first, end] : CID::MerkleTree::diff(CID::MerkleTree(metadata.chunk_cids),
+                                                             CID::MerkleTree(other.chunk_cids)))
+        {
+            FileDiff::Range range;
+            range.first_chunk = first;
+            range.end_chunk = end;
+            range.offset = offsetOf(first);
+            range.length = offsetOf(end) - range.offset;
+            diff.ranges.push_back(range);
+        }
+        return diff;
+    }
+
+    // Corresponds to GET /files/{filename}/proof?chunk={index}
+    FileManager::ChunkProof FileManager::getChunkProof(const std::string &original_filename, size_t index,
+                                                       std::optional<uint64_t> version)
+    {
+        Metadata::FileMetadata metadata = getFileMetadata(original_filename, version);
+        if (index >= metadata.chunk_cids.size())
+        {
+            throw std::runtime_error("Chunk " + std::to_string(index) + " of '" + original_filename + "' is out of range (" +
+                                     std::to_string(metadata.chunk_cids.size()) + " chunks).");
+        }
+
+        ChunkProof proof;
+        proof.chunk_cid = metadata.chunk_cids[index];
+        proof.index = index;
+        proof.chunk_count = metadata.chunk_cids.size();
+        proof.merkle_root = metadata.merkle_root;
+        for (const CID::BinaryCID &sibling : CID::MerkleTree(metadata.chunk_cids).proof(index))
+        {
+            proof.siblings.push_back(CID::CIDUtility::toHex(sibling));
+        }
+        return proof;
+    }
+
     // Corresponds to GET /chunks/{hash}
     std::vector<char> FileManager::retrieveChunk(const std::string &chunk_cid)
     {
-        std::cout << "Retrieving chunk: " << chunk_cid << std::endl;
+        Logging::info(chunk_log_sampler, "Retrieving chunk", {{"cid", chunk_cid}});
         try
         {
-            return Chunks::Chunk::loadData(config, chunk_cid);
+            return Chunks::Chunk::loadDataAsync(config, *io_engine, chunk_cid, &dictionaries).get();
         }
         catch (const std::exception &e)
         {
-            std::cerr << "Error retrieving chunk '" << chunk_cid << "': " << e.what() << std::endl;
+            Logging::error("Error retrieving chunk", {{"cid", chunk_cid}, {"error", e.what()}});
             throw; // Re-throw the exception for caller to handle
         }
     }
 
-    // Helper to delete a chunk file if its reference count reaches zero
-    bool FileManager::deleteChunkFileIfUnreferenced(const std::string &chunk_cid)
+    // Corresponds to GET /chunks/{hash} (served from disk)
+    fs::path FileManager::getChunkFilePath(const std::string &chunk_cid)
     {
-        if (ref_manager.decrement(chunk_cid) == 0)
+        // Reject anything that isn't a CID so clients can't address files outside the chunk store
+        if (!CID::CIDUtility::isValidCID(chunk_cid))
+        {
+            throw std::runtime_error("Chunk not found (invalid CID): " + chunk_cid);
+        }
+
+        // The filter goes first: building the path already stats the chunks directory
+        if (chunk_filter.mightContain(chunk_cid))
         {
             fs::path chunk_path = config.getChunksDirPath() / chunk_cid;
-            if (fs::exists(chunk_path))
+            if (fs::is_regular_file(chunk_path))
             {
-                try
+                return chunk_path;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(quarantine_mutex);
+            if (quarantined_chunks.count(chunk_cid))
+            {
+                throw std::runtime_error("Chunk " + chunk_cid + " is corrupt and was quarantined; store it again to repair it.");
+            }
+        }
+        throw std::runtime_error("Chunk file not found: " + chunk_cid);
+    }
+
+    // Corresponds to GET /chunks/{hash} (served from disk when stored raw)
+    std::optional<fs::path> FileManager::getRawChunkPath(const std::string &chunk_cid)
+    {
+        fs::path chunk_path = getChunkFilePath(chunk_cid);
+        if (config.verify_on_read)
+        {
+            return std::nullopt; // Must be read (and verified) through retrieveChunk
+        }
+        std::ifstream ifs(chunk_path, std::ios::binary);
+        char header[Chunks::ChunkCodec::HEADER_SIZE];
+        ifs.read(header, sizeof(header));
+        if (Chunks::ChunkCodec::parseHeader(header, static_cast<size_t>(ifs.gcount())))
+        {
+            return std::nullopt; // Stored compressed
+        }
+        return chunk_path;
+    }
+
+    // Helper to open a chunk for reassembly
+    FileManager::OpenChunk FileManager::openChunk(const std::string &chunk_cid, bool prefetch)
+    {
+        Metrics::ScopedTimer timer(chunk_read_seconds);
+        fs::path chunk_path = getChunkFilePath(chunk_cid);
+        OpenChunk chunk;
+        chunk.fd = IO::ScopedFd::openForRead(chunk_path);
+        chunk.size = fs::file_size(chunk_path);
+
+        char header[Chunks::ChunkCodec::HEADER_SIZE];
+        size_t header_size = static_cast<size_t>(std::min<uint64_t>(chunk.size, sizeof(header)));
+        if (::pread(chunk.fd.get(), header, header_size, 0) != static_cast<ssize_t>(header_size))
+        {
+            throw std::runtime_error("Failed to read chunk header: " + chunk_path.string());
+        }
+        if (config.verify_on_read || Chunks::ChunkCodec::parseHeader(header, header_size))
+        {
+            chunk.data = Chunks::Chunk::loadData(config, chunk_cid, &dictionaries);
+            chunk.decoded = true;
+            chunk.fd = IO::ScopedFd();
+            return chunk;
+        }
+
+        if (prefetch)
+        {
+            IO::ZeroCopy::prefetch(chunk.fd.get(), 0, chunk.size);
+        }
+        return chunk;
+    }
+
+    // Helper to append a chunk to a reassembled file
+    void FileManager::writeChunkTo(const IO::ScopedFd &out_fd, const OpenChunk &chunk)
+    {
+        Metrics::ScopedTimer timer(chunk_copy_seconds);
+        if (chunk.decoded)
+        {
+            out_fd.writeAll(chunk.data.data(), chunk.data.size());
+        }
+        else
+        {
+            IO::ZeroCopy::transfer(out_fd.get(), chunk.fd.get(), 0, chunk.size);
+        }
+    }
+
+    // Helper to reference and persist chunks
+    void FileManager::storeChunks(const std::vector<Chunks::Chunk> &chunks, const std::string &content_type,
+                                  const Chunks::ChunkReferenceManager::Deltas *references)
+    {
+        struct PendingWrite
+        {
+            const Chunks::Chunk *chunk;
+            std::promise<bool> done; // Published so concurrent uploads of the same chunk can wait on it
+            std::future<bool> io;
+            std::future<std::vector<char>> encoding;
+            std::vector<char> encoded; // Compressed bytes; must outlive `io`
+            bool already_stored = false; // Found on disk (stored before a restart); nothing to write
+            std::chrono::steady_clock::time_point issued; // When the write went to the I/O engine
+        };
+        std::vector<PendingWrite> writes;
+        std::vector<std::shared_future<bool>> waits;
+
+        // One reference per occurrence unless the caller says otherwise
+        Chunks::ChunkReferenceManager::Deltas occurrences;
+        if (references == nullptr)
+        {
+            occurrences = Chunks::ChunkReferenceManager::diff({}, chunkCids(chunks));
+            references = &occurrences;
+        }
+        std::unordered_map<std::string, const Chunks::Chunk *> chunk_by_cid;
+        for (const auto &chunk : chunks)
+        {
+            chunk_by_cid.emplace(chunk.cid, &chunk);
+        }
+
+        // Take the references first, in one batch: a referenced chunk can't be deleted underneath
+        // us, and the count tells us whether it is already stored without asking the filesystem.
+        // Done under the pending-writes lock so a concurrent upload sees either our in-flight
+        // write or the finished chunk.
+        const auto dedup_started = std::chrono::steady_clock::now();
+        uint64_t deduplicated = 0; // Chunks we take a reference to but don't write
+        {
+            std::lock_guard<std::mutex> lock(pending_writes_mutex);
+            Chunks::ChunkReferenceManager::DeltaResult taken = ref_manager.applyDeltas(*references);
+            std::unordered_set<std::string> first_referenced(taken.referenced.begin(), taken.referenced.end());
+            for (const auto &reference : *references)
+            {
+                std::string cid = CID::CIDUtility::toHex(reference.first);
+                auto pending = pending_chunk_writes.find(cid);
+                if (pending != pending_chunk_writes.end())
+                {
+                    waits.push_back(pending->second); // Stored by an upload that is still writing it
+                    deduplicated += reference.second > 0 ? 1 : 0;
+                }
+                else if (chunk_by_cid.count(cid) && (first_referenced.count(cid) || !chunk_filter.mightContain(cid)))
                 {
-                    fs::remove(chunk_path);
-                    std::cout << "Deleted unreferenced chunk file: " << chunk_path << std::endl;
-                    return true;
+                    // First reference: nobody has it stored, we write it. Referenced chunks the
+                    // filter doesn't know were quarantined by the scrubber; writing them repairs them.
+                    writes.emplace_back();
+                    writes.back().chunk = chunk_by_cid.at(cid);
+                    pending_chunk_writes[cid] = writes.back().done.get_future().share();
                 }
-                catch (const fs::filesystem_error &e)
+                else if (reference.second > 0)
                 {
-                    std::cerr << "Error deleting chunk file " << chunk_path << ": " << e.what() << std::endl;
-                    return false; // Deletion failed
+                    ++deduplicated;
                 }
             }
+        }
+
+        // A first reference doesn't prove the chunk is new: unreferenced chunks stay stored until
+        // garbage collection (released ones, PUT /chunks uploads not yet committed). The filter
+        // proves it for most chunks; only possible hits are stat'ed.
+        for (PendingWrite &write : writes)
+        {
+            if (chunk_filter.mightContain(write.chunk->cid) && fs::is_regular_file(write.chunk->getFullPath(config)))
+            {
+                write.already_stored = true;
+                write.done.set_value(true);
+                ++deduplicated;
+            }
+        }
+        dedup_check_seconds.observe(std::chrono::steady_clock::now() - dedup_started);
+        chunks_deduplicated.add(deduplicated);
+
+        // Compress on the pool in parallel; writes are issued in order as encodings complete
+        std::shared_ptr<const Chunks::ZstdDictionary> dictionary;
+        if (config.compression == Config::ChunkConfig::Compression::Zstd)
+        {
+            dictionary = dictionaries.latest(content_type);
+        }
+        for (PendingWrite &write : writes)
+        {
+            const Chunks::Chunk *chunk = write.chunk;
+            if (write.already_stored)
+            {
+                continue;
+            }
+            if (config.compression == Config::ChunkConfig::Compression::None)
+            {
+                std::promise<std::vector<char>> inline_encoding; // Cheap: only checks for the header magic
+                inline_encoding.set_value(Chunks::ChunkCodec::encode(chunk->data, config));
+                write.encoding = inline_encoding.get_future();
+            }
             else
             {
-                // Chunk file not found, but ref count was 0. Might be an inconsistency.
-                std::cerr << "Warning: Chunk file " << chunk_path << " not found, but ref count was 0. Inconsistency?" << std::endl;
-                return false;
+                write.encoding = thread_pool.enqueue([this, chunk, dictionary]()
+                                                     {
+                                                         Metrics::ScopedTimer timer(compress_seconds);
+                                                         return Chunks::ChunkCodec::encode(chunk->data, config, dictionary.get()); });
             }
         }
-        return false; // Chunk not deleted because it's still referenced
-    }
 
-    // Corresponds to DELETE /files/{filename}
-    bool FileManager::deleteFile(const std::string &original_filename)
-    {
-        std::cout << "Deleting file: " << original_filename << std::endl;
-        try
+        std::exception_ptr first_error;
+        auto finish_write = [this, &first_error](PendingWrite &write)
         {
-            Metadata::FileMetadata metadata = Metadata::FileMetadata::load(config, original_filename);
+            if (write.already_stored)
+            {
+                return;
+            }
+            try
+            {
+                write.io.get();
+                chunk_write_seconds.observe(std::chrono::steady_clock::now() - write.issued);
+                chunks_written.add();
+                chunk_bytes_written.add(write.encoded.empty() ? write.chunk->data.size() : write.encoded.size());
+                chunk_filter.add(write.chunk->cid); // Before waiters can look it up
+                forgetQuarantined(write.chunk->cid);
+                write.done.set_value(true);
+            }
+            catch (...)
+            {
+                write.done.set_exception(std::current_exception());
+                if (!first_error)
+                    first_error = std::current_exception();
+            }
+        };
 
-            // Decrement reference counts for all associated chunks
-            // And delete chunk files if their count drops to zero
-            for (const std::string &cid : metadata.chunk_cids)
+        // Fan the writes out through the I/O engine with a bounded number outstanding
+        const size_t max_outstanding = std::max<size_t>(1, config.max_outstanding_writes);
+        size_t oldest = 0;
+        for (size_t i = 0; i < writes.size(); ++i)
+        {
+            if (i - oldest >= max_outstanding)
             {
-                deleteChunkFileIfUnreferenced(cid);
+                finish_write(writes[oldest++]);
             }
+            if (writes[i].already_stored)
+            {
+                continue;
+            }
+            try
+            {
+                writes[i].encoded = writes[i].encoding.get();
+                writes[i].issued = std::chrono::steady_clock::now();
+                writes[i].io = writes[i].chunk->writeAsync(config, *io_engine, *committer, writes[i].encoded);
+            }
+            catch (...)
+            {
+                std::promise<bool> failed;
+                failed.set_exception(std::current_exception());
+                writes[i].io = failed.get_future();
+            }
+        }
 
-            // Delete the metadata file
-            fs::path metadata_path = metadata.getFullPath(config);
-            if (fs::exists(metadata_path))
+        // Single completion barrier (the engine references chunk data until then)
+        for (; oldest < writes.size(); ++oldest)
+        {
+            finish_write(writes[oldest]);
+        }
+        for (auto &fut : waits)
+        {
+            try
             {
-                fs::remove(metadata_path);
-                std::cout << "Deleted metadata file: " << metadata_path << std::endl;
+                fut.get();
             }
-            else
+            catch (...)
             {
-                std::cerr << "Warning: Metadata file for '" << original_filename << "' not found during deletion." << std::endl;
+                if (!first_error)
+                    first_error = std::current_exception();
             }
+        }
 
-            std::cout << "File '" << original_filename << "' deleted successfully." << std::endl;
-            return true;
+        {
+            std::lock_guard<std::mutex> lock(pending_writes_mutex);
+            for (const PendingWrite &write : writes)
+            {
+                pending_chunk_writes.erase(write.chunk->cid);
+            }
         }
-        catch (const std::exception &e)
+
+        if (first_error)
         {
-            std::cerr << "Error deleting file '" << original_filename << "': " << e.what() << std::endl;
-            return false;
+            ref_manager.applyDeltas(Chunks::ChunkReferenceManager::negate(*references));
+            std::rethrow_exception(first_error);
         }
     }
 
-    // Corresponds to PUT /files/{filename}
-    Metadata::FileMetadata FileManager::updateFile(
-        const std::string &original_filename,
-        const std::string &updated_filepath,
-        const std::string &new_content_type)
+    // Helper to save metadata that may replace an existing file
+    void FileManager::replaceMetadata(Metadata::FileMetadata &metadata)
     {
-        std::cout << "Updating file: " << original_filename << std::endl;
-        Metadata::FileMetadata old_metadata;
+        auto file_lock = file_locks.lockExclusive(metadata.original_filename);
+        std::optional<Metadata::FileMetadata> previous;
         try
         {
-            old_metadata = Metadata::FileMetadata::load(config, original_filename);
+            previous = Metadata::FileMetadata::load(config, metadata.original_filename);
         }
-        catch (const std::exception &e)
+        catch (const std::exception &)
         {
-            throw std::runtime_error("Cannot update file: Original metadata not found for '" + original_filename + "'. " + e.what());
         }
 
-        std::vector<Chunks::Chunk> new_file_chunks;
-        std::vector<std::string> new_chunk_cids = processFileIntoChunks(updated_filepath, new_file_chunks);
-        uint64_t new_file_size = fs::file_size(updated_filepath);
+        std::vector<Metadata::FileMetadata> dropped = versionsToDrop(previous);
+        commitVersion(metadata, previous, dropped);
+        releaseChunkReferences(versionCids(dropped));
+    }
+
+    // Helper to find the versions of a file that fall out of the history
+    std::vector<Metadata::FileMetadata> FileManager::versionsToDrop(const std::optional<Metadata::FileMetadata> &previous)
+    {
+        std::vector<Metadata::FileMetadata> dropped;
+        if (!previous)
+        {
+            return dropped;
+        }
 
-        // Identify chunks that are in the old file but not in the new one (to be potentially deleted)
-        // and chunks that are in the new file but not in the old one (to be added/referenced).
-        std::set<std::string> old_cids_set(old_metadata.chunk_cids.begin(), old_metadata.chunk_cids.end());
-        std::set<std::string> new_cids_set(new_chunk_cids.begin(), new_chunk_cids.end());
+        // Oldest first, with `previous` as the newest past version. A past version numbered like
+        // the current one is left from a crash in commitVersion and is overwritten anyway.
+        std::vector<uint64_t> versions = Metadata::FileMetadata::listVersions(config, previous->original_filename);
+        versions.erase(std::remove_if(versions.begin(), versions.end(), [&](uint64_t v)
+                                      { return v >= previous->version; }),
+                       versions.end());
+        versions.push_back(previous->version);
+        const size_t excess = versions.size() > config.file_versions_retained ? versions.size() - config.file_versions_retained : 0;
+        for (size_t i = 0; i < excess; ++i)
+        {
+            if (versions[i] == previous->version)
+            {
+                dropped.push_back(*previous);
+                continue;
+            }
+            try
+            {
+                dropped.push_back(Metadata::FileMetadata::loadVersion(config, previous->original_filename, versions[i]));
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error loading version to drop it", {{"filename", previous->original_filename},
+                                                                    {"version", versions[i]},
+                                                                    {"error", e.what()}});
+            }
+        }
+        return dropped;
+    }
 
-        std::vector<std::string> cids_to_decrement;
-        std::vector<std::string> cids_to_increment; // These are CIDs that are truly new or reused.
+    // Helper to make metadata the current version of its file
+    void FileManager::commitVersion(Metadata::FileMetadata &metadata, const std::optional<Metadata::FileMetadata> &previous,
+                                    const std::vector<Metadata::FileMetadata> &dropped)
+    {
+        Metrics::ScopedTimer timer(metadata_save_seconds);
+        metadata.version = previous ? previous->version + 1 : 1;
+        metadata.merkle_root = CID::MerkleTree::rootOf(metadata.chunk_cids);
+        bool keep_previous = previous.has_value();
+        for (const auto &version : dropped)
+        {
+            keep_previous = keep_previous && version.version != previous->version;
+        }
 
-        // Chunks to decrement: In old set, not in new set
-        std::set_difference(old_cids_set.begin(), old_cids_set.end(),
-                            new_cids_set.begin(), new_cids_set.end(),
-                            std::back_inserter(cids_to_decrement));
+        // Past version first: a crash in between leaves an extra past version, never a lost one
+        if (keep_previous)
+        {
+            previous->saveVersion(config, committer.get());
+        }
+        metadata.save(config, committer.get()); // Atomically replaces the old metadata file
+        for (const auto &version : dropped)
+        {
+            if (!previous || version.version != previous->version)
+            {
+                Metadata::FileMetadata::removeVersion(config, metadata.original_filename, version.version);
+            }
+        }
+    }
 
-        // Chunks to increment: In new set, not in old set
-        // Or, if a chunk is in *both* old and new, its reference count doesn't change relative to this file.
-        // So, we only need to increment for *new* chunks.
-        // The `new_file_chunks` list already contains all chunks in the new file.
-        // The `uploadFile` logic (which `processFileIntoChunks` precedes) already handles saving/incrementing.
-        // So, we just need to save the new chunks and increment their ref counts.
+    // Helper to concatenate the chunk CIDs of several versions
+    std::vector<std::string> FileManager::versionCids(const std::vector<Metadata::FileMetadata> &versions)
+    {
+        std::vector<std::string> cids;
+        for (const auto &version : versions)
+        {
+            cids.insert(cids.end(), version.chunk_cids.begin(), version.chunk_cids.end());
+        }
+        return cids;
+    }
 
-        // Save new chunks and increment their reference counts
-        for (const auto &chunk : new_file_chunks)
+    // Helper to get the uncompressed size of a stored chunk
+    uint64_t FileManager::storedChunkSize(const std::string &chunk_cid)
+    {
+        fs::path chunk_path = getChunkFilePath(chunk_cid);
+        std::ifstream ifs(chunk_path, std::ios::binary);
+        char header[Chunks::ChunkCodec::HEADER_SIZE];
+        ifs.read(header, sizeof(header));
+        if (auto parsed = Chunks::ChunkCodec::parseHeader(header, static_cast<size_t>(ifs.gcount())))
         {
-            // If the chunk is truly new (not in the old file, or just re-appearing), save and increment.
-            // `chunk.save` handles if it's already on disk.
-            // We always increment for chunks in the new file, then decrement for old file's chunks.
-            chunk.save(config);
-            ref_manager.increment(chunk.cid);
+            return parsed->raw_length;
         }
+        return fs::file_size(chunk_path);
+    }
 
-        // Decrement reference counts for chunks that are no longer part of this file
-        for (const std::string &cid : cids_to_decrement)
+    // Helper to collect the CIDs of chunks, in order
+    std::vector<std::string> FileManager::chunkCids(const std::vector<Chunks::Chunk> &chunks)
+    {
+        std::vector<std::string> cids;
+        cids.reserve(chunks.size());
+        for (const auto &chunk : chunks)
         {
-            deleteChunkFileIfUnreferenced(cid);
+            cids.push_back(chunk.cid);
         }
+        return cids;
+    }
 
-        // Create and save the updated metadata
-        Metadata::FileMetadata updated_metadata(original_filename, new_file_size, new_content_type, new_chunk_cids);
-        updated_metadata.save(config); // This will overwrite the old metadata file
+    // Helper to release references in one batch. Chunk files are only removed by collectGarbage,
+    // so this costs no filesystem work.
+    void FileManager::releaseChunkReferences(const Chunks::ChunkReferenceManager::Deltas &decrements)
+    {
+        ref_manager.applyDeltas(decrements);
+    }
 
-        std::cout << "File '" << original_filename << "' updated successfully." << std::endl;
-        return updated_metadata;
+    void FileManager::releaseChunkReferences(const std::vector<std::string> &chunk_cids)
+    {
+        releaseChunkReferences(Chunks::ChunkReferenceManager::diff(chunk_cids, {}));
+    }
+
+    // Corresponds to POST /gc
+    FileManager::GarbageCollectionStats FileManager::collectGarbage()
+    {
+        std::lock_guard<std::mutex> gc_lock(gc_mutex);
+        const auto started = std::chrono::steady_clock::now();
+        GarbageCollectionStats stats;
+        drainDeletions();
+
+        std::unordered_set<CID::BinaryCID, CID::BinaryCIDHash> live = markLiveChunks();
+        stats.live_chunks = live.size();
+
+        // Unmarked chunks past the grace period are candidates; temp files aren't valid CIDs
+        const auto cutoff = fs::file_time_type::clock::now() - std::chrono::seconds(config.gc_grace_period_s);
+        std::vector<std::string> candidates;
+        for (const auto &entry : fs::directory_iterator(config.getChunksDirPath()))
+        {
+            std::string cid = entry.path().filename().string();
+            if (!entry.is_regular_file() || !CID::CIDUtility::isValidCID(cid))
+            {
+                continue;
+            }
+            ++stats.stored_chunks;
+            if (live.count(CID::CIDUtility::toBinary(cid)))
+            {
+                continue;
+            }
+            std::error_code ec;
+            fs::file_time_type modified = entry.last_write_time(ec);
+            if (ec || modified > cutoff)
+            {
+                ++stats.skipped_recent;
+                continue;
+            }
+            candidates.push_back(std::move(cid));
+        }
+
+        // Sweep in batches on the pool, paced by the rate limiter
+        const size_t batch_size = std::max<size_t>(1, config.gc_batch_size);
+        std::vector<std::future<GarbageCollectionStats>> batches;
+        for (size_t begin = 0; begin < candidates.size() && !stopping; begin += batch_size)
+        {
+            size_t end = std::min(begin + batch_size, candidates.size());
+            gc_limiter.acquire(static_cast<double>(end - begin));
+            batches.push_back(thread_pool.enqueue([this, &candidates, begin, end]()
+                                                  { return sweepChunks(candidates, begin, end); }));
+        }
+        for (auto &batch : batches)
+        {
+            GarbageCollectionStats swept = batch.get(); // sweepChunks doesn't throw
+            stats.deleted_chunks += swept.deleted_chunks;
+            gc_deleted_chunks.add(swept.deleted_chunks);
+            stats.bytes_freed += swept.bytes_freed;
+            stats.skipped_referenced += swept.skipped_referenced;
+            stats.skipped_recent += swept.skipped_recent;
+        }
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        Logging::info("Garbage collection finished", {{"deleted_chunks", stats.deleted_chunks},
+                                                      {"stored_chunks", stats.stored_chunks},
+                                                      {"bytes_freed", stats.bytes_freed},
+                                                      {"seconds", stats.seconds}});
+        return stats;
+    }
+
+    // Helper to run garbage collection every config.gc_interval_s seconds until destruction
+    void FileManager::garbageCollectionLoop()
+    {
+        std::unique_lock<std::mutex> lock(background_mutex);
+        while (!background_wakeup.wait_for(lock, std::chrono::seconds(config.gc_interval_s), [this]
+                                   { return stopping.load(); }))
+        {
+            lock.unlock();
+            try
+            {
+                collectGarbage();
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error during garbage collection", {{"error", e.what()}});
+            }
+            lock.lock();
+        }
+    }
+
+    // Helper to collect the CIDs of every chunk still in use. Current versions are read before
+    // past ones: a version replaced in between is then seen either way, never missed. Metadata
+    // that disappears while we read it was deleted; metadata that can't be read stops the run.
+    std::unordered_set<CID::BinaryCID, CID::BinaryCIDHash> FileManager::markLiveChunks()
+    {
+        std::unordered_set<CID::BinaryCID, CID::BinaryCIDHash> live;
+        auto mark = [&live](const std::vector<std::string> &cids)
+        {
+            for (const std::string &cid : cids)
+            {
+                live.insert(CID::CIDUtility::toBinary(cid));
+            }
+        };
+        auto unreadable = [](const fs::path &path, const std::exception &e)
+        {
+            if (fs::exists(path))
+            {
+                throw std::runtime_error("Garbage collection aborted, cannot read " + path.string() + ": " + e.what());
+            }
+        };
+
+        for (const std::string &filename : Metadata::FileMetadata::listAll(config))
+        {
+            try
+            {
+                mark(Metadata::FileMetadata::load(config, filename).chunk_cids);
+            }
+            catch (const std::exception &e)
+            {
+                unreadable(config.getMetadataDirPath() / (filename + ".json"), e);
+            }
+        }
+        for (const std::string &filename : Metadata::FileMetadata::listVersioned(config))
+        {
+            for (uint64_t version : Metadata::FileMetadata::listVersions(config, filename))
+            {
+                try
+                {
+                    mark(Metadata::FileMetadata::loadVersion(config, filename, version).chunk_cids);
+                }
+                catch (const std::exception &e)
+                {
+                    unreadable(Metadata::FileMetadata::getVersionsDir(config, filename) / (std::to_string(version) + ".json"), e);
+                }
+            }
+        }
+        for (const std::string &session_id : Metadata::UploadSession::listAll(config))
+        {
+            try
+            {
+                mark(Metadata::UploadSession::load(config, session_id).chunk_cids);
+            }
+            catch (const std::exception &e)
+            {
+                unreadable(config.getUploadsDirPath() / session_id, e);
+            }
+        }
+        return live;
+    }
+
+    // Helper to delete a batch of unmarked chunks. Checked under the pending-writes lock, which
+    // storeChunks, putChunk and commitManifest hold while deciding whether a chunk is already
+    // stored or taking references to it. The grace period is checked again there too: putChunk
+    // restarts it for chunks uploaded again since the candidates were listed.
+    FileManager::GarbageCollectionStats FileManager::sweepChunks(const std::vector<std::string> &chunk_cids,
+                                                                 size_t begin, size_t end)
+    {
+        GarbageCollectionStats stats;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const std::string &cid = chunk_cids[i];
+            try
+            {
+                std::lock_guard<std::mutex> lock(pending_writes_mutex);
+                if (ref_manager.getCount(cid) > 0 || pending_chunk_writes.count(cid))
+                {
+                    ++stats.skipped_referenced;
+                    continue;
+                }
+                const fs::path chunk_path = config.getChunksDirPath() / cid;
+                const auto cutoff = fs::file_time_type::clock::now() - std::chrono::seconds(config.gc_grace_period_s);
+                std::error_code ec;
+                fs::file_time_type modified = fs::last_write_time(chunk_path, ec);
+                if (!ec && modified > cutoff)
+                {
+                    ++stats.skipped_recent;
+                    continue;
+                }
+                uint64_t size = fs::file_size(chunk_path, ec);
+                if (removeChunkFile(cid))
+                {
+                    ++stats.deleted_chunks;
+                    stats.bytes_freed += ec ? 0 : size;
+                }
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error collecting chunk", {{"cid", cid}, {"error", e.what()}});
+            }
+        }
+        return stats;
+    }
+
+    // Helper to delete the file of an unreferenced chunk
+    bool FileManager::removeChunkFile(const std::string &chunk_cid)
+    {
+        fs::path chunk_path = config.getChunksDirPath() / chunk_cid;
+        try
+        {
+            if (!fs::remove(chunk_path))
+            {
+                Logging::warn("Chunk file to delete was not found", {{"path", chunk_path.string()}});
+                return false;
+            }
+        }
+        catch (const fs::filesystem_error &e)
+        {
+            Logging::error("Error deleting chunk file", {{"path", chunk_path.string()}, {"error", e.what()}});
+            return false; // Deletion failed
+        }
+
+        // Every stored chunk was added to the filter when written or at startup
+        if (chunk_filter.mightContain(chunk_cid))
+        {
+            chunk_filter.remove(chunk_cid);
+        }
+        Logging::debug("Deleted unreferenced chunk file", {{"cid", chunk_cid}});
+        return true;
+    }
+
+    // Corresponds to POST /compact
+    FileManager::CompactionStats FileManager::compactChunks()
+    {
+        std::lock_guard<std::mutex> compaction_lock(compaction_mutex);
+        const auto started = std::chrono::steady_clock::now();
+        const auto started_at = fs::file_time_type::clock::now();
+        CompactionStats stats;
+        if (config.compression != Config::ChunkConfig::Compression::Zstd)
+        {
+            return stats; // Nothing is stored with a better encoding than the configured one
+        }
+
+        std::unordered_map<CID::BinaryCID, std::string, CID::BinaryCIDHash> content_types = chunkContentTypes();
+        std::unordered_map<std::string, uint32_t> targets;
+        auto target_for = [this, &targets](const std::string &content_type)
+        {
+            auto it = targets.find(content_type);
+            if (it == targets.end())
+            {
+                std::shared_ptr<const Chunks::ZstdDictionary> dictionary = dictionaries.latest(content_type);
+                it = targets.emplace(content_type, dictionary ? dictionary->id : 0).first;
+            }
+            return it->second;
+        };
+
+        // Only the first bytes of each chunk are read to find its encoding
+        std::vector<StaleChunk> stale;
+        for (const auto &entry : fs::directory_iterator(config.getChunksDirPath()))
+        {
+            std::string cid = entry.path().filename().string();
+            if (!entry.is_regular_file() || !CID::CIDUtility::isValidCID(cid))
+            {
+                continue;
+            }
+            ++stats.stored_chunks;
+            auto content_type = content_types.find(CID::CIDUtility::toBinary(cid));
+            if (content_type == content_types.end())
+            {
+                continue; // Not used by any file; left to garbage collection
+            }
+            try
+            {
+                char probe[Chunks::ChunkCodec::PROBE_SIZE];
+                std::ifstream ifs(entry.path(), std::ios::binary);
+                ifs.read(probe, sizeof(probe));
+                size_t probed = static_cast<size_t>(ifs.gcount());
+                std::optional<Chunks::ChunkCodec::Header> header = Chunks::ChunkCodec::parseHeader(probe, probed);
+                if (!header)
+                {
+                    continue; // Stored raw
+                }
+                uint32_t target = target_for(content_type->second);
+                if (header->codec == Chunks::ChunkCodec::Codec::Zstd && Chunks::ChunkCodec::dictionaryId(probe, probed) == target)
+                {
+                    continue; // Up to date
+                }
+                if (compaction_checkpoint && entry.last_write_time() < compaction_checkpoint->started)
+                {
+                    auto examined = compaction_checkpoint->targets.find(content_type->second);
+                    if (examined != compaction_checkpoint->targets.end() && examined->second == target)
+                    {
+                        continue; // Examined last run and kept: re-encoding it wouldn't save enough
+                    }
+                }
+                stale.push_back({std::move(cid), content_type->second, entry.file_size()});
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error examining chunk for compaction", {{"cid", cid}, {"error", e.what()}});
+            }
+        }
+        stats.stale_chunks = stale.size();
+
+        // Rewrite in batches on the pool, paced by the bytes they read. Batches write chunks
+        // themselves (see compactChunkBatch), never waiting on I/O queued behind them on the pool.
+        const size_t batch_size = std::max<size_t>(1, config.compaction_batch_size);
+        std::vector<std::future<CompactionStats>> batches;
+        size_t begin = 0;
+        for (; begin < stale.size() && !stopping; begin += batch_size)
+        {
+            size_t end = std::min(begin + batch_size, stale.size());
+            uint64_t bytes = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                bytes += stale[i].stored_size;
+            }
+            compaction_limiter.acquire(static_cast<double>(bytes));
+            batches.push_back(thread_pool.enqueue([this, &stale, begin, end]()
+                                                  { return compactChunkBatch(stale, begin, end); }));
+        }
+        for (auto &batch : batches)
+        {
+            CompactionStats compacted = batch.get(); // compactChunkBatch doesn't throw
+            stats.rewritten_chunks += compacted.rewritten_chunks;
+            compaction_rewritten_chunks.add(compacted.rewritten_chunks);
+            stats.bytes_before += compacted.bytes_before;
+            stats.bytes_after += compacted.bytes_after;
+            stats.skipped += compacted.skipped;
+        }
+        if (begin >= stale.size())
+        {
+            compaction_checkpoint = CompactionCheckpoint{started_at, std::move(targets)};
+        }
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        Logging::info("Compaction finished", {{"rewritten_chunks", stats.rewritten_chunks},
+                                              {"stale_chunks", stats.stale_chunks},
+                                              {"bytes_before", stats.bytes_before},
+                                              {"bytes_after", stats.bytes_after},
+                                              {"seconds", stats.seconds}});
+        return stats;
+    }
+
+    // Helper to run compaction every config.compaction_interval_s seconds until destruction
+    void FileManager::compactionLoop()
+    {
+        std::unique_lock<std::mutex> lock(background_mutex);
+        while (!background_wakeup.wait_for(lock, std::chrono::seconds(config.compaction_interval_s), [this]
+                                   { return stopping.load(); }))
+        {
+            lock.unlock();
+            try
+            {
+                compactChunks();
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error during compaction", {{"error", e.what()}});
+            }
+            lock.lock();
+        }
+    }
+
+    // Helper to find a content type for every chunk in use, from the current and past versions
+    // and upload sessions using it (the first one found wins). Unreadable metadata is skipped:
+    // its chunks just aren't compacted this run.
+    std::unordered_map<CID::BinaryCID, std::string, CID::BinaryCIDHash> FileManager::chunkContentTypes()
+    {
+        std::unordered_map<CID::BinaryCID, std::string, CID::BinaryCIDHash> content_types;
+        auto note = [&content_types](const std::vector<std::string> &cids, const std::string &content_type)
+        {
+            for (const std::string &cid : cids)
+            {
+                content_types.emplace(CID::CIDUtility::toBinary(cid), content_type);
+            }
+        };
+
+        for (const std::string &filename : Metadata::FileMetadata::listAll(config))
+        {
+            try
+            {
+                Metadata::FileMetadata metadata = Metadata::FileMetadata::load(config, filename);
+                note(metadata.chunk_cids, metadata.content_type);
+            }
+            catch (const std::exception &)
+            {
+                // Deleted or replaced while we were listing
+            }
+        }
+        for (const std::string &filename : Metadata::FileMetadata::listVersioned(config))
+        {
+            for (uint64_t version : Metadata::FileMetadata::listVersions(config, filename))
+            {
+                try
+                {
+                    Metadata::FileMetadata metadata = Metadata::FileMetadata::loadVersion(config, filename, version);
+                    note(metadata.chunk_cids, metadata.content_type);
+                }
+                catch (const std::exception &)
+                {
+                    // Dropped from the history while we were listing
+                }
+            }
+        }
+        for (const std::string &session_id : Metadata::UploadSession::listAll(config))
+        {
+            try
+            {
+                Metadata::UploadSession session = Metadata::UploadSession::load(config, session_id);
+                note(session.chunk_cids, session.content_type);
+            }
+            catch (const std::exception &)
+            {
+                // Deleted or replaced while we were listing
+            }
+        }
+        return content_types;
+    }
+
+    // Helper to re-encode a batch of stale chunks. Each chunk is claimed in the pending-writes
+    // table while it is rewritten, so garbage collection skips it and uploads of the same chunk
+    // wait for the rewrite instead of racing it.
+    FileManager::CompactionStats FileManager::compactChunkBatch(const std::vector<StaleChunk> &chunks,
+                                                                size_t begin, size_t end)
+    {
+        CompactionStats stats;
+        const uint64_t min_saving_percent = std::min<uint64_t>(config.compaction_min_saving_percent, 100);
+        for (size_t i = begin; i < end && !stopping; ++i)
+        {
+            const StaleChunk &stale = chunks[i];
+            std::promise<bool> done;
+            {
+                std::lock_guard<std::mutex> lock(pending_writes_mutex);
+                if (ref_manager.getCount(stale.cid) == 0 || pending_chunk_writes.count(stale.cid))
+                {
+                    ++stats.skipped; // No longer used, or being written right now
+                    continue;
+                }
+                pending_chunk_writes[stale.cid] = done.get_future().share();
+            }
+
+            try
+            {
+                uint64_t stored_size = fs::file_size(config.getChunksDirPath() / stale.cid);
+                Chunks::Chunk chunk(Chunks::Chunk::loadData(config, stale.cid, &dictionaries));
+                if (chunk.cid != stale.cid)
+                {
+                    throw std::runtime_error("content does not match its CID");
+                }
+                std::shared_ptr<const Chunks::ZstdDictionary> dictionary = dictionaries.latest(stale.content_type);
+                std::vector<char> encoded = Chunks::ChunkCodec::encode(chunk.data, config, dictionary.get());
+                uint64_t new_size = encoded.empty() ? chunk.data.size() : encoded.size();
+                if (new_size * 100 > stored_size * (100 - min_saving_percent))
+                {
+                    ++stats.skipped;
+                }
+                else
+                {
+                    chunk.write(config, *committer, encoded); // On the pool: not through io_engine
+                    ++stats.rewritten_chunks;
+                    stats.bytes_before += stored_size;
+                    stats.bytes_after += new_size;
+                }
+            }
+            catch (const std::exception &e)
+            {
+                ++stats.skipped;
+                Logging::error("Error compacting chunk", {{"cid", stale.cid}, {"error", e.what()}});
+            }
+
+            // The old file is intact if the rewrite failed, so waiters may use the chunk either way
+            done.set_value(true);
+            std::lock_guard<std::mutex> lock(pending_writes_mutex);
+            pending_chunk_writes.erase(stale.cid);
+        }
+        return stats;
+    }
+
+    // Corresponds to POST /scrub
+    FileManager::ScrubStats FileManager::scrubChunks()
+    {
+        std::lock_guard<std::mutex> scrub_lock(scrub_mutex);
+        const auto started = std::chrono::steady_clock::now();
+        ScrubStats stats;
+        Metadata::ScrubProgress progress;
+        {
+            std::lock_guard<std::mutex> lock(scrub_status_mutex);
+            progress = scrub_progress;
+        }
+        stats.resumed = progress.in_progress;
+        if (!progress.in_progress)
+        {
+            progress.startPass();
+        }
+        publishScrubProgress(progress, true);
+
+        try
+        {
+            // Chunks left in this pass, in CID order; temp files aren't valid CIDs
+            std::vector<std::pair<std::string, uint64_t>> chunks;
+            for (const auto &entry : fs::directory_iterator(config.getChunksDirPath()))
+            {
+                std::string cid = entry.path().filename().string();
+                std::error_code ec;
+                if (entry.is_regular_file(ec) && CID::CIDUtility::isValidCID(cid) && cid > progress.position)
+                {
+                    uint64_t size = entry.file_size(ec);
+                    chunks.emplace_back(std::move(cid), ec ? 0 : size);
+                }
+            }
+            std::sort(chunks.begin(), chunks.end());
+
+            // Verify in batches on the pool, paced by the bytes they read. Batches finish out of
+            // order, so the position only advances past batches whose predecessors are done.
+            const size_t batch_size = std::max<size_t>(1, config.scrub_batch_size);
+            std::deque<std::pair<size_t, std::future<ScrubStats>>> in_flight; // Batch end, result
+            auto finish_oldest = [&]()
+            {
+                ScrubStats batch = in_flight.front().second.get(); // scrubChunkBatch doesn't throw
+                progress.position = chunks[in_flight.front().first - 1].first;
+                in_flight.pop_front();
+                stats.checked_chunks += batch.checked_chunks;
+                stats.checked_bytes += batch.checked_bytes;
+                stats.corrupt_chunks += batch.corrupt_chunks;
+                stats.skipped += batch.skipped;
+                scrub_checked_chunks.add(batch.checked_chunks);
+                scrub_corrupt_chunks.add(batch.corrupt_chunks);
+                progress.checked_chunks += batch.checked_chunks;
+                progress.checked_bytes += batch.checked_bytes;
+                progress.corrupt_chunks += batch.corrupt_chunks;
+                publishScrubProgress(progress, true);
+            };
+            size_t begin = 0;
+            for (; begin < chunks.size() && !stopping; begin += batch_size)
+            {
+                if (in_flight.size() >= SCRUB_BATCHES_IN_FLIGHT)
+                {
+                    finish_oldest();
+                }
+                size_t end = std::min(begin + batch_size, chunks.size());
+                uint64_t bytes = 0;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    bytes += chunks[i].second;
+                }
+                scrub_limiter.acquire(static_cast<double>(bytes));
+                in_flight.emplace_back(end, thread_pool.enqueue([this, &chunks, begin, end]()
+                                                                { return scrubChunkBatch(chunks, begin, end); }));
+            }
+            while (!in_flight.empty())
+            {
+                finish_oldest();
+            }
+
+            if (begin >= chunks.size())
+            {
+                progress.completePass();
+                stats.pass_complete = true;
+            }
+            publishScrubProgress(progress, false);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(scrub_status_mutex);
+            scrub_running = false;
+            throw;
+        }
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        Logging::info("Scrub finished", {{"checked_chunks", stats.checked_chunks},
+                                         {"checked_bytes", stats.checked_bytes},
+                                         {"corrupt_chunks", stats.corrupt_chunks},
+                                         {"pass_complete", stats.pass_complete},
+                                         {"seconds", stats.seconds}});
+        return stats;
+    }
+
+    // Corresponds to GET /scrub
+    FileManager::ScrubStatus FileManager::getScrubStatus()
+    {
+        ScrubStatus status;
+        {
+            std::lock_guard<std::mutex> lock(scrub_status_mutex);
+            status.running = scrub_running;
+            status.progress = scrub_progress;
+        }
+        status.quarantined = Metadata::ScrubProgress::listQuarantined(config);
+        return status;
+    }
+
+    // Helper to scrub every config.scrub_interval_s seconds until destruction. A pass interrupted
+    // by a restart is resumed right away.
+    void FileManager::scrubLoop()
+    {
+        std::unique_lock<std::mutex> lock(background_mutex);
+        bool resume = scrub_progress.in_progress; // Loaded before this thread started
+        while (resume || !background_wakeup.wait_for(lock, std::chrono::seconds(config.scrub_interval_s), [this]
+                                                     { return stopping.load(); }))
+        {
+            resume = false;
+            lock.unlock();
+            try
+            {
+                scrubChunks();
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error during scrubbing", {{"error", e.what()}});
+            }
+            lock.lock();
+        }
+    }
+
+    // Helper to save scrub progress to disk, then make it visible to getScrubStatus
+    void FileManager::publishScrubProgress(const Metadata::ScrubProgress &progress, bool running)
+    {
+        progress.save(config);
+        std::lock_guard<std::mutex> lock(scrub_status_mutex);
+        scrub_progress = progress;
+        scrub_running = running;
+    }
+
+    // Helper to verify a batch of chunks. Each chunk is claimed in the pending-writes table while
+    // it is checked, so it can't be deleted, rewritten by compaction or written by an upload
+    // underneath us; chunks already claimed are being written and skipped.
+    FileManager::ScrubStats FileManager::scrubChunkBatch(const std::vector<std::pair<std::string, uint64_t>> &chunks,
+                                                         size_t begin, size_t end)
+    {
+        ScrubStats stats;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const std::string &cid = chunks[i].first;
+            std::promise<bool> done;
+            {
+                std::lock_guard<std::mutex> lock(pending_writes_mutex);
+                if (pending_chunk_writes.count(cid))
+                {
+                    ++stats.skipped;
+                    continue;
+                }
+                pending_chunk_writes[cid] = done.get_future().share();
+            }
+
+            bool quarantined = false;
+            try
+            {
+                std::ifstream ifs(config.getChunksDirPath() / cid, std::ios::binary | std::ios::ate);
+                if (!ifs.is_open())
+                {
+                    ++stats.skipped; // Collected since we listed it
+                }
+                else
+                {
+                    std::vector<char> stored(static_cast<size_t>(ifs.tellg()));
+                    ifs.seekg(0, std::ios::beg);
+                    if (!ifs.read(stored.data(), static_cast<std::streamsize>(stored.size())))
+                    {
+                        throw std::runtime_error("failed to read chunk file");
+                    }
+                    ++stats.checked_chunks;
+                    stats.checked_bytes += stored.size();
+
+                    std::string problem;
+                    try
+                    {
+                        if (CID::CIDUtility::generateSHA256(Chunks::ChunkCodec::decode(std::move(stored), &dictionaries)) != cid)
+                        {
+                            problem = "content does not match its CID";
+                        }
+                    }
+                    catch (const std::exception &e)
+                    {
+                        problem = e.what(); // Corrupt header or payload
+                    }
+                    if (!problem.empty())
+                    {
+                        quarantineChunk(cid, problem);
+                        quarantined = true;
+                        ++stats.corrupt_chunks;
+                    }
+                }
+            }
+            catch (const std::exception &e)
+            {
+                ++stats.skipped;
+                Logging::error("Error scrubbing chunk", {{"cid", cid}, {"error", e.what()}});
+            }
+
+            // Uploads waiting on a quarantined chunk fail instead of referencing a missing file
+            if (quarantined)
+                done.set_exception(std::make_exception_ptr(std::runtime_error("Chunk " + cid + " is corrupt and was quarantined.")));
+            else
+                done.set_value(true);
+            std::lock_guard<std::mutex> lock(pending_writes_mutex);
+            pending_chunk_writes.erase(cid);
+        }
+        return stats;
+    }
+
+    // Helper to move a corrupt chunk file to the quarantine
+    void FileManager::quarantineChunk(const std::string &chunk_cid, const std::string &reason)
+    {
+        fs::path quarantine_path = config.getQuarantineDirPath() / chunk_cid;
+        fs::rename(config.getChunksDirPath() / chunk_cid, quarantine_path); // Throws on failure
+        IO::DurableFile::syncDirectory(config.getChunksDirPath());
+        if (chunk_filter.mightContain(chunk_cid))
+        {
+            chunk_filter.remove(chunk_cid); // Unknown to the filter, so storing it again rewrites it
+        }
+        {
+            std::lock_guard<std::mutex> lock(quarantine_mutex);
+            quarantined_chunks.insert(chunk_cid);
+        }
+        Logging::error("Quarantined corrupt chunk", {{"cid", chunk_cid}, {"reason", reason}, {"path", quarantine_path.string()}});
+    }
+
+    // Helper to drop a chunk from the quarantine set once it is stored again
+    void FileManager::forgetQuarantined(const std::string &chunk_cid)
+    {
+        std::lock_guard<std::mutex> lock(quarantine_mutex);
+        quarantined_chunks.erase(chunk_cid);
+    }
+
+    // Corresponds to DELETE /files/{filename}
+    bool FileManager::deleteFile(const std::string &original_filename)
+    {
+        Logging::debug("Deleting file", {{"filename", original_filename}});
+        Metrics::ScopedTimer timer(delete_seconds);
+        try
+        {
+            auto file_lock = file_locks.lockExclusive(original_filename);
+            Metadata::FileMetadata metadata = Metadata::FileMetadata::load(config, original_filename);
+
+            // Past versions go with the file
+            Metadata::DeletionJournal::Record deletion{0, original_filename, metadata.version, metadata.created_at, metadata.chunk_cids};
+            std::vector<std::string> &released_cids = deletion.chunk_cids;
+            for (uint64_t version : Metadata::FileMetadata::listVersions(config, original_filename))
+            {
+                try
+                {
+                    Metadata::FileMetadata past = Metadata::FileMetadata::loadVersion(config, original_filename, version);
+                    released_cids.insert(released_cids.end(), past.chunk_cids.begin(), past.chunk_cids.end());
+                }
+                catch (const std::exception &e)
+                {
+                    Logging::error("Error loading version", {{"filename", original_filename}, {"version", version}, {"error", e.what()}});
+                }
+            }
+
+            // Journal the deletion first: if we crash before the metadata is gone, it is
+            // completed at startup
+            deletion_journal.append(std::move(deletion));
+
+            // Delete the metadata file
+            fs::path metadata_path = metadata.getFullPath(config);
+            if (fs::exists(metadata_path))
+            {
+                fs::remove(metadata_path);
+                Logging::debug("Deleted metadata file", {{"path", metadata_path.string()}});
+            }
+            else
+            {
+                Logging::warn("Metadata file not found during deletion", {{"filename", original_filename}});
+            }
+
+            Metadata::FileMetadata::removeAllVersions(config, original_filename);
+
+            // The deletion thread releases the references; locking makes sure it isn't between
+            // checking for work and waiting
+            {
+                std::lock_guard<std::mutex> lock(background_mutex);
+            }
+            background_wakeup.notify_all();
+
+            Logging::info("File deleted", {{"filename", original_filename}, {"latency_ms", timer.elapsedMilliseconds()}});
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            Logging::error("Error deleting file", {{"filename", original_filename}, {"error", e.what()}});
+            return false;
+        }
+    }
+
+    // Corresponds to PUT /files/{filename}
+    Metadata::FileMetadata FileManager::updateFile(
+        const std::string &original_filename,
+        const std::string &updated_filepath,
+        const std::string &new_content_type)
+    {
+        Logging::debug("Updating file", {{"filename", original_filename}});
+        Metrics::ScopedTimer timer(update_seconds);
+
+        // Hash the new content before locking; only the reference changes need the old version
+        std::vector<Chunks::Chunk> new_file_chunks;
+        std::vector<std::string> new_chunk_cids = processFileIntoChunks(updated_filepath, new_file_chunks);
+        uint64_t new_file_size = fs::file_size(updated_filepath);
+
+        auto file_lock = file_locks.lockExclusive(original_filename);
+        Metadata::FileMetadata old_metadata;
+        try
+        {
+            old_metadata = Metadata::FileMetadata::load(config, original_filename);
+        }
+        catch (const std::exception &e)
+        {
+            throw std::runtime_error("Cannot update file: Original metadata not found for '" + original_filename + "'. " + e.what());
+        }
+
+        // Net reference changes between the versions leaving the history (the old one itself if
+        // no history is kept) and the new one, counting every occurrence of a chunk. Chunks used
+        // as often in both aren't touched at all.
+        std::vector<Metadata::FileMetadata> dropped = versionsToDrop(old_metadata);
+        Chunks::ChunkReferenceManager::Deltas gained, lost;
+        Chunks::ChunkReferenceManager::split(Chunks::ChunkReferenceManager::diff(versionCids(dropped), new_chunk_cids),
+                                             gained, lost);
+
+        // Reference (and store, if new) what the new version adds before it becomes visible
+        storeChunks(new_file_chunks, new_content_type, &gained);
+
+        // Create and save the updated metadata
+        Metadata::FileMetadata updated_metadata(original_filename, new_file_size, new_content_type, new_chunk_cids);
+        try
+        {
+            commitVersion(updated_metadata, old_metadata, dropped);
+        }
+        catch (...)
+        {
+            releaseChunkReferences(Chunks::ChunkReferenceManager::negate(gained));
+            throw;
+        }
+
+        // Release what only the dropped versions referenced, in one batch
+        releaseChunkReferences(lost);
+        noteStoredFile(new_content_type);
+
+        Logging::info("File updated", {{"filename", original_filename},
+                                       {"version", updated_metadata.version},
+                                       {"chunks", new_chunk_cids.size()},
+                                       {"latency_ms", timer.elapsedMilliseconds()}});
+        return updated_metadata;
+    }
+
+    // Corresponds to PATCH /files/{filename}
+    Metadata::FileMetadata FileManager::patchFile(const std::string &original_filename,
+                                                  std::optional<uint64_t> offset,
+                                                  const std::vector<char> &data)
+    {
+        Logging::debug("Patching file", {{"filename", original_filename}});
+        Metrics::ScopedTimer timer(patch_seconds);
+        auto file_lock = file_locks.lockExclusive(original_filename); // The patch is applied to the current version
+        Metadata::FileMetadata old_metadata = Metadata::FileMetadata::load(config, original_filename);
+        const uint64_t old_size = old_metadata.file_size_bytes;
+        const uint64_t start = offset.value_or(old_size);
+        if (start > old_size)
+        {
+            throw std::runtime_error("Patch offset " + std::to_string(start) + " is beyond the end of '" +
+                                     original_filename + "' (" + std::to_string(old_size) + " bytes).");
+        }
+        if (data.empty())
+        {
+            return old_metadata;
+        }
+
+        // Only the chunks the patch overlaps, [first, last_end), are rewritten; the rest are reused
+        // as is. Chunks are CHUNK_SIZE bytes when the server chunked the file but may have any
+        // size in a committed manifest, so offsets come from the stored chunk sizes.
+        const uint64_t chunk_size = Config::ChunkConfig::CHUNK_SIZE;
+        const std::vector<std::string> &old_cids = old_metadata.chunk_cids;
+        const uint64_t end = start + data.size();
+        const uint64_t new_size = std::max(old_size, end);
+        size_t first = old_cids.size();
+        size_t last_end = old_cids.size();
+        uint64_t region_start = old_size; // Offset of chunk `first`
+        uint64_t region_end = new_size;   // End of the rewritten bytes
+        if (start == old_size)
+        {
+            // Appending: a short last chunk is filled up first
+            if (!old_cids.empty())
+            {
+                const uint64_t last_size = storedChunkSize(old_cids.back());
+                if (last_size < chunk_size)
+                {
+                    first = old_cids.size() - 1;
+                    region_start = old_size - last_size;
+                }
+            }
+        }
+        else
+        {
+            uint64_t offset = 0;
+            for (size_t i = 0; i < old_cids.size() && offset < end; ++i)
+            {
+                const uint64_t size = storedChunkSize(old_cids[i]);
+                if (first == old_cids.size() && offset + size > start)
+                {
+                    first = i;
+                    region_start = offset;
+                }
+                offset += size;
+                if (offset >= end)
+                {
+                    last_end = i + 1;
+                    region_end = offset;
+                }
+            }
+            if (last_end == old_cids.size() && offset != old_size)
+            {
+                throw std::runtime_error("Cannot patch '" + original_filename + "': its chunks add up to " +
+                                         std::to_string(offset) + " bytes, not " + std::to_string(old_size) + ".");
+            }
+        }
+
+        std::vector<char> region;
+        region.reserve(static_cast<size_t>(region_end - region_start));
+        for (size_t i = first; i < last_end; ++i)
+        {
+            std::vector<char> bytes = Chunks::Chunk::loadData(config, old_cids[i], &dictionaries);
+            region.insert(region.end(), bytes.begin(), bytes.end());
+        }
+        region.resize(static_cast<size_t>(region_end - region_start));
+        std::copy(data.begin(), data.end(), region.begin() + static_cast<std::ptrdiff_t>(start - region_start));
+
+        std::vector<Chunks::Chunk> new_chunks;
+        for (size_t offset = 0; offset < region.size(); offset += chunk_size)
+        {
+            auto from = region.begin() + static_cast<std::ptrdiff_t>(offset);
+            new_chunks.emplace_back(std::vector<char>(from, from + static_cast<std::ptrdiff_t>(std::min<size_t>(chunk_size, region.size() - offset))));
+        }
+
+        std::vector<std::string> new_cids(old_cids.begin(), old_cids.begin() + static_cast<std::ptrdiff_t>(first));
+        for (const auto &chunk : new_chunks)
+        {
+            new_cids.push_back(chunk.cid);
+        }
+        new_cids.insert(new_cids.end(), old_cids.begin() + static_cast<std::ptrdiff_t>(last_end), old_cids.end());
+
+        // As in updateFile: without history only the replaced chunks lose a reference, and
+        // reused ones keep the old version's
+        std::vector<Metadata::FileMetadata> dropped = versionsToDrop(old_metadata);
+        Chunks::ChunkReferenceManager::Deltas gained, lost;
+        Chunks::ChunkReferenceManager::split(Chunks::ChunkReferenceManager::diff(versionCids(dropped), new_cids),
+                                             gained, lost);
+        storeChunks(new_chunks, old_metadata.content_type, &gained);
+
+        Metadata::FileMetadata metadata(original_filename, new_size, old_metadata.content_type, new_cids);
+        try
+        {
+            commitVersion(metadata, old_metadata, dropped);
+        }
+        catch (...)
+        {
+            releaseChunkReferences(Chunks::ChunkReferenceManager::negate(gained));
+            throw;
+        }
+        releaseChunkReferences(lost);
+
+        Logging::info("File patched", {{"filename", original_filename},
+                                       {"version", metadata.version},
+                                       {"rewritten_chunks", new_chunks.size()},
+                                       {"chunks", new_cids.size()},
+                                       {"latency_ms", timer.elapsedMilliseconds()}});
+        return metadata;
+    }
+
+    // Corresponds to POST /files/{filename}/copy
+    Metadata::FileMetadata FileManager::copyFile(const std::string &original_filename, const std::string &destination_filename)
+    {
+        Logging::debug("Copying file", {{"filename", original_filename}, {"destination", destination_filename}});
+        if (destination_filename.empty() || destination_filename == "." || destination_filename == ".." ||
+            destination_filename.find_first_of(std::string("/\\\0", 3)) != std::string::npos)
+        {
+            throw std::runtime_error("Invalid file name: '" + destination_filename + "'.");
+        }
+
+        // Reference the chunks while the source can't change, in one batch; the copy then owns
+        // them whatever happens to the source. The two names are never locked together.
+        Metadata::FileMetadata source;
+        Chunks::ChunkReferenceManager::Deltas references;
+        {
+            auto file_lock = file_locks.lockShared(original_filename);
+            source = Metadata::FileMetadata::load(config, original_filename);
+            references = Chunks::ChunkReferenceManager::diff({}, source.chunk_cids);
+            ref_manager.applyDeltas(references);
+        }
+
+        Metadata::FileMetadata metadata(destination_filename, source.file_size_bytes, source.content_type, source.chunk_cids);
+        try
+        {
+            replaceMetadata(metadata);
+        }
+        catch (...)
+        {
+            releaseChunkReferences(Chunks::ChunkReferenceManager::negate(references));
+            throw;
+        }
+
+        Logging::info("File copied", {{"filename", original_filename},
+                                      {"destination", destination_filename},
+                                      {"chunks", metadata.chunk_cids.size()}});
+        return metadata;
+    }
+
+    // Corresponds to POST /chunks/missing
+    std::vector<std::string> FileManager::findMissingChunks(const std::vector<std::string> &chunk_cids)
+    {
+        std::vector<std::string> missing;
+        for (const std::string &cid : chunk_cids)
+        {
+            if (!CID::CIDUtility::isValidCID(cid))
+            {
+                throw std::runtime_error("Invalid CID: " + cid);
+            }
+            if (!chunk_filter.mightContain(cid) || !fs::is_regular_file(config.getChunksDirPath() / cid))
+            {
+                missing.push_back(cid);
+            }
+        }
+        return missing;
+    }
+
+    // Corresponds to PUT /chunks/{hash}
+    bool FileManager::putChunk(const std::string &chunk_cid, std::vector<char> data, const std::string &content_type)
+    {
+        if (!CID::CIDUtility::isValidCID(chunk_cid))
+        {
+            throw std::runtime_error("Invalid CID: " + chunk_cid);
+        }
+        if (data.size() > Config::ChunkConfig::CHUNK_SIZE)
+        {
+            throw std::runtime_error("Chunk too large: " + std::to_string(data.size()) + " bytes.");
+        }
+        Chunks::Chunk chunk(std::move(data));
+        if (chunk.cid != chunk_cid)
+        {
+            throw std::runtime_error("Chunk hash mismatch: expected " + chunk_cid + ", got " + chunk.cid);
+        }
+
+        // Share the pending-writes table with storeChunks, so an upload referencing this chunk
+        // waits for our write instead of writing it again
+        std::promise<bool> done;
+        std::shared_future<bool> in_flight;
+        {
+            std::lock_guard<std::mutex> lock(pending_writes_mutex);
+            auto pending = pending_chunk_writes.find(chunk_cid);
+            if (pending != pending_chunk_writes.end())
+            {
+                in_flight = pending->second;
+            }
+            else
+            {
+                pending_chunk_writes[chunk_cid] = done.get_future().share();
+            }
+        }
+        if (in_flight.valid())
+        {
+            in_flight.get(); // Someone else is writing it; throws if their write failed
+            return false;
+        }
+
+        bool written = false;
+        try
+        {
+            if (!chunk_filter.mightContain(chunk_cid) || !fs::is_regular_file(chunk.getFullPath(config)))
+            {
+                std::shared_ptr<const Chunks::ZstdDictionary> dictionary;
+                if (config.compression == Config::ChunkConfig::Compression::Zstd)
+                {
+                    dictionary = dictionaries.latest(content_type);
+                }
+                std::vector<char> encoded = Chunks::ChunkCodec::encode(chunk.data, config, dictionary.get());
+                chunk.writeAsync(config, *io_engine, *committer, encoded).get();
+                chunk_filter.add(chunk_cid);
+                forgetQuarantined(chunk_cid);
+                written = true;
+            }
+            else
+            {
+                // Already stored, maybe unused: restart its grace period so garbage collection
+                // leaves it alone until the client commits a manifest naming it
+                std::error_code ec;
+                fs::last_write_time(chunk.getFullPath(config), fs::file_time_type::clock::now(), ec);
+            }
+            done.set_value(true);
+        }
+        catch (...)
+        {
+            done.set_exception(std::current_exception());
+            std::lock_guard<std::mutex> lock(pending_writes_mutex);
+            pending_chunk_writes.erase(chunk_cid);
+            throw;
+        }
+
+        std::lock_guard<std::mutex> lock(pending_writes_mutex);
+        pending_chunk_writes.erase(chunk_cid);
+        return written;
+    }
+
+    // Corresponds to POST /files/{filename}/commit
+    Metadata::FileMetadata FileManager::commitManifest(const std::string &original_filename,
+                                                       const std::string &content_type,
+                                                       const std::vector<std::string> &chunk_cids)
+    {
+        Logging::debug("Committing manifest", {{"filename", original_filename}});
+        Metrics::ScopedTimer timer(commit_seconds);
+        for (const std::string &cid : chunk_cids)
+        {
+            if (!CID::CIDUtility::isValidCID(cid))
+            {
+                throw std::runtime_error("Invalid CID: " + cid);
+            }
+        }
+
+        // Reference first, so the chunks can't be deleted while we check them. Under the
+        // pending-writes lock: a sweep that saw them unreferenced has then finished deleting.
+        const Chunks::ChunkReferenceManager::Deltas references = Chunks::ChunkReferenceManager::diff({}, chunk_cids);
+        {
+            std::lock_guard<std::mutex> lock(pending_writes_mutex);
+            ref_manager.applyDeltas(references);
+        }
+
+        uint64_t file_size = 0;
+        try
+        {
+            std::unordered_map<std::string, uint64_t> sizes;
+            for (const std::string &cid : chunk_cids)
+            {
+                auto it = sizes.find(cid);
+                if (it == sizes.end())
+                {
+                    it = sizes.emplace(cid, storedChunkSize(cid)).first; // Throws if missing
+                }
+                file_size += it->second;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            ref_manager.applyDeltas(Chunks::ChunkReferenceManager::negate(references));
+            throw std::runtime_error("Cannot commit '" + original_filename + "': " + e.what());
+        }
+
+        Metadata::FileMetadata metadata(original_filename, file_size, content_type, chunk_cids);
+        try
+        {
+            replaceMetadata(metadata);
+        }
+        catch (...)
+        {
+            ref_manager.applyDeltas(Chunks::ChunkReferenceManager::negate(references));
+            throw;
+        }
+        noteStoredFile(content_type);
+
+        Logging::info("File committed", {{"filename", original_filename},
+                                         {"chunks", chunk_cids.size()},
+                                         {"latency_ms", timer.elapsedMilliseconds()}});
+        return metadata;
+    }
+
+    // Corresponds to POST /uploads
+    Metadata::UploadSession FileManager::createUploadSession(const std::string &original_filename,
+                                                             const std::string &content_type)
+    {
+        Metadata::UploadSession session(original_filename, content_type);
+        session.save(config);
+        Logging::info("Created upload session", {{"session", session.id}, {"filename", original_filename}});
+        return session;
+    }
+
+    // Corresponds to GET /uploads/{id}
+    Metadata::UploadSession FileManager::getUploadSession(const std::string &session_id)
+    {
+        std::shared_ptr<std::mutex> session_mutex = uploadSessionMutex(session_id);
+        std::lock_guard<std::mutex> lock(*session_mutex);
+        return Metadata::UploadSession::load(config, session_id);
+    }
+
+    // Corresponds to PATCH /uploads/{id}
+    Metadata::UploadSession FileManager::appendToUploadSession(const std::string &session_id, uint64_t offset,
+                                                               const std::vector<char> &data)
+    {
+        std::shared_ptr<std::mutex> session_mutex = uploadSessionMutex(session_id);
+        std::lock_guard<std::mutex> lock(*session_mutex);
+        Metadata::UploadSession session = Metadata::UploadSession::load(config, session_id);
+
+        if (offset > session.received_bytes)
+        {
+            throw std::runtime_error("Offset mismatch for upload session " + session_id + ": expected at most " +
+                                     std::to_string(session.received_bytes) + ", got " + std::to_string(offset));
+        }
+        // A retried part may overlap what we already have; only the new bytes count
+        uint64_t overlap = session.received_bytes - offset;
+        if (overlap >= data.size())
+        {
+            return session;
+        }
+
+        std::vector<char> buffer = readUploadTail(session);
+        buffer.insert(buffer.end(), data.begin() + static_cast<std::ptrdiff_t>(overlap), data.end());
+
+        std::vector<Chunks::Chunk> chunks;
+        size_t consumed = 0;
+        while (buffer.size() - consumed >= Config::ChunkConfig::CHUNK_SIZE)
+        {
+            chunks.emplace_back(std::vector<char>(buffer.begin() + static_cast<std::ptrdiff_t>(consumed),
+                                                  buffer.begin() + static_cast<std::ptrdiff_t>(consumed + Config::ChunkConfig::CHUNK_SIZE)));
+            consumed += Config::ChunkConfig::CHUNK_SIZE;
+        }
+        storeChunks(chunks, session.content_type); // The session holds these references until finalized
+
+        fs::path old_tail_path = session.getTailPath(config);
+        for (const auto &chunk : chunks)
+        {
+            session.chunk_cids.push_back(chunk.cid);
+        }
+        session.received_bytes += data.size() - overlap;
+        session.tail_size = buffer.size() - consumed;
+
+        try
+        {
+            IO::DurableFile::writeAtomically(session.getTailPath(config), buffer.data() + consumed, session.tail_size);
+            session.save(config);
+        }
+        catch (...)
+        {
+            releaseChunkReferences(chunkCids(chunks));
+            throw;
+        }
+        if (session.getTailPath(config) != old_tail_path)
+        {
+            std::error_code ec;
+            fs::remove(old_tail_path, ec);
+        }
+        return session;
+    }
+
+    // Corresponds to POST /uploads/{id}/finalize
+    Metadata::FileMetadata FileManager::finalizeUploadSession(const std::string &session_id)
+    {
+        std::shared_ptr<std::mutex> session_mutex = uploadSessionMutex(session_id);
+        std::lock_guard<std::mutex> lock(*session_mutex);
+        Metadata::UploadSession session = Metadata::UploadSession::load(config, session_id);
+
+        // The tail becomes the last (short) chunk
+        std::vector<Chunks::Chunk> last_chunk;
+        std::vector<char> tail = readUploadTail(session);
+        std::vector<std::string> chunk_cids = session.chunk_cids;
+        if (!tail.empty())
+        {
+            last_chunk.emplace_back(std::move(tail));
+            storeChunks(last_chunk, session.content_type);
+            chunk_cids.push_back(last_chunk.front().cid);
+        }
+
+        // The session's chunk references now belong to the file
+        Metadata::FileMetadata metadata(session.original_filename, session.received_bytes, session.content_type, chunk_cids);
+        try
+        {
+            replaceMetadata(metadata);
+        }
+        catch (...)
+        {
+            releaseChunkReferences(chunkCids(last_chunk));
+            throw;
+        }
+
+        std::error_code ec;
+        fs::remove_all(session.getDir(config), ec);
+        forgetUploadSession(session_id);
+        noteStoredFile(session.content_type);
+
+        Logging::info("Upload session finalized", {{"session", session_id}, {"filename", session.original_filename}});
+        return metadata;
+    }
+
+    // Corresponds to DELETE /uploads/{id}
+    bool FileManager::abortUploadSession(const std::string &session_id)
+    {
+        std::shared_ptr<std::mutex> session_mutex = uploadSessionMutex(session_id);
+        std::lock_guard<std::mutex> lock(*session_mutex);
+        Metadata::UploadSession session = Metadata::UploadSession::load(config, session_id);
+
+        fs::remove_all(session.getDir(config));
+        releaseChunkReferences(session.chunk_cids);
+        forgetUploadSession(session_id);
+        Logging::info("Upload session aborted", {{"session", session_id}});
+        return true;
+    }
+
+    // Helper to get the lock serializing operations on one upload session
+    std::shared_ptr<std::mutex> FileManager::uploadSessionMutex(const std::string &session_id)
+    {
+        std::lock_guard<std::mutex> lock(upload_sessions_mutex);
+        std::shared_ptr<std::mutex> &session_mutex = upload_session_mutexes[session_id];
+        if (!session_mutex)
+        {
+            session_mutex = std::make_shared<std::mutex>();
+        }
+        return session_mutex;
+    }
+
+    // Helper to drop the lock of a finished upload session
+    void FileManager::forgetUploadSession(const std::string &session_id)
+    {
+        std::lock_guard<std::mutex> lock(upload_sessions_mutex);
+        upload_session_mutexes.erase(session_id);
+    }
+
+    // Helper to read the bytes of an upload session that aren't in a chunk yet
+    std::vector<char> FileManager::readUploadTail(const Metadata::UploadSession &session)
+    {
+        std::vector<char> tail(static_cast<size_t>(session.tail_size));
+        if (tail.empty())
+        {
+            return tail;
+        }
+        std::ifstream ifs(session.getTailPath(config), std::ios::binary);
+        if (!ifs.read(tail.data(), static_cast<std::streamsize>(tail.size())))
+        {
+            throw std::runtime_error("Corrupt upload session " + session.id + ": tail data missing.");
+        }
+        return tail;
+    }
+
+    // Helper to clean up upload sessions left from before a restart
+    void FileManager::recoverUploadSessions()
+    {
+        size_t recovered = 0;
+        for (const std::string &session_id : Metadata::UploadSession::listAll(config))
+        {
+            try
+            {
+                Metadata::UploadSession session = Metadata::UploadSession::load(config, session_id);
+                IO::DurableFile::removeStaleTempFiles(session.getDir(config));
+                ++recovered;
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error recovering upload session", {{"session", session_id}, {"error", e.what()}});
+            }
+        }
+        if (recovered > 0)
+        {
+            Logging::info("Recovered upload sessions", {{"sessions", recovered}});
+        }
+    }
+
+    // Helper to finish deletions that were journaled but interrupted before their metadata was
+    // removed. A file that was re-created since is recognised by its version and creation time.
+    void FileManager::replayDeletions()
+    {
+        for (const auto &deletion : deletion_journal.pending())
+        {
+            try
+            {
+                Metadata::FileMetadata current = Metadata::FileMetadata::load(config, deletion.filename);
+                if (current.version == deletion.version && current.created_at == deletion.created_at)
+                {
+                    fs::remove(current.getFullPath(config));
+                    Metadata::FileMetadata::removeAllVersions(config, deletion.filename);
+                    Logging::info("Completed interrupted deletion", {{"filename", deletion.filename}});
+                }
+            }
+            catch (const std::exception &)
+            {
+                // Already gone: the deletion was complete
+            }
+        }
+    }
+
+    // Helper to rebuild chunk reference counts: one reference per chunk occurrence in every
+    // current and past version and upload session on disk, applied in one batch
+    void FileManager::rebuildReferenceCounts()
+    {
+        Chunks::ChunkReferenceManager::Deltas references;
+        size_t sources = 0;
+        auto count = [&](const std::vector<std::string> &cids)
+        {
+            for (const std::string &cid : cids)
+            {
+                ++references[CID::CIDUtility::toBinary(cid)];
+            }
+            ++sources;
+        };
+
+        for (const std::string &filename : Metadata::FileMetadata::listAll(config))
+        {
+            try
+            {
+                count(Metadata::FileMetadata::load(config, filename).chunk_cids);
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error counting references", {{"filename", filename}, {"error", e.what()}});
+            }
+        }
+        for (const std::string &filename : Metadata::FileMetadata::listVersioned(config))
+        {
+            for (uint64_t version : Metadata::FileMetadata::listVersions(config, filename))
+            {
+                try
+                {
+                    count(Metadata::FileMetadata::loadVersion(config, filename, version).chunk_cids);
+                }
+                catch (const std::exception &e)
+                {
+                    Logging::error("Error counting references", {{"filename", filename}, {"version", version}, {"error", e.what()}});
+                }
+            }
+        }
+        for (const std::string &session_id : Metadata::UploadSession::listAll(config))
+        {
+            try
+            {
+                count(Metadata::UploadSession::load(config, session_id).chunk_cids);
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error counting references", {{"session", session_id}, {"error", e.what()}});
+            }
+        }
+
+        ref_manager.applyDeltas(references);
+        Logging::info("Rebuilt reference counts", {{"chunks", references.size()}, {"sources", sources}});
+    }
+
+    // Helper to release the references of journaled deletions as they arrive, until destruction
+    void FileManager::deletionLoop()
+    {
+        std::unique_lock<std::mutex> lock(background_mutex);
+        while (!stopping)
+        {
+            background_wakeup.wait(lock, [this]
+                                   { return stopping.load() || deletion_journal.pendingCount() > 0; });
+            lock.unlock();
+            try
+            {
+                drainDeletions();
+            }
+            catch (const std::exception &e)
+            {
+                Logging::error("Error releasing references of deleted files", {{"error", e.what()}});
+                std::this_thread::sleep_for(std::chrono::seconds(1)); // Don't spin on a persistent error
+            }
+            lock.lock();
+        }
+    }
+
+    // Helper to release the references of every journaled deletion, in batches of up to
+    // config.deletion_batch_references applied under one lock, each followed by one journal write
+    void FileManager::drainDeletions()
+    {
+        std::lock_guard<std::mutex> drain_lock(deletion_drain_mutex);
+        while (!stopping)
+        {
+            std::vector<Metadata::DeletionJournal::Record> batch = deletion_journal.pending(config.deletion_batch_references);
+            if (batch.empty())
+            {
+                return;
+            }
+
+            Chunks::ChunkReferenceManager::Deltas decrements;
+            size_t released = 0;
+            for (const auto &deletion : batch)
+            {
+                for (const std::string &cid : deletion.chunk_cids)
+                {
+                    --decrements[CID::CIDUtility::toBinary(cid)];
+                }
+                released += deletion.chunk_cids.size();
+            }
+            deletion_limiter.acquire(static_cast<double>(released));
+            releaseChunkReferences(decrements);
+            deletion_journal.markApplied(batch.back().sequence);
+        }
+    }
+
+    // Corresponds to POST /dictionaries
+    Chunks::DictionaryStore::Info FileManager::trainDictionary(const std::string &content_type)
+    {
+        Logging::info("Training dictionary", {{"content_type", content_type}});
+        return dictionaries.train(content_type, collectDictionarySamples(content_type));
+    }
+
+    // Corresponds to GET /dictionaries
+    std::vector<Chunks::DictionaryStore::Info> FileManager::listDictionaries() const
+    {
+        return dictionaries.list();
+    }
+
+    // Helper to pick sample data for dictionary training
+    std::vector<std::vector<char>> FileManager::collectDictionarySamples(const std::string &content_type)
+    {
+        std::vector<std::string> cids;
+        std::unordered_set<std::string> seen;
+        for (const std::string &filename : Metadata::FileMetadata::listAll(config))
+        {
+            Metadata::FileMetadata metadata;
+            try
+            {
+                metadata = Metadata::FileMetadata::load(config, filename);
+            }
+            catch (const std::exception &)
+            {
+                continue; // Deleted or replaced while we were listing
+            }
+            if (metadata.content_type != content_type)
+            {
+                continue;
+            }
+            for (const std::string &cid : metadata.chunk_cids)
+            {
+                if (seen.insert(cid).second)
+                    cids.push_back(cid);
+            }
+        }
+
+        // Spread the sample budget over all chunks so one large file doesn't dominate
+        const size_t budget = config.dictionary_sample_bytes;
+        const size_t slices_per_chunk = cids.empty() ? 0 : std::max<size_t>(1, budget / DICTIONARY_SAMPLE_SLICE / cids.size());
+        std::vector<std::vector<char>> samples;
+        size_t sampled = 0;
+        for (const std::string &cid : cids)
+        {
+            if (sampled >= budget)
+            {
+                break;
+            }
+            std::vector<char> data;
+            try
+            {
+                data = Chunks::Chunk::loadData(config, cid, &dictionaries);
+            }
+            catch (const std::exception &)
+            {
+                continue; // Deleted while we were sampling
+            }
+
+            size_t slices = (data.size() + DICTIONARY_SAMPLE_SLICE - 1) / DICTIONARY_SAMPLE_SLICE;
+            size_t take = std::min(slices, slices_per_chunk);
+            for (size_t k = 0; k < take && sampled < budget; ++k)
+            {
+                size_t begin = (k * slices / take) * DICTIONARY_SAMPLE_SLICE;
+                size_t end = std::min(begin + DICTIONARY_SAMPLE_SLICE, data.size());
+                samples.emplace_back(data.begin() + begin, data.begin() + end);
+                sampled += end - begin;
+            }
+        }
+        return samples;
+    }
+
+    // Helper to count a stored file towards automatic dictionary training
+    void FileManager::noteStoredFile(const std::string &content_type)
+    {
+        const size_t threshold = config.dictionary_auto_train_uploads;
+        if (threshold == 0 || config.compression != Config::ChunkConfig::Compression::Zstd ||
+            dictionaries.latest(content_type))
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(dictionary_mutex);
+            if (++uploads_without_dictionary[content_type] < threshold ||
+                !dictionaries_training.insert(content_type).second)
+            {
+                return;
+            }
+            uploads_without_dictionary[content_type] = 0; // Retry after another `threshold` files on failure
+        }
+
+        thread_pool.enqueue([this, content_type]()
+                            {
+                                try
+                                {
+                                    trainDictionary(content_type);
+                                }
+                                catch (const std::exception &e)
+                                {
+                                    Logging::error("Background dictionary training failed", {{"content_type", content_type}, {"error", e.what()}});
+                                }
+                                std::lock_guard<std::mutex> lock(dictionary_mutex);
+                                dictionaries_training.erase(content_type); });
     }
 
 } // namespace FileManager
\ No newline at end of file
@@ -1,7 +1,9 @@
 // src/file_metadata.cpp
 #include "file_metadata.hpp"
+#include "merkle_tree.hpp"
 #include <nlohmann/json.hpp>
 #include <fstream>
+#include <algorithm> // For std::sort
 #include <iostream> // For logging
 #include <stdexcept> // For std::runtime_error
 
@@ -17,7 +19,9 @@ void to_json(nlohmann::json& j, const FileMetadata& m) {
         {"size", m.file_size_bytes},
         {"content_type", m.content_type},
         {"created_at", m.created_at},
-        {"chunks", m.chunk_cids}
+        {"chunks", m.chunk_cids},
+        {"version", m.version},
+        {"merkle_root", m.merkle_root}
     };
 }
 
@@ -27,39 +31,38 @@ void from_json(const nlohmann::json& j, FileMetadata& m) {
     j.at("content_type").get_to(m.content_type);
     j.at("created_at").get_to(m.created_at);
     j.at("chunks").get_to(m.chunk_cids);
+    m.version = j.value("version", uint64_t{1}); // Written before files had versions
+    m.merkle_root = j.value("merkle_root", std::string());
+    if (m.merkle_root.empty()) {
+        m.merkle_root = CID::MerkleTree::rootOf(m.chunk_cids); // Written before files had Merkle roots
+    }
 }
 
-nlohmann::json FileMetadata::toJson() const {
-    return *this; // Uses the to_json helper function
-}
+namespace {
 
-FileMetadata FileMetadata::fromJson(const nlohmann::json& j) {
-    FileMetadata metadata;
-    j.get_to(metadata); // Uses the from_json helper function
-    return metadata;
-}
-
-bool FileMetadata::save(const Config::ChunkConfig config) const {
-    fs::path metadata_dir = config.getMetadataDirPath();
-    fs::path metadata_path = metadata_dir / (original_filename + ".json");
+// Write `contents` to `path` atomically; see FileMetadata::save
+void writeJsonFile(const fs::path& path, const std::string& contents, IO::GroupCommitter* committer) {
+    if (committer == nullptr) {
+        IO::DurableFile::writeAtomically(path, contents.data(), contents.size());
+        return;
+    }
 
-    std::ofstream ofs(metadata_path);
+    fs::path temp_path = IO::DurableFile::tempPathFor(path);
+    std::ofstream ofs(temp_path, std::ios::binary);
     if (!ofs.is_open()) {
-        throw std::runtime_error("Failed to open file for writing metadata: " + metadata_path.string());
+        throw std::runtime_error("Failed to open file for writing metadata: " + temp_path.string());
     }
-    ofs << toJson().dump(4); // Pretty print with 4 spaces
+    ofs << contents;
+    ofs.close();
     if (!ofs.good()) {
-        throw std::runtime_error("Failed to write all data to metadata file: " + metadata_path.string());
+        std::error_code ec;
+        fs::remove(temp_path, ec);
+        throw std::runtime_error("Failed to write all data to metadata file: " + temp_path.string());
     }
-    ofs.close();
-    // std::cout << "Metadata saved: " << metadata_path.string() << std::endl;
-    return true;
+    committer->commit(temp_path, path).get(); // Replaces the old file atomically
 }
 
-FileMetadata FileMetadata::load(const Config::ChunkConfig& config, const std::string& filename) {
-    fs::path metadata_dir = config.getMetadataDirPath();
-    fs::path metadata_path = metadata_dir / (filename + ".json");
-
+FileMetadata readJsonFile(const fs::path& metadata_path) {
     if (!fs::exists(metadata_path)) {
         throw std::runtime_error("Metadata file not found: " + metadata_path.string());
     }
@@ -77,12 +80,105 @@ FileMetadata FileMetadata::load(const Config::ChunkConfig& config, const std::st
     }
     ifs.close();
 
-    return fromJson(j);
+    return FileMetadata::fromJson(j);
+}
+
+} // namespace
+
+nlohmann::json FileMetadata::toJson() const {
+    return *this; // Uses the to_json helper function
+}
+
+FileMetadata FileMetadata::fromJson(const nlohmann::json& j) {
+    FileMetadata metadata;
+    j.get_to(metadata); // Uses the from_json helper function
+    return metadata;
+}
+
+bool FileMetadata::save(const Config::ChunkConfig& config, IO::GroupCommitter* committer) const {
+    fs::path metadata_dir = config.getMetadataDirPath();
+    fs::path metadata_path = metadata_dir / (original_filename + ".json");
+    std::string contents = toJson().dump(4); // Pretty print with 4 spaces
+    writeJsonFile(metadata_path, contents, committer);
+    // std::cout << "Metadata saved: " << metadata_path.string() << std::endl;
+    return true;
+}
+
+FileMetadata FileMetadata::load(const Config::ChunkConfig& config, const std::string& filename) {
+    fs::path metadata_dir = config.getMetadataDirPath();
+    fs::path metadata_path = metadata_dir / (filename + ".json");
+    return readJsonFile(metadata_path);
+}
+
+std::vector<std::string> FileMetadata::listAll(const Config::ChunkConfig& config) {
+    std::vector<std::string> filenames;
+    for (const auto& entry : fs::directory_iterator(config.getMetadataDirPath())) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") {
+            filenames.push_back(entry.path().stem().string());
+        }
+    }
+    return filenames;
 }
 
 std::filesystem::path FileMetadata::getFullPath(const Config::ChunkConfig& config) const {
     return config.getMetadataDirPath() / (original_filename + ".json");
 }
 
+bool FileMetadata::saveVersion(const Config::ChunkConfig& config, IO::GroupCommitter* committer) const {
+    fs::path versions_dir = getVersionsDir(config, original_filename);
+    fs::create_directories(versions_dir);
+    writeJsonFile(versions_dir / (std::to_string(version) + ".json"), toJson().dump(4), committer);
+    return true;
+}
+
+FileMetadata FileMetadata::loadVersion(const Config::ChunkConfig& config, const std::string& filename, uint64_t version) {
+    fs::path version_path = getVersionsDir(config, filename) / (std::to_string(version) + ".json");
+    if (fs::exists(version_path)) {
+        return readJsonFile(version_path);
+    }
+    FileMetadata current = load(config, filename);
+    if (current.version != version) {
+        throw std::runtime_error("Version " + std::to_string(version) + " of '" + filename + "' not found.");
+    }
+    return current;
+}
+
+std::vector<std::string> FileMetadata::listVersioned(const Config::ChunkConfig& config) {
+    std::vector<std::string> filenames;
+    for (const auto& entry : fs::directory_iterator(config.getVersionsDirPath())) {
+        if (entry.is_directory()) {
+            filenames.push_back(entry.path().filename().string());
+        }
+    }
+    return filenames;
+}
+
+std::vector<uint64_t> FileMetadata::listVersions(const Config::ChunkConfig& config, const std::string& filename) {
+    std::vector<uint64_t> versions;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(getVersionsDir(config, filename), ec)) {
+        const fs::path& path = entry.path();
+        std::string stem = path.stem().string();
+        if (entry.is_regular_file() && path.extension() == ".json" && !stem.empty() &&
+            stem.find_first_not_of("0123456789") == std::string::npos) {
+            versions.push_back(std::stoull(stem));
+        }
+    }
+    std::sort(versions.begin(), versions.end());
+    return versions;
+}
+
+void FileMetadata::removeVersion(const Config::ChunkConfig& config, const std::string& filename, uint64_t version) {
+    fs::remove(getVersionsDir(config, filename) / (std::to_string(version) + ".json"));
+}
+
+void FileMetadata::removeAllVersions(const Config::ChunkConfig& config, const std::string& filename) {
+    fs::remove_all(getVersionsDir(config, filename));
+}
+
+std::filesystem::path FileMetadata::getVersionsDir(const Config::ChunkConfig& config, const std::string& filename) {
+    return config.getVersionsDirPath() / filename;
+}
+
 } // namespace Metadata
 } // namespace FileManager
\ No newline at end of file
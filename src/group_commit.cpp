@@ -0,0 +1,316 @@
+// src/group_commit.cpp
+#include "group_commit.hpp"
+#include "zero_copy.hpp" // For ScopedFd
+#include "logger.hpp"
+#include <set>
+#include <atomic>
+#include <cerrno>
+#include <cstring>   // For std::strerror
+#include <stdexcept> // For std::runtime_error
+
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(_WIN32)
+#include <io.h> // For _commit
+#endif
+
+namespace fs = std::filesystem;
+
+namespace FileManager
+{
+    namespace IO
+    {
+
+        namespace
+        {
+            const std::string TEMP_SUFFIX = ".tmp";
+
+            std::runtime_error errnoError(const std::string &what)
+            {
+                return std::runtime_error(what + ": " + std::strerror(errno));
+            }
+
+            void syncFd(int fd, const fs::path &path)
+            {
+#if defined(__linux__)
+                int rc = ::fdatasync(fd);
+#elif defined(_WIN32)
+                int rc = ::_commit(fd);
+#else
+                int rc = ::fsync(fd);
+#endif
+                if (rc < 0)
+                {
+                    throw errnoError("Failed to sync " + path.string());
+                }
+            }
+        } // namespace
+
+        fs::path DurableFile::tempPathFor(const fs::path &final_path)
+        {
+            static std::atomic<uint64_t> counter{0};
+            fs::path temp = final_path;
+            temp += "." + std::to_string(counter.fetch_add(1)) + TEMP_SUFFIX;
+            return temp;
+        }
+
+        bool DurableFile::isTempFile(const fs::path &path)
+        {
+            return path.extension() == TEMP_SUFFIX;
+        }
+
+        void DurableFile::syncData(const fs::path &path)
+        {
+            ScopedFd fd = ScopedFd::openForRead(path);
+            syncFd(fd.get(), path);
+        }
+
+        void DurableFile::syncData(int fd, const fs::path &path)
+        {
+            syncFd(fd, path);
+        }
+
+        void DurableFile::syncDirectory(const fs::path &dir)
+        {
+#if defined(_WIN32)
+            (void)dir; // Directory entries can't be synced on Windows
+#else
+            ScopedFd fd = ScopedFd::openForRead(dir);
+            if (::fsync(fd.get()) < 0 && errno != EINVAL)
+            {
+                throw errnoError("Failed to sync directory " + dir.string());
+            }
+#endif
+        }
+
+        void DurableFile::writeAtomically(const fs::path &final_path, const char *data, size_t size)
+        {
+            fs::path temp_path = tempPathFor(final_path);
+            try
+            {
+                {
+                    ScopedFd fd = ScopedFd::openForWrite(temp_path);
+                    fd.writeAll(data, size);
+                    syncFd(fd.get(), temp_path);
+                }
+                fs::rename(temp_path, final_path);
+                syncDirectory(final_path.parent_path());
+            }
+            catch (...)
+            {
+                std::error_code ec;
+                fs::remove(temp_path, ec);
+                throw;
+            }
+        }
+
+        size_t DurableFile::removeStaleTempFiles(const fs::path &dir)
+        {
+            size_t removed = 0;
+            std::error_code ec;
+            for (const auto &entry : fs::directory_iterator(dir, ec))
+            {
+                if (entry.is_regular_file(ec) && isTempFile(entry.path()) && fs::remove(entry.path(), ec))
+                {
+                    ++removed;
+                }
+            }
+            if (removed > 0)
+            {
+                Logging::info("Removed stale temp files", {{"files", removed}, {"dir", dir.string()}});
+            }
+            return removed;
+        }
+
+        GroupCommitter::GroupCommitter(Config::ChunkConfig::Durability mode,
+                                       std::chrono::microseconds window,
+                                       size_t max_batch)
+            : mode(mode), window(window), max_batch(max_batch == 0 ? 1 : max_batch)
+        {
+            if (mode != Config::ChunkConfig::Durability::None)
+            {
+                worker = std::thread([this]
+                                     { run(); });
+            }
+        }
+
+        GroupCommitter::~GroupCommitter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+
+        void GroupCommitter::commit(fs::path temp_path, fs::path final_path, Callback done)
+        {
+            Entry entry{std::move(temp_path), std::move(final_path), std::move(done)};
+
+            if (mode == Config::ChunkConfig::Durability::None)
+            {
+                std::vector<Entry> batch;
+                batch.push_back(std::move(entry));
+                commitBatch(batch);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                if (stopping)
+                {
+                    throw std::runtime_error("commit on stopped GroupCommitter");
+                }
+                queue.push_back(std::move(entry));
+            }
+            condition.notify_one();
+        }
+
+        std::future<void> GroupCommitter::commit(fs::path temp_path, fs::path final_path)
+        {
+            auto promise = std::make_shared<std::promise<void>>();
+            std::future<void> result = promise->get_future();
+            commit(std::move(temp_path), std::move(final_path), [promise](std::exception_ptr error)
+                   {
+                       if (error)
+                           promise->set_exception(error);
+                       else
+                           promise->set_value(); });
+            return result;
+        }
+
+        void GroupCommitter::run()
+        {
+            const size_t batch_limit = mode == Config::ChunkConfig::Durability::GroupCommit ? max_batch : 1;
+
+            for (;;)
+            {
+                std::vector<Entry> batch;
+                {
+                    std::unique_lock<std::mutex> lock(queue_mutex);
+                    condition.wait(lock, [this]
+                                   { return stopping || !queue.empty(); });
+                    if (stopping && queue.empty())
+                        return;
+
+                    // Give concurrent writers a short window to join this batch
+                    if (batch_limit > 1 && !stopping)
+                    {
+                        condition.wait_for(lock, window, [this, batch_limit]
+                                           { return stopping || queue.size() >= batch_limit; });
+                    }
+
+                    while (!queue.empty() && batch.size() < batch_limit)
+                    {
+                        batch.push_back(std::move(queue.front()));
+                        queue.pop_front();
+                    }
+                }
+                commitBatch(batch);
+            }
+        }
+
+        void GroupCommitter::commitBatch(std::vector<Entry> &batch)
+        {
+            // 1. Make the data of every temp file durable
+            std::exception_ptr sync_error;
+            if (mode != Config::ChunkConfig::Durability::None)
+            {
+                try
+                {
+#if defined(__linux__)
+                    if (batch.size() > 1)
+                    {
+                        // One filesystem-wide flush covers the whole batch
+                        ScopedFd fd = ScopedFd::openForRead(batch.front().temp_path);
+                        if (::syncfs(fd.get()) < 0)
+                        {
+                            throw errnoError("syncfs failed");
+                        }
+                    }
+                    else
+#endif
+                    {
+                        for (const Entry &entry : batch)
+                        {
+                            DurableFile::syncData(entry.temp_path);
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    sync_error = std::current_exception();
+                }
+            }
+
+            // 2. Rename into place (atomic replace)
+            std::set<fs::path> dirs;
+            std::vector<std::exception_ptr> errors(batch.size());
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                Entry &entry = batch[i];
+                if (sync_error)
+                {
+                    errors[i] = sync_error;
+                    continue;
+                }
+                try
+                {
+                    fs::rename(entry.temp_path, entry.final_path);
+                    dirs.insert(entry.final_path.parent_path());
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+
+            // 3. Make the renames durable, once per directory
+            if (mode != Config::ChunkConfig::Durability::None)
+            {
+                for (const fs::path &dir : dirs)
+                {
+                    try
+                    {
+                        DurableFile::syncDirectory(dir);
+                    }
+                    catch (...)
+                    {
+                        for (size_t i = 0; i < batch.size(); ++i)
+                        {
+                            if (!errors[i] && batch[i].final_path.parent_path() == dir)
+                                errors[i] = std::current_exception();
+                        }
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                finish(batch[i], errors[i]);
+            }
+        }
+
+        void GroupCommitter::finish(Entry &entry, std::exception_ptr error)
+        {
+            if (error)
+            {
+                std::error_code ec;
+                fs::remove(entry.temp_path, ec);
+            }
+            try
+            {
+                if (entry.done)
+                    entry.done(error);
+            }
+            catch (...)
+            {
+            }
+        }
+
+    } // namespace IO
+} // namespace FileManager
@@ -0,0 +1,141 @@
+// src/io_engine.cpp
+#include "io_engine.hpp"
+#include "io_uring_engine.hpp"
+#include "zero_copy.hpp" // For ScopedFd
+#include "logger.hpp"
+#include <cerrno>
+#include <cstring>   // For std::strerror
+#include <stdexcept> // For std::runtime_error
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace FileManager
+{
+    namespace IO
+    {
+
+        namespace
+        {
+            std::vector<char> readWholeFile(const std::filesystem::path &path)
+            {
+                ScopedFd fd = ScopedFd::openForRead(path);
+                struct stat st;
+                if (::fstat(fd.get(), &st) < 0)
+                {
+                    throw std::runtime_error("Failed to stat " + path.string() + ": " + std::strerror(errno));
+                }
+
+                std::vector<char> buffer(static_cast<size_t>(st.st_size));
+                size_t done = 0;
+                while (done < buffer.size())
+                {
+                    ssize_t got = ::read(fd.get(), buffer.data() + done, buffer.size() - done);
+                    if (got < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        throw std::runtime_error("Failed to read " + path.string() + ": " + std::strerror(errno));
+                    }
+                    if (got == 0)
+                    {
+                        throw std::runtime_error("Unexpected end of file: " + path.string());
+                    }
+                    done += static_cast<size_t>(got);
+                }
+                return buffer;
+            }
+
+            void writeWholeFile(const std::filesystem::path &path, const char *data, size_t size)
+            {
+                ScopedFd::openForWrite(path).writeAll(data, size);
+            }
+        } // namespace
+
+        std::future<std::vector<char>> IoEngine::read(std::filesystem::path path)
+        {
+            auto promise = std::make_shared<std::promise<std::vector<char>>>();
+            std::future<std::vector<char>> result = promise->get_future();
+            submitRead(std::move(path), [promise](std::vector<char> data, std::exception_ptr error)
+                       {
+                           if (error)
+                               promise->set_exception(error);
+                           else
+                               promise->set_value(std::move(data)); });
+            return result;
+        }
+
+        std::future<void> IoEngine::write(std::filesystem::path path, const char *data, size_t size)
+        {
+            auto promise = std::make_shared<std::promise<void>>();
+            std::future<void> result = promise->get_future();
+            submitWrite(std::move(path), data, size, [promise](std::exception_ptr error)
+                        {
+                            if (error)
+                                promise->set_exception(error);
+                            else
+                                promise->set_value(); });
+            return result;
+        }
+
+        std::unique_ptr<IoEngine> IoEngine::create(Concurrency::ThreadPool &fallback_pool, unsigned queue_depth,
+                                                   bool allow_io_uring)
+        {
+#if defined(__linux__)
+            if (allow_io_uring)
+            {
+                try
+                {
+                    auto engine = std::make_unique<IoUringEngine>(queue_depth);
+                    Logging::info("I/O engine: io_uring", {{"queue_depth", queue_depth}});
+                    return engine;
+                }
+                catch (const std::exception &e)
+                {
+                    Logging::warn("io_uring unavailable, falling back to thread pool I/O", {{"error", e.what()}});
+                }
+            }
+#else
+            (void)queue_depth;
+            (void)allow_io_uring;
+#endif
+            Logging::info("I/O engine: thread_pool");
+            return std::make_unique<ThreadPoolIoEngine>(fallback_pool);
+        }
+
+        void ThreadPoolIoEngine::submitRead(std::filesystem::path path, ReadCallback on_complete)
+        {
+            pool.enqueue([path = std::move(path), on_complete = std::move(on_complete)]()
+                         {
+                             std::vector<char> data;
+                             std::exception_ptr error;
+                             try
+                             {
+                                 data = readWholeFile(path);
+                             }
+                             catch (...)
+                             {
+                                 error = std::current_exception();
+                             }
+                             on_complete(std::move(data), error); });
+        }
+
+        void ThreadPoolIoEngine::submitWrite(std::filesystem::path path, const char *data, size_t size,
+                                             WriteCallback on_complete)
+        {
+            pool.enqueue([path = std::move(path), data, size, on_complete = std::move(on_complete)]()
+                         {
+                             std::exception_ptr error;
+                             try
+                             {
+                                 writeWholeFile(path, data, size);
+                             }
+                             catch (...)
+                             {
+                                 error = std::current_exception();
+                             }
+                             on_complete(error); });
+        }
+
+    } // namespace IO
+} // namespace FileManager
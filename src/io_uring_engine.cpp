@@ -0,0 +1,411 @@
+// src/io_uring_engine.cpp
+#include "io_uring_engine.hpp"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <cstring>   // For std::memset, std::strerror
+#include <stdexcept> // For std::runtime_error
+#include <algorithm> // For std::min
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+namespace FileManager
+{
+    namespace IO
+    {
+
+        namespace
+        {
+            // user_data value of the eventfd read used to wake the engine thread
+            constexpr uint64_t DOORBELL_TAG = 0;
+            // Largest single read/write handed to the kernel; longer transfers are resubmitted
+            constexpr size_t MAX_TRANSFER = 1u << 30;
+
+            int ioUringSetup(unsigned entries, io_uring_params *params)
+            {
+                return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+            }
+
+            int ioUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+            {
+                return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+            }
+
+            unsigned loadAcquire(const unsigned *p)
+            {
+                return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+            }
+
+            void storeRelease(unsigned *p, unsigned v)
+            {
+                __atomic_store_n(p, v, __ATOMIC_RELEASE);
+            }
+
+            std::runtime_error errnoError(const std::string &what, int err)
+            {
+                return std::runtime_error(what + ": " + std::strerror(err));
+            }
+        } // namespace
+
+        IoUringEngine::IoUringEngine(unsigned queue_depth) : queue_depth(queue_depth == 0 ? 1 : queue_depth)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+
+            // One extra slot for the doorbell read that is always in flight
+            ring_fd = ioUringSetup(this->queue_depth + 1, &params);
+            if (ring_fd < 0)
+            {
+                throw errnoError("io_uring_setup failed", errno);
+            }
+
+            // IORING_OP_READ/WRITE arrived in 5.6 together with this feature flag
+            if (!(params.features & IORING_FEAT_RW_CUR_POS))
+            {
+                ::close(ring_fd);
+                throw std::runtime_error("io_uring is too old (needs Linux 5.6+ for IORING_OP_READ/WRITE)");
+            }
+
+            sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap)
+            {
+                sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+            }
+
+            sq_ring_ptr = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                 ring_fd, IORING_OFF_SQ_RING);
+            if (sq_ring_ptr == MAP_FAILED)
+            {
+                int err = errno;
+                ::close(ring_fd);
+                throw errnoError("Failed to map io_uring submission ring", err);
+            }
+
+            if (single_mmap)
+            {
+                cq_ring_ptr = sq_ring_ptr;
+            }
+            else
+            {
+                cq_ring_ptr = ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                     ring_fd, IORING_OFF_CQ_RING);
+                if (cq_ring_ptr == MAP_FAILED)
+                {
+                    int err = errno;
+                    ::munmap(sq_ring_ptr, sq_ring_size);
+                    ::close(ring_fd);
+                    throw errnoError("Failed to map io_uring completion ring", err);
+                }
+            }
+
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void *sqes_ptr = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                    ring_fd, IORING_OFF_SQES);
+            if (sqes_ptr == MAP_FAILED)
+            {
+                int err = errno;
+                if (!single_mmap)
+                {
+                    ::munmap(cq_ring_ptr, cq_ring_size);
+                }
+                ::munmap(sq_ring_ptr, sq_ring_size);
+                ::close(ring_fd);
+                throw errnoError("Failed to map io_uring submission entries", err);
+            }
+            sqes = static_cast<io_uring_sqe *>(sqes_ptr);
+
+            char *sq = static_cast<char *>(sq_ring_ptr);
+            sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+            sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+            char *cq = static_cast<char *>(cq_ring_ptr);
+            cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+            int efd = ::eventfd(0, EFD_CLOEXEC);
+            if (efd < 0)
+            {
+                int err = errno;
+                ::munmap(sqes, sqes_size);
+                if (!single_mmap)
+                {
+                    ::munmap(cq_ring_ptr, cq_ring_size);
+                }
+                ::munmap(sq_ring_ptr, sq_ring_size);
+                ::close(ring_fd);
+                throw errnoError("Failed to create io_uring doorbell eventfd", err);
+            }
+            doorbell_fd = ScopedFd(efd);
+
+            worker = std::thread([this]
+                                 { run(); });
+        }
+
+        IoUringEngine::~IoUringEngine()
+        {
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex);
+                stopping = true;
+            }
+            ringDoorbell();
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+
+            // Closing the ring cancels the doorbell read that is still armed
+            ::munmap(sqes, sqes_size);
+            if (cq_ring_ptr != sq_ring_ptr)
+            {
+                ::munmap(cq_ring_ptr, cq_ring_size);
+            }
+            ::munmap(sq_ring_ptr, sq_ring_size);
+            ::close(ring_fd);
+        }
+
+        void IoUringEngine::submitRead(std::filesystem::path path, ReadCallback on_complete)
+        {
+            auto request = std::make_unique<Request>();
+            request->path = std::move(path);
+            request->on_read = std::move(on_complete);
+            enqueue(std::move(request));
+        }
+
+        void IoUringEngine::submitWrite(std::filesystem::path path, const char *data, size_t size,
+                                        WriteCallback on_complete)
+        {
+            auto request = std::make_unique<Request>();
+            request->is_write = true;
+            request->path = std::move(path);
+            request->write_data = data;
+            request->size = size;
+            request->on_write = std::move(on_complete);
+            enqueue(std::move(request));
+        }
+
+        void IoUringEngine::enqueue(std::unique_ptr<Request> request)
+        {
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex);
+                if (stopping)
+                {
+                    throw std::runtime_error("submit on stopped IoUringEngine");
+                }
+                pending.push_back(std::move(request));
+            }
+            ringDoorbell();
+        }
+
+        void IoUringEngine::ringDoorbell()
+        {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(doorbell_fd.get(), &one, sizeof(one));
+            (void)ignored; // Counter overflow just means the engine is already awake
+        }
+
+        void IoUringEngine::armDoorbell()
+        {
+            io_uring_sqe *sqe = nextSqe();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = doorbell_fd.get();
+            sqe->addr = reinterpret_cast<uint64_t>(&doorbell_value);
+            sqe->len = sizeof(doorbell_value);
+            sqe->user_data = DOORBELL_TAG;
+        }
+
+        io_uring_sqe *IoUringEngine::nextSqe()
+        {
+            // Only the engine thread produces SQEs, and in-flight work never exceeds the ring
+            // size (queue_depth requests + the doorbell), so a slot is always free here.
+            unsigned tail = *sq_tail;
+            unsigned index = tail & *sq_mask;
+            io_uring_sqe *sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sq_array[index] = index;
+            storeRelease(sq_tail, tail + 1);
+            return sqe;
+        }
+
+        void IoUringEngine::run()
+        {
+            armDoorbell();
+
+            for (;;)
+            {
+                std::deque<std::unique_ptr<Request>> batch;
+                bool stop = false;
+                {
+                    std::lock_guard<std::mutex> lock(pending_mutex);
+                    while (!pending.empty() && in_flight + batch.size() < queue_depth)
+                    {
+                        batch.push_back(std::move(pending.front()));
+                        pending.pop_front();
+                    }
+                    stop = stopping && pending.empty();
+                }
+
+                for (auto &request : batch)
+                {
+                    start(std::move(request));
+                }
+
+                if (stop && in_flight == 0)
+                {
+                    return;
+                }
+
+                // Submit everything queued since the last call and wait for at least one completion
+                // (the doorbell counts, so new submissions always wake us up).
+                unsigned to_submit = *sq_tail - loadAcquire(sq_head);
+                // EINTR/EAGAIN/EBUSY are transient: reap what completed and try again.
+                ioUringEnter(ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS);
+                reapCompletions();
+            }
+        }
+
+        void IoUringEngine::start(std::unique_ptr<Request> request)
+        {
+            Request *raw = request.release(); // Owned by the ring until finish()
+            try
+            {
+                if (raw->is_write)
+                {
+                    raw->fd = ScopedFd::openForWrite(raw->path);
+                }
+                else
+                {
+                    raw->fd = ScopedFd::openForRead(raw->path);
+                    struct stat st;
+                    if (::fstat(raw->fd.get(), &st) < 0)
+                    {
+                        throw errnoError("Failed to stat " + raw->path.string(), errno);
+                    }
+                    raw->size = static_cast<size_t>(st.st_size);
+                    raw->read_buffer.resize(raw->size);
+                }
+            }
+            catch (...)
+            {
+                ++in_flight; // finish() decrements
+                finish(raw, std::current_exception());
+                return;
+            }
+
+            ++in_flight;
+            if (raw->size == 0)
+            {
+                finish(raw, nullptr);
+                return;
+            }
+            queueTransfer(raw);
+        }
+
+        void IoUringEngine::queueTransfer(Request *request)
+        {
+            size_t remaining = std::min(request->size - request->done, MAX_TRANSFER);
+
+            io_uring_sqe *sqe = nextSqe();
+            sqe->opcode = request->is_write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->fd = request->fd.get();
+            sqe->off = request->done;
+            sqe->addr = request->is_write
+                            ? reinterpret_cast<uint64_t>(request->write_data + request->done)
+                            : reinterpret_cast<uint64_t>(request->read_buffer.data() + request->done);
+            sqe->len = static_cast<uint32_t>(remaining);
+            sqe->user_data = reinterpret_cast<uint64_t>(request);
+        }
+
+        unsigned IoUringEngine::reapCompletions()
+        {
+            unsigned reaped = 0;
+            unsigned head = *cq_head;
+            unsigned tail = loadAcquire(cq_tail);
+            while (head != tail)
+            {
+                const io_uring_cqe &cqe = cqes[head & *cq_mask];
+                uint64_t user_data = cqe.user_data;
+                int32_t result = cqe.res;
+                ++head;
+                ++reaped;
+
+                if (user_data == DOORBELL_TAG)
+                {
+                    armDoorbell();
+                }
+                else
+                {
+                    handleCompletion(reinterpret_cast<Request *>(user_data), result);
+                }
+            }
+            storeRelease(cq_head, head);
+            return reaped;
+        }
+
+        void IoUringEngine::handleCompletion(Request *request, int32_t result)
+        {
+            if (result == -EINTR || result == -EAGAIN)
+            {
+                queueTransfer(request);
+                return;
+            }
+            if (result < 0)
+            {
+                std::string op = request->is_write ? "write " : "read ";
+                finish(request, std::make_exception_ptr(errnoError("io_uring " + op + request->path.string() + " failed", -result)));
+                return;
+            }
+            if (result == 0)
+            {
+                finish(request, std::make_exception_ptr(std::runtime_error("Unexpected end of file: " + request->path.string())));
+                return;
+            }
+
+            request->done += static_cast<size_t>(result);
+            if (request->done < request->size)
+            {
+                queueTransfer(request); // Short transfer; continue where it stopped
+                return;
+            }
+            finish(request, nullptr);
+        }
+
+        void IoUringEngine::finish(Request *raw, std::exception_ptr error)
+        {
+            std::unique_ptr<Request> request(raw);
+            --in_flight;
+            request->fd = ScopedFd(); // Close before notifying so the file is complete on disk
+
+            // Callbacks run on the engine thread; never let one take the engine down.
+            try
+            {
+                if (request->is_write)
+                {
+                    if (request->on_write)
+                        request->on_write(error);
+                }
+                else if (request->on_read)
+                {
+                    request->on_read(error ? std::vector<char>() : std::move(request->read_buffer), error);
+                }
+            }
+            catch (...)
+            {
+            }
+        }
+
+    } // namespace IO
+} // namespace FileManager
+
+#endif // defined(__linux__)
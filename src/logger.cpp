@@ -0,0 +1,339 @@
+// src/logger.cpp
+#include "logger.hpp"
+#include "metrics.hpp" // For fm_log_records_dropped_total
+#include <algorithm>   // For std::stable_sort
+#include <array>
+#include <cstdio>  // For std::fwrite, std::fflush, std::snprintf
+#include <cstdlib> // For std::getenv
+#include <ctime>   // For gmtime_r
+
+namespace FileManager
+{
+    namespace Logging
+    {
+
+        struct Logger::Record
+        {
+            std::chrono::system_clock::time_point time;
+            Level level = Level::Info;
+            uint64_t thread_number = 0;
+            std::string message;
+            std::vector<Field> fields;
+        };
+
+        // Single-producer (the owning thread), single-consumer (drain) ring of records
+        struct Logger::Ring
+        {
+            static const size_t CAPACITY = 1024;
+
+            std::array<Record, CAPACITY> slots;
+            alignas(64) std::atomic<size_t> head{0}; // Next slot the producer fills
+            alignas(64) std::atomic<size_t> tail{0}; // Next slot the consumer takes
+            std::atomic<bool> abandoned{false};      // Owning thread exited; removed once drained
+            uint64_t thread_number = 0;
+        };
+
+        namespace
+        {
+            // Holds the calling thread's ring and marks it abandoned when the thread exits
+            template <typename Ring>
+            struct RingHandle
+            {
+                std::shared_ptr<Ring> ring;
+                ~RingHandle()
+                {
+                    if (ring)
+                        ring->abandoned.store(true, std::memory_order_release);
+                }
+            };
+
+            Metrics::Counter &dropped_records = Metrics::Registry::global().counter(
+                "fm_log_records_dropped_total", "Log records dropped because a thread's log buffer was full");
+
+            const char *levelName(Level level)
+            {
+                static const char *const names[] = {"debug", "info", "warn", "error"};
+                return names[static_cast<int>(level)];
+            }
+
+            void appendJsonString(std::string &out, const std::string &value)
+            {
+                out += '"';
+                for (char c : value)
+                {
+                    switch (c)
+                    {
+                    case '"':
+                        out += "\\\"";
+                        break;
+                    case '\\':
+                        out += "\\\\";
+                        break;
+                    case '\n':
+                        out += "\\n";
+                        break;
+                    case '\r':
+                        out += "\\r";
+                        break;
+                    case '\t':
+                        out += "\\t";
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20)
+                        {
+                            char escaped[8];
+                            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                            out += escaped;
+                        }
+                        else
+                        {
+                            out += c;
+                        }
+                    }
+                }
+                out += '"';
+            }
+
+            // ISO 8601 UTC with milliseconds, e.g. 2024-01-01T12:00:00.123Z
+            void appendTimestamp(std::string &out, std::chrono::system_clock::time_point time)
+            {
+                const auto since_epoch = time.time_since_epoch();
+                const std::time_t seconds = static_cast<std::time_t>(std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count());
+                const long millis = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count() % 1000);
+                std::tm utc{};
+                gmtime_r(&seconds, &utc);
+                char buffer[32];
+                size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &utc);
+                std::snprintf(buffer + length, sizeof(buffer) - length, ".%03ldZ", millis);
+                out += buffer;
+            }
+        } // namespace
+
+        Field::Field(const char *key, double value) : key(key), quoted(false)
+        {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+            this->value = buffer;
+        }
+
+        Logger &Logger::global()
+        {
+            static Logger logger;
+            return logger;
+        }
+
+        Logger::Logger()
+        {
+            if (const char *level = std::getenv("FM_LOG_LEVEL"))
+            {
+                std::string value(level);
+                if (value == "debug")
+                    min_level = Level::Debug;
+                else if (value == "info")
+                    min_level = Level::Info;
+                else if (value == "warn")
+                    min_level = Level::Warn;
+                else if (value == "error")
+                    min_level = Level::Error;
+                else if (!value.empty())
+                    std::fprintf(stderr, "Ignoring invalid value for FM_LOG_LEVEL: %s\n", level);
+            }
+            if (const char *format = std::getenv("FM_LOG_FORMAT"))
+            {
+                std::string value(format);
+                if (value == "json" || value == "text")
+                    json = value == "json";
+                else if (!value.empty())
+                    std::fprintf(stderr, "Ignoring invalid value for FM_LOG_FORMAT: %s\n", format);
+            }
+            writer = std::thread(&Logger::writerLoop, this);
+        }
+
+        Logger::~Logger()
+        {
+            {
+                std::lock_guard<std::mutex> lock(writer_mutex);
+                stopping = true;
+            }
+            writer_wakeup.notify_all();
+            if (writer.joinable())
+            {
+                writer.join(); // Drains whatever is left
+            }
+        }
+
+        Logger::Ring &Logger::ringForThread()
+        {
+            thread_local RingHandle<Ring> handle;
+            if (!handle.ring)
+            {
+                handle.ring = std::make_shared<Ring>();
+                std::lock_guard<std::mutex> lock(rings_mutex);
+                handle.ring->thread_number = next_thread_number++;
+                rings.push_back(handle.ring);
+            }
+            return *handle.ring;
+        }
+
+        void Logger::log(Level level, std::string message, std::vector<Field> fields)
+        {
+            if (!enabled(level))
+            {
+                return;
+            }
+            Ring &ring = ringForThread();
+            const size_t head = ring.head.load(std::memory_order_relaxed);
+            if (head - ring.tail.load(std::memory_order_acquire) >= Ring::CAPACITY)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                dropped_records.add();
+                return;
+            }
+
+            Record &record = ring.slots[head % Ring::CAPACITY];
+            record.time = std::chrono::system_clock::now();
+            record.level = level;
+            record.thread_number = ring.thread_number;
+            record.message = std::move(message);
+            record.fields = std::move(fields);
+            ring.head.store(head + 1, std::memory_order_release);
+
+            if (level == Level::Error)
+            {
+                urgent.store(true, std::memory_order_relaxed);
+                writer_wakeup.notify_one();
+            }
+        }
+
+        void Logger::flush()
+        {
+            drain();
+        }
+
+        void Logger::writerLoop()
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex);
+            while (!stopping)
+            {
+                writer_wakeup.wait_for(lock, FLUSH_INTERVAL, [this]
+                                       { return stopping || urgent.load(std::memory_order_relaxed); });
+                urgent.store(false, std::memory_order_relaxed);
+                lock.unlock();
+                drain();
+                lock.lock();
+            }
+            lock.unlock();
+            drain();
+        }
+
+        void Logger::drain()
+        {
+            std::lock_guard<std::mutex> drain_lock(drain_mutex);
+            std::vector<std::shared_ptr<Ring>> current;
+            {
+                std::lock_guard<std::mutex> lock(rings_mutex);
+                current = rings;
+            }
+
+            std::vector<Record> batch;
+            std::vector<const Ring *> finished;
+            for (const auto &ring : current)
+            {
+                // Read `abandoned` first: once set, no more records follow the head read after it
+                const bool abandoned = ring->abandoned.load(std::memory_order_acquire);
+                size_t tail = ring->tail.load(std::memory_order_relaxed);
+                const size_t head = ring->head.load(std::memory_order_acquire);
+                for (; tail != head; ++tail)
+                {
+                    batch.push_back(std::move(ring->slots[tail % Ring::CAPACITY]));
+                }
+                ring->tail.store(tail, std::memory_order_release);
+                if (abandoned)
+                {
+                    finished.push_back(ring.get());
+                }
+            }
+            if (!finished.empty())
+            {
+                std::lock_guard<std::mutex> lock(rings_mutex);
+                rings.erase(std::remove_if(rings.begin(), rings.end(), [&finished](const std::shared_ptr<Ring> &ring)
+                                           { return std::find(finished.begin(), finished.end(), ring.get()) != finished.end(); }),
+                            rings.end());
+            }
+
+            if (uint64_t lost = dropped.exchange(0, std::memory_order_relaxed))
+            {
+                Record record;
+                record.time = std::chrono::system_clock::now();
+                record.level = Level::Warn;
+                record.message = "Dropped log records: log buffer full";
+                record.fields.emplace_back("dropped", lost);
+                batch.push_back(std::move(record));
+            }
+            if (batch.empty())
+            {
+                return;
+            }
+
+            // Each ring is in order; interleave them by time
+            std::stable_sort(batch.begin(), batch.end(), [](const Record &a, const Record &b)
+                             { return a.time < b.time; });
+
+            std::string out;
+            std::string err;
+            for (const Record &record : batch)
+            {
+                std::string &line = record.level >= Level::Warn ? err : out;
+                if (json)
+                {
+                    line += "{\"ts\":\"";
+                    appendTimestamp(line, record.time);
+                    line += "\",\"level\":\"";
+                    line += levelName(record.level);
+                    line += "\",\"thread\":" + std::to_string(record.thread_number) + ",\"msg\":";
+                    appendJsonString(line, record.message);
+                    for (const Field &field : record.fields)
+                    {
+                        line += ',';
+                        appendJsonString(line, field.key);
+                        line += ':';
+                        if (field.quoted)
+                            appendJsonString(line, field.value);
+                        else
+                            line += field.value;
+                    }
+                    line += "}\n";
+                }
+                else
+                {
+                    appendTimestamp(line, record.time);
+                    line += ' ';
+                    line += levelName(record.level);
+                    line += " [" + std::to_string(record.thread_number) + "] " + record.message;
+                    for (const Field &field : record.fields)
+                    {
+                        line += ' ';
+                        line += field.key;
+                        line += '=';
+                        if (field.quoted && field.value.find_first_of(" \"=") != std::string::npos)
+                            appendJsonString(line, field.value);
+                        else
+                            line += field.value;
+                    }
+                    line += '\n';
+                }
+            }
+            if (!out.empty())
+            {
+                std::fwrite(out.data(), 1, out.size(), stdout);
+                std::fflush(stdout);
+            }
+            if (!err.empty())
+            {
+                std::fwrite(err.data(), 1, err.size(), stderr);
+                std::fflush(stderr);
+            }
+        }
+
+    } // namespace Logging
+} // namespace FileManager
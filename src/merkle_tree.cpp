@@ -0,0 +1,182 @@
+// src/merkle_tree.cpp
+#include "merkle_tree.hpp"
+#include <stdexcept> // For std::out_of_range
+#include <algorithm> // For std::max, std::min
+
+#include <openssl/sha.h>
+
+namespace FileManager
+{
+    namespace CID
+    {
+
+        namespace
+        {
+            const uint8_t LEAF_PREFIX = 0x00;
+            const uint8_t NODE_PREFIX = 0x01;
+        } // namespace
+
+        MerkleTree::MerkleTree(const std::vector<std::string> &chunk_cids)
+        {
+            levels.emplace_back();
+            levels.back().reserve(chunk_cids.size());
+            for (const std::string &cid : chunk_cids)
+            {
+                levels.back().push_back(hashLeaf(CIDUtility::toBinary(cid)));
+            }
+            while (levels.back().size() > 1)
+            {
+                const std::vector<BinaryCID> &below = levels.back();
+                std::vector<BinaryCID> level;
+                level.reserve((below.size() + 1) / 2);
+                for (size_t i = 0; i < below.size(); i += 2)
+                {
+                    level.push_back(i + 1 < below.size() ? hashPair(below[i], below[i + 1]) : below[i]);
+                }
+                levels.push_back(std::move(level));
+            }
+        }
+
+        BinaryCID MerkleTree::root() const
+        {
+            if (levels.back().empty())
+            {
+                BinaryCID empty;
+                SHA256(&LEAF_PREFIX, 1, empty.data());
+                return empty;
+            }
+            return levels.back().front();
+        }
+
+        std::string MerkleTree::rootOf(const std::vector<std::string> &chunk_cids)
+        {
+            return CIDUtility::toHex(MerkleTree(chunk_cids).root());
+        }
+
+        std::vector<BinaryCID> MerkleTree::proof(size_t index) const
+        {
+            if (index >= leafCount())
+            {
+                throw std::out_of_range("Chunk index " + std::to_string(index) + " out of range.");
+            }
+            std::vector<BinaryCID> siblings;
+            for (size_t level = 0; level + 1 < levels.size(); ++level, index /= 2)
+            {
+                size_t sibling = index ^ 1;
+                if (sibling < levels[level].size())
+                {
+                    siblings.push_back(levels[level][sibling]);
+                }
+            }
+            return siblings;
+        }
+
+        bool MerkleTree::verify(const std::string &chunk_cid, size_t index, size_t leaf_count,
+                                const std::vector<BinaryCID> &proof, const BinaryCID &root)
+        {
+            if (index >= leaf_count || !CIDUtility::isValidCID(chunk_cid))
+            {
+                return false;
+            }
+            BinaryCID hash = hashLeaf(CIDUtility::toBinary(chunk_cid));
+            size_t used = 0;
+            for (size_t width = leaf_count; width > 1; width = (width + 1) / 2, index /= 2)
+            {
+                size_t sibling = index ^ 1;
+                if (sibling >= width)
+                {
+                    continue; // Carried up
+                }
+                if (used == proof.size())
+                {
+                    return false;
+                }
+                hash = index & 1 ? hashPair(proof[used], hash) : hashPair(hash, proof[used]);
+                ++used;
+            }
+            return used == proof.size() && hash == root;
+        }
+
+        std::vector<std::pair<size_t, size_t>> MerkleTree::diff(const MerkleTree &a, const MerkleTree &b)
+        {
+            std::vector<std::pair<size_t, size_t>> ranges;
+            auto add = [&ranges](size_t first, size_t end)
+            {
+                if (!ranges.empty() && ranges.back().second == first)
+                {
+                    ranges.back().second = end;
+                }
+                else
+                {
+                    ranges.emplace_back(first, end);
+                }
+            };
+
+            // Depth-first from the top of the taller tree, left to right, so ranges come out in order
+            const size_t top = std::max(a.levels.size(), b.levels.size()) - 1;
+            std::vector<std::pair<size_t, size_t>> stack{{top, 0}}; // Level, index
+            while (!stack.empty())
+            {
+                auto [level, index] = stack.back();
+                stack.pop_back();
+                const BinaryCID *node_a = a.node(level, index);
+                const BinaryCID *node_b = b.node(level, index);
+                if (node_a == nullptr && node_b == nullptr)
+                {
+                    continue;
+                }
+                if (node_a != nullptr && node_b != nullptr)
+                {
+                    if (*node_a == *node_b)
+                    {
+                        continue; // Same chunks below
+                    }
+                    if (level > 0)
+                    {
+                        stack.emplace_back(level - 1, 2 * index + 1);
+                        stack.emplace_back(level - 1, 2 * index);
+                        continue;
+                    }
+                }
+                // A differing chunk, or chunks only one of the files has
+                size_t leaves = (node_a != nullptr ? a : b).leafCount();
+                size_t first = index << level;
+                add(first, std::min(first + (size_t{1} << level), leaves));
+            }
+            return ranges;
+        }
+
+        // Node `index` of `level`, or nullptr if the tree has none there. Above its root, a tree
+        // is taken to continue with its root carried up.
+        const BinaryCID *MerkleTree::node(size_t level, size_t index) const
+        {
+            if (level >= levels.size())
+            {
+                return index == 0 && !levels.back().empty() ? &levels.back().front() : nullptr;
+            }
+            return index < levels[level].size() ? &levels[level][index] : nullptr;
+        }
+
+        BinaryCID MerkleTree::hashLeaf(const BinaryCID &cid)
+        {
+            uint8_t buffer[1 + sizeof(BinaryCID)];
+            buffer[0] = LEAF_PREFIX;
+            std::copy(cid.begin(), cid.end(), buffer + 1);
+            BinaryCID hash;
+            SHA256(buffer, sizeof(buffer), hash.data());
+            return hash;
+        }
+
+        BinaryCID MerkleTree::hashPair(const BinaryCID &left, const BinaryCID &right)
+        {
+            uint8_t buffer[1 + 2 * sizeof(BinaryCID)];
+            buffer[0] = NODE_PREFIX;
+            std::copy(left.begin(), left.end(), buffer + 1);
+            std::copy(right.begin(), right.end(), buffer + 1 + sizeof(BinaryCID));
+            BinaryCID hash;
+            SHA256(buffer, sizeof(buffer), hash.data());
+            return hash;
+        }
+
+    } // namespace CID
+} // namespace FileManager
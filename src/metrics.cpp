@@ -0,0 +1,254 @@
+// src/metrics.cpp
+#include "metrics.hpp"
+#include <cmath>     // For std::ldexp
+#include <cstdio>    // For std::snprintf
+#include <stdexcept> // For std::runtime_error
+
+namespace FileManager
+{
+    namespace Metrics
+    {
+
+        namespace
+        {
+            // Prometheus label values escape backslashes, quotes and newlines
+            std::string escapeLabelValue(const std::string &value)
+            {
+                std::string escaped;
+                escaped.reserve(value.size());
+                for (char c : value)
+                {
+                    if (c == '\\' || c == '"')
+                    {
+                        escaped += '\\';
+                        escaped += c;
+                    }
+                    else if (c == '\n')
+                    {
+                        escaped += "\\n";
+                    }
+                    else
+                    {
+                        escaped += c;
+                    }
+                }
+                return escaped;
+            }
+
+            // `{a="x",b="y"}`, with an optional extra label appended (histogram buckets' `le`)
+            std::string formatLabels(const Labels &labels, const std::string &extra_name = "",
+                                     const std::string &extra_value = "")
+            {
+                if (labels.empty() && extra_name.empty())
+                {
+                    return "";
+                }
+                std::string out = "{";
+                for (const auto &[name, value] : labels)
+                {
+                    if (out.size() > 1)
+                        out += ',';
+                    out += name + "=\"" + escapeLabelValue(value) + "\"";
+                }
+                if (!extra_name.empty())
+                {
+                    if (out.size() > 1)
+                        out += ',';
+                    out += extra_name + "=\"" + extra_value + "\"";
+                }
+                return out + "}";
+            }
+
+            std::string formatDouble(double value)
+            {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+                return buffer;
+            }
+
+            const char *typeName(int type)
+            {
+                static const char *const names[] = {"counter", "gauge", "histogram"};
+                return names[type];
+            }
+        } // namespace
+
+        size_t shardIndex()
+        {
+            static std::atomic<size_t> next{0};
+            thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+            return index;
+        }
+
+        uint64_t Counter::value() const
+        {
+            uint64_t total = 0;
+            for (const Shard &shard : shards)
+            {
+                total += shard.value.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        void Histogram::observe(std::chrono::nanoseconds elapsed)
+        {
+            const uint64_t ns = elapsed.count() > 0 ? static_cast<uint64_t>(elapsed.count()) : 0;
+            // Smallest k with ns <= 2^k us: the bit width of (ceil(us) - 1)
+            const uint64_t us = (ns + 999) / 1000;
+            size_t bucket = us <= 1 ? 0 : static_cast<size_t>(64 - __builtin_clzll(us - 1));
+            if (bucket > BUCKETS)
+            {
+                bucket = BUCKETS; // Overflow
+            }
+            Shard &shard = shards[shardIndex()];
+            shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            shard.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        }
+
+        double Histogram::bucketBound(size_t k)
+        {
+            return std::ldexp(1e-6, static_cast<int>(k));
+        }
+
+        Histogram::Snapshot Histogram::snapshot() const
+        {
+            Snapshot snapshot;
+            uint64_t sum_ns = 0;
+            for (const Shard &shard : shards)
+            {
+                for (size_t k = 0; k <= BUCKETS; ++k)
+                {
+                    uint64_t n = shard.buckets[k].load(std::memory_order_relaxed);
+                    snapshot.buckets[k] += n;
+                    snapshot.count += n;
+                }
+                sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+            }
+            snapshot.sum_seconds = static_cast<double>(sum_ns) / 1e9;
+            return snapshot;
+        }
+
+        Registry &Registry::global()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        Registry::Series &Registry::series(const std::string &name, const std::string &help, Type type, const Labels &labels)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto found = by_name.find(name);
+            Family *family;
+            if (found == by_name.end())
+            {
+                families.push_back(std::make_unique<Family>());
+                family = families.back().get();
+                family->name = name;
+                family->help = help;
+                family->type = type;
+                by_name.emplace(name, family);
+            }
+            else
+            {
+                family = found->second;
+                if (family->type != type)
+                {
+                    throw std::runtime_error("Metric " + name + " is already registered as a " +
+                                             typeName(static_cast<int>(family->type)));
+                }
+            }
+
+            for (const auto &existing : family->series)
+            {
+                if (existing->labels == labels)
+                {
+                    return *existing;
+                }
+            }
+            family->series.push_back(std::make_unique<Series>());
+            Series &created = *family->series.back();
+            created.labels = labels;
+            switch (type)
+            {
+            case Type::Counter:
+                created.counter = std::make_unique<Counter>();
+                break;
+            case Type::Gauge:
+                created.gauge = std::make_unique<Gauge>();
+                break;
+            case Type::Histogram:
+                created.histogram = std::make_unique<Histogram>();
+                break;
+            }
+            return created;
+        }
+
+        Counter &Registry::counter(const std::string &name, const std::string &help, const Labels &labels)
+        {
+            return *series(name, help, Type::Counter, labels).counter;
+        }
+
+        Gauge &Registry::gauge(const std::string &name, const std::string &help, const Labels &labels)
+        {
+            return *series(name, help, Type::Gauge, labels).gauge;
+        }
+
+        Histogram &Registry::histogram(const std::string &name, const std::string &help, const Labels &labels)
+        {
+            return *series(name, help, Type::Histogram, labels).histogram;
+        }
+
+        std::string Registry::renderPrometheus() const
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::string out;
+            for (const auto &family : families)
+            {
+                out += "# HELP " + family->name + " " + family->help + "\n";
+                out += "# TYPE " + family->name + " " + typeName(static_cast<int>(family->type)) + "\n";
+                for (const auto &series : family->series)
+                {
+                    switch (family->type)
+                    {
+                    case Type::Counter:
+                        out += family->name + formatLabels(series->labels) + " " +
+                               std::to_string(series->counter->value()) + "\n";
+                        break;
+                    case Type::Gauge:
+                        out += family->name + formatLabels(series->labels) + " " +
+                               std::to_string(series->gauge->value()) + "\n";
+                        break;
+                    case Type::Histogram:
+                    {
+                        Histogram::Snapshot snapshot = series->histogram->snapshot();
+                        uint64_t cumulative = 0;
+                        for (size_t k = 0; k < Histogram::BUCKETS; ++k)
+                        {
+                            cumulative += snapshot.buckets[k];
+                            out += family->name + "_bucket" +
+                                   formatLabels(series->labels, "le", formatDouble(Histogram::bucketBound(k))) + " " +
+                                   std::to_string(cumulative) + "\n";
+                        }
+                        out += family->name + "_bucket" + formatLabels(series->labels, "le", "+Inf") + " " +
+                               std::to_string(snapshot.count) + "\n";
+                        out += family->name + "_sum" + formatLabels(series->labels) + " " +
+                               formatDouble(snapshot.sum_seconds) + "\n";
+                        out += family->name + "_count" + formatLabels(series->labels) + " " +
+                               std::to_string(snapshot.count) + "\n";
+                        break;
+                    }
+                    }
+                }
+            }
+            return out;
+        }
+
+        Histogram &stageDuration(const std::string &stage)
+        {
+            return Registry::global().histogram("fm_stage_duration_seconds",
+                                                "Time spent in each stage of storing and retrieving chunks and files",
+                                                {{"stage", stage}});
+        }
+
+    } // namespace Metrics
+} // namespace FileManager
@@ -0,0 +1,42 @@
+// src/rate_limiter.cpp
+#include "rate_limiter.hpp"
+#include <algorithm> // For std::min, std::max
+#include <thread>    // For std::this_thread::sleep_for
+
+namespace FileManager
+{
+    namespace Concurrency
+    {
+
+        RateLimiter::RateLimiter(double units_per_second, double burst)
+            : rate(units_per_second), capacity(std::max(burst, 1.0)), available(capacity), last_refill(Clock::now())
+        {
+        }
+
+        void RateLimiter::acquire(double units)
+        {
+            if (rate <= 0)
+            {
+                return;
+            }
+
+            std::chrono::duration<double> wait;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                Clock::time_point now = Clock::now();
+                available = std::min(capacity, available + std::chrono::duration<double>(now - last_refill).count() * rate);
+                last_refill = now;
+
+                // Take the units now, possibly going into debt, and sleep off the debt outside the
+                // lock; later callers see it and wait their turn behind us.
+                available -= units;
+                wait = std::chrono::duration<double>(available < 0 ? -available / rate : 0.0);
+            }
+            if (wait.count() > 0)
+            {
+                std::this_thread::sleep_for(wait);
+            }
+        }
+
+    } // namespace Concurrency
+} // namespace FileManager
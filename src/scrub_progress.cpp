@@ -0,0 +1,112 @@
+// src/scrub_progress.cpp
+#include "scrub_progress.hpp"
+#include "cid_utility.hpp"  // For isValidCID
+#include "group_commit.hpp" // For DurableFile
+#include <algorithm>        // For std::sort
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <stdexcept> // For std::runtime_error
+
+namespace fs = std::filesystem;
+
+namespace FileManager {
+namespace Metadata {
+
+namespace {
+const std::string PROGRESS_FILE_NAME = "progress.json";
+
+std::string currentTimestamp() {
+    std::time_t now_c = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char buf[256];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now_c));
+    return buf;
+}
+} // namespace
+
+void to_json(nlohmann::json& j, const ScrubProgress& p) {
+    j = nlohmann::json{
+        {"in_progress", p.in_progress},
+        {"position", p.position},
+        {"pass_started_at", p.pass_started_at},
+        {"checked_chunks", p.checked_chunks},
+        {"checked_bytes", p.checked_bytes},
+        {"corrupt_chunks", p.corrupt_chunks},
+        {"passes_completed", p.passes_completed},
+        {"last_pass_completed_at", p.last_pass_completed_at}
+    };
+}
+
+void from_json(const nlohmann::json& j, ScrubProgress& p) {
+    j.at("in_progress").get_to(p.in_progress);
+    j.at("position").get_to(p.position);
+    j.at("pass_started_at").get_to(p.pass_started_at);
+    j.at("checked_chunks").get_to(p.checked_chunks);
+    j.at("checked_bytes").get_to(p.checked_bytes);
+    j.at("corrupt_chunks").get_to(p.corrupt_chunks);
+    j.at("passes_completed").get_to(p.passes_completed);
+    j.at("last_pass_completed_at").get_to(p.last_pass_completed_at);
+}
+
+void ScrubProgress::startPass() {
+    in_progress = true;
+    position.clear();
+    pass_started_at = currentTimestamp();
+    checked_chunks = 0;
+    checked_bytes = 0;
+    corrupt_chunks = 0;
+}
+
+void ScrubProgress::completePass() {
+    in_progress = false;
+    position.clear();
+    ++passes_completed;
+    last_pass_completed_at = currentTimestamp();
+}
+
+nlohmann::json ScrubProgress::toJson() const {
+    return *this; // Uses the to_json helper function
+}
+
+ScrubProgress ScrubProgress::fromJson(const nlohmann::json& j) {
+    ScrubProgress progress;
+    j.get_to(progress); // Uses the from_json helper function
+    return progress;
+}
+
+bool ScrubProgress::save(const Config::ChunkConfig& config) const {
+    std::string contents = toJson().dump(4);
+    IO::DurableFile::writeAtomically(config.getScrubDirPath() / PROGRESS_FILE_NAME, contents.data(), contents.size());
+    return true;
+}
+
+ScrubProgress ScrubProgress::load(const Config::ChunkConfig& config) {
+    fs::path progress_path = config.getScrubDirPath() / PROGRESS_FILE_NAME;
+    std::ifstream ifs(progress_path);
+    if (!ifs.is_open()) {
+        return ScrubProgress(); // Never scrubbed
+    }
+
+    nlohmann::json j;
+    try {
+        ifs >> j;
+        return fromJson(j);
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Error parsing scrub progress " + progress_path.string() + ": " + e.what());
+    }
+}
+
+std::vector<std::string> ScrubProgress::listQuarantined(const Config::ChunkConfig& config) {
+    std::vector<std::string> cids;
+    for (const auto& entry : fs::directory_iterator(config.getQuarantineDirPath())) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && CID::CIDUtility::isValidCID(name)) {
+            cids.push_back(name);
+        }
+    }
+    std::sort(cids.begin(), cids.end());
+    return cids;
+}
+
+} // namespace Metadata
+} // namespace FileManager
@@ -1,13 +1,18 @@
 // src/thread_pool.cpp
 #include "thread_pool.hpp"
-#include <iostream> // For logging (can be replaced)
+#include "logger.hpp"
 
 namespace FileManager
 {
     namespace Concurrency
     {
 
-        ThreadPool::ThreadPool(size_t num_threads) : stop_all(false)
+        ThreadPool::ThreadPool(size_t num_threads)
+            : stop_all(false),
+              queue_depth(Metrics::Registry::global().gauge("fm_thread_pool_queue_depth", "Tasks waiting for a pool thread")),
+              busy_workers(Metrics::Registry::global().gauge("fm_thread_pool_busy_workers", "Pool threads running a task")),
+              queue_wait(Metrics::Registry::global().histogram("fm_thread_pool_queue_wait_seconds",
+                                                               "Time tasks wait in the pool queue before they start"))
         {
             if (num_threads == 0)
             {
@@ -34,13 +39,16 @@ namespace FileManager
                                 // Get the task from the front of the queue
                                 task = std::move(this->tasks.front());
                                 this->tasks.pop();
+                                this->queue_depth.add(-1);
                             }
                             // Execute the task outside the lock
+                            this->busy_workers.add(1);
                             task();
+                            this->busy_workers.add(-1);
                         }
                     });
             }
-            std::cout << "ThreadPool initialized with " << num_threads << " threads." << std::endl;
+            Logging::info("ThreadPool initialized", {{"threads", num_threads}});
         }
 
         ThreadPool::~ThreadPool()
@@ -60,7 +68,7 @@ namespace FileManager
                     worker.join();
                 }
             }
-            std::cout << "ThreadPool destroyed." << std::endl;
+            Logging::debug("ThreadPool destroyed");
         }
 
     } // namespace Concurrency
@@ -0,0 +1,125 @@
+// src/upload_session.cpp
+#include "upload_session.hpp"
+#include "group_commit.hpp" // For DurableFile
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <stdexcept> // For std::runtime_error
+
+namespace fs = std::filesystem;
+
+namespace FileManager {
+namespace Metadata {
+
+namespace {
+const std::string SESSION_FILE_NAME = "session.json";
+const size_t ID_LENGTH = 32;
+} // namespace
+
+void to_json(nlohmann::json& j, const UploadSession& s) {
+    j = nlohmann::json{
+        {"id", s.id},
+        {"filename", s.original_filename},
+        {"content_type", s.content_type},
+        {"created_at", s.created_at},
+        {"received", s.received_bytes},
+        {"tail_size", s.tail_size},
+        {"chunks", s.chunk_cids}
+    };
+}
+
+void from_json(const nlohmann::json& j, UploadSession& s) {
+    j.at("id").get_to(s.id);
+    j.at("filename").get_to(s.original_filename);
+    j.at("content_type").get_to(s.content_type);
+    j.at("created_at").get_to(s.created_at);
+    j.at("received").get_to(s.received_bytes);
+    j.at("tail_size").get_to(s.tail_size);
+    j.at("chunks").get_to(s.chunk_cids);
+}
+
+UploadSession::UploadSession(std::string filename, std::string type)
+    : original_filename(std::move(filename)), content_type(std::move(type)) {
+    static thread_local std::mt19937_64 rng(std::random_device{}());
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < ID_LENGTH; ++i) {
+        id += hex[rng() % 16];
+    }
+
+    std::time_t now_c = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char buf[256];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now_c));
+    created_at = buf;
+}
+
+nlohmann::json UploadSession::toJson() const {
+    return *this; // Uses the to_json helper function
+}
+
+UploadSession UploadSession::fromJson(const nlohmann::json& j) {
+    UploadSession session;
+    j.get_to(session); // Uses the from_json helper function
+    return session;
+}
+
+bool UploadSession::save(const Config::ChunkConfig& config) const {
+    fs::path dir = getDir(config);
+    fs::create_directories(dir);
+    std::string contents = toJson().dump(4);
+    IO::DurableFile::writeAtomically(dir / SESSION_FILE_NAME, contents.data(), contents.size());
+    return true;
+}
+
+UploadSession UploadSession::load(const Config::ChunkConfig& config, const std::string& id) {
+    if (!isValidId(id)) {
+        throw std::runtime_error("Upload session not found (invalid id): " + id);
+    }
+    fs::path session_path = config.getUploadsDirPath() / id / SESSION_FILE_NAME;
+    std::ifstream ifs(session_path);
+    if (!ifs.is_open()) {
+        throw std::runtime_error("Upload session not found: " + id);
+    }
+
+    nlohmann::json j;
+    try {
+        ifs >> j;
+        return fromJson(j);
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Error parsing upload session " + session_path.string() + ": " + e.what());
+    }
+}
+
+std::vector<std::string> UploadSession::listAll(const Config::ChunkConfig& config) {
+    std::vector<std::string> ids;
+    for (const auto& entry : fs::directory_iterator(config.getUploadsDirPath())) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_directory() && isValidId(name) && fs::exists(entry.path() / SESSION_FILE_NAME)) {
+            ids.push_back(name);
+        }
+    }
+    return ids;
+}
+
+bool UploadSession::isValidId(const std::string& id) {
+    if (id.size() != ID_LENGTH) {
+        return false;
+    }
+    for (char c : id) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+fs::path UploadSession::getDir(const Config::ChunkConfig& config) const {
+    return config.getUploadsDirPath() / id;
+}
+
+fs::path UploadSession::getTailPath(const Config::ChunkConfig& config) const {
+    return getDir(config) / (std::to_string(chunk_cids.size()) + ".tail");
+}
+
+} // namespace Metadata
+} // namespace FileManager
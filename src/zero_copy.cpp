@@ -0,0 +1,190 @@
+// src/zero_copy.cpp
+#include "zero_copy.hpp"
+#include <vector>
+#include <algorithm> // For std::min
+#include <cerrno>
+#include <cstring>   // For std::strerror
+#include <stdexcept> // For std::runtime_error
+
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0 // Only meaningful on Windows
+#endif
+
+namespace FileManager
+{
+    namespace IO
+    {
+
+        ScopedFd::~ScopedFd()
+        {
+            if (fd_ >= 0)
+            {
+                ::close(fd_);
+            }
+        }
+
+        ScopedFd &ScopedFd::operator=(ScopedFd &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (fd_ >= 0)
+                {
+                    ::close(fd_);
+                }
+                fd_ = other.release();
+            }
+            return *this;
+        }
+
+        int ScopedFd::release()
+        {
+            int fd = fd_;
+            fd_ = -1;
+            return fd;
+        }
+
+        void ScopedFd::writeAll(const char *data, size_t size) const
+        {
+            size_t done = 0;
+            while (done < size)
+            {
+                ssize_t written = ::write(fd_, data + done, size - done);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+                }
+                done += static_cast<size_t>(written);
+            }
+        }
+
+        ScopedFd ScopedFd::openForRead(const std::filesystem::path &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY | O_BINARY);
+            if (fd < 0)
+            {
+                throw std::runtime_error("Failed to open file for reading: " + path.string() + ": " + std::strerror(errno));
+            }
+            return ScopedFd(fd);
+        }
+
+        ScopedFd ScopedFd::openForWrite(const std::filesystem::path &path)
+        {
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+            if (fd < 0)
+            {
+                throw std::runtime_error("Failed to open file for writing: " + path.string() + ": " + std::strerror(errno));
+            }
+            return ScopedFd(fd);
+        }
+
+        ScopedFd ScopedFd::openForAppend(const std::filesystem::path &path)
+        {
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_BINARY, 0644);
+            if (fd < 0)
+            {
+                throw std::runtime_error("Failed to open file for appending: " + path.string() + ": " + std::strerror(errno));
+            }
+            return ScopedFd(fd);
+        }
+
+        void ZeroCopy::transfer(int out_fd, int in_fd, uint64_t offset, uint64_t length)
+        {
+#if defined(__linux__)
+            off_t in_offset = static_cast<off_t>(offset);
+            uint64_t remaining = length;
+            while (remaining > 0)
+            {
+                ssize_t sent = ::sendfile(out_fd, in_fd, &in_offset, static_cast<size_t>(remaining));
+                if (sent < 0)
+                {
+                    if (errno == EINTR || errno == EAGAIN)
+                    {
+                        continue;
+                    }
+                    if ((errno == EINVAL || errno == ENOSYS) && remaining == length)
+                    {
+                        // Descriptor pair not supported by sendfile; nothing sent yet, so fall back.
+                        bufferedTransfer(out_fd, in_fd, offset, length);
+                        return;
+                    }
+                    throw std::runtime_error(std::string("sendfile failed: ") + std::strerror(errno));
+                }
+                if (sent == 0)
+                {
+                    throw std::runtime_error("Unexpected end of file during zero-copy transfer.");
+                }
+                remaining -= static_cast<uint64_t>(sent);
+            }
+#else
+            bufferedTransfer(out_fd, in_fd, offset, length);
+#endif
+        }
+
+        void ZeroCopy::prefetch(int fd, uint64_t offset, uint64_t length)
+        {
+#if defined(__linux__)
+            // readahead(2) reads the range into the page cache before returning
+            ::readahead(fd, static_cast<off64_t>(offset), static_cast<size_t>(length));
+#elif defined(POSIX_FADV_WILLNEED)
+            ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+#else
+            (void)fd;
+            (void)offset;
+            (void)length;
+#endif
+        }
+
+        void ZeroCopy::bufferedTransfer(int out_fd, int in_fd, uint64_t offset, uint64_t length)
+        {
+            if (::lseek(in_fd, static_cast<off_t>(offset), SEEK_SET) < 0)
+            {
+                throw std::runtime_error(std::string("lseek failed: ") + std::strerror(errno));
+            }
+
+            std::vector<char> buffer(64 * 1024);
+            uint64_t remaining = length;
+            while (remaining > 0)
+            {
+                size_t want = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+                ssize_t got = ::read(in_fd, buffer.data(), want);
+                if (got < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw std::runtime_error(std::string("read failed: ") + std::strerror(errno));
+                }
+                if (got == 0)
+                {
+                    throw std::runtime_error("Unexpected end of file during buffered transfer.");
+                }
+
+                size_t written = 0;
+                while (written < static_cast<size_t>(got))
+                {
+                    ssize_t w = ::write(out_fd, buffer.data() + written, static_cast<size_t>(got) - written);
+                    if (w < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+                    }
+                    written += static_cast<size_t>(w);
+                }
+                remaining -= static_cast<uint64_t>(got);
+            }
+        }
+
+    } // namespace IO
+} // namespace FileManager
@@ -0,0 +1,79 @@
+// tests/compaction_test.cpp
+// Compaction re-encoding LZ4 chunks with zstd, with the thread-pool I/O engine.
+#include <chrono>
+#include <cstdlib>
+#include <future>
+
+#include "file_manager.hpp"
+#include "test_support.hpp"
+
+using namespace FileManager::Testing;
+using FileManager::Config::ChunkConfig;
+
+namespace
+{
+    // Log-like text, so zstd saves enough over LZ4 for compaction to rewrite every chunk
+    std::vector<char> textBytes(size_t size, size_t seed)
+    {
+        std::vector<char> data;
+        data.reserve(size);
+        for (size_t i = 0; data.size() < size; ++i)
+        {
+            std::string line = "2024-01-01T00:00:00Z INFO upload=" + std::to_string(seed) + " request=" +
+                               std::to_string(i * 7919 % 100000) + " status=200 path=/files/" + std::to_string(i % 977) + "\n";
+            data.insert(data.end(), line.begin(), line.end());
+        }
+        data.resize(size);
+        return data;
+    }
+
+    // With the thread-pool engine, chunk writes are queued on the same pool as the compaction
+    // batches. More batches than pool threads must not leave every worker waiting on a write
+    // queued behind it.
+    void compactMoreBatchesThanPoolThreads()
+    {
+        ScratchStore store("compaction-thread-pool");
+        const size_t pool_threads = 2;
+        const size_t chunks = 4 * pool_threads;
+        const std::vector<char> expected = textBytes(chunks * ChunkConfig::CHUNK_SIZE, 1);
+        writeFile(store.path("in"), expected);
+
+        ChunkConfig config = testConfig();
+        config.io_backend = ChunkConfig::IoBackend::ThreadPool;
+        config.compression = ChunkConfig::Compression::LZ4;
+        {
+            FileManager::FileManager fm(pool_threads, config);
+            fm.uploadFile(store.path("in").string(), "file.log", "text/plain");
+        }
+
+        config.compression = ChunkConfig::Compression::Zstd;
+        config.compaction_batch_size = 1; // One batch per chunk
+        config.compaction_min_saving_percent = 0;
+        config.compaction_max_bytes_per_second = 0;
+        FileManager::FileManager fm(pool_threads, config);
+
+        std::future<FileManager::FileManager::CompactionStats> compaction =
+            std::async(std::launch::async, [&fm]
+                       { return fm.compactChunks(); });
+        if (compaction.wait_for(std::chrono::seconds(60)) != std::future_status::ready)
+        {
+            std::printf("[FAIL] compactMoreBatchesThanPoolThreads: compaction deadlocked\n");
+            std::fflush(stdout);
+            std::_Exit(1); // The stuck pool threads can't be joined
+        }
+        const FileManager::FileManager::CompactionStats stats = compaction.get();
+        CHECK(stats.stale_chunks == chunks);
+        CHECK(stats.rewritten_chunks == chunks);
+        CHECK(stats.bytes_after < stats.bytes_before);
+
+        CHECK(fm.retrieveFile("file.log", store.path("out").string()));
+        CHECK(readFile(store.path("out")) == expected);
+    }
+} // namespace
+
+int main()
+{
+    return runTests({
+        {"compactMoreBatchesThanPoolThreads", compactMoreBatchesThanPoolThreads},
+    });
+}
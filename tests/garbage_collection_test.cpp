@@ -0,0 +1,167 @@
+// tests/garbage_collection_test.cpp
+// Garbage collection running concurrently with uploads that commit manifests, and after
+// updates that change how often a file repeats a chunk.
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "cid_utility.hpp"
+#include "file_manager.hpp"
+#include "test_support.hpp"
+
+using namespace FileManager::Testing;
+namespace fs = std::filesystem;
+
+namespace
+{
+    // Chunks uploaded with PUT /chunks are unreferenced (and, with no grace period, collectable)
+    // until their manifest is committed. A commit may fail because a chunk was collected first,
+    // in which case the client uploads it again; but once a commit succeeds every chunk it names
+    // must still be stored.
+    void commitWhileCollecting()
+    {
+        ScratchStore store("gc-commit");
+        FileManager::Config::ChunkConfig config = testConfig();
+        config.durability = FileManager::Config::ChunkConfig::Durability::None; // Only speed matters here
+        config.gc_batch_size = 1;                                               // Sweep on every pool thread
+        FileManager::FileManager fm(4, config);
+
+        std::atomic<bool> done{false};
+        std::thread collector([&]
+                              {
+                                  while (!done)
+                                  {
+                                      fm.collectGarbage();
+                                      std::this_thread::sleep_for(std::chrono::microseconds(200));
+                                  } });
+
+        std::atomic<size_t> committed{0};
+        std::atomic<size_t> retries{0};
+        std::atomic<size_t> failures{0};
+        auto uploader = [&](uint32_t seed)
+        {
+            const std::string filename = "file-" + std::to_string(seed);
+            for (uint32_t round = 0; round < 50; ++round)
+            {
+                std::vector<std::vector<char>> chunks;
+                std::vector<std::string> cids;
+                std::vector<char> expected;
+                for (uint32_t i = 0; i < 8; ++i)
+                {
+                    chunks.push_back(randomBytes(4096, seed * 100000 + round * 10 + i));
+                    cids.push_back(FileManager::CID::CIDUtility::generateSHA256(chunks.back()));
+                    expected.insert(expected.end(), chunks.back().begin(), chunks.back().end());
+                }
+
+                bool ok = false;
+                for (int attempt = 0; attempt < 100 && !ok; ++attempt)
+                {
+                    for (size_t i = 0; i < chunks.size(); ++i)
+                    {
+                        fm.putChunk(cids[i], chunks[i]);
+                    }
+                    try
+                    {
+                        fm.commitManifest(filename, "application/octet-stream", cids);
+                        ok = true;
+                    }
+                    catch (const std::runtime_error &)
+                    {
+                        ++retries; // A chunk was collected before the commit referenced it
+                    }
+                }
+                if (!ok)
+                {
+                    continue;
+                }
+                ++committed;
+                for (const std::string &cid : cids)
+                {
+                    if (!fs::exists(fs::path("chunks") / cid))
+                    {
+                        ++failures;
+                    }
+                }
+                const fs::path out = store.path("out-" + std::to_string(seed));
+                if (!fm.retrieveFile(filename, out.string()) || readFile(out) != expected)
+                {
+                    ++failures;
+                }
+            }
+        };
+        std::vector<std::thread> uploaders;
+        for (uint32_t seed = 1; seed <= 4; ++seed)
+        {
+            uploaders.emplace_back(uploader, seed);
+        }
+        for (std::thread &thread : uploaders)
+        {
+            thread.join();
+        }
+        done = true;
+        collector.join();
+
+        std::printf("%zu commits, %zu retried after a chunk was collected\n", committed.load(), retries.load());
+        CHECK(committed > 0);
+        CHECK(failures == 0);
+    }
+
+    std::vector<char> chunksOf(const std::vector<std::vector<char>> &chunks)
+    {
+        std::vector<char> data;
+        for (const auto &chunk : chunks)
+        {
+            data.insert(data.end(), chunk.begin(), chunk.end());
+        }
+        return data;
+    }
+
+    size_t storedChunkFiles()
+    {
+        size_t count = 0;
+        for (const auto &entry : fs::directory_iterator("chunks"))
+        {
+            count += entry.is_regular_file() ? 1 : 0;
+        }
+        return count;
+    }
+
+    // A chunk a file repeats holds one reference per occurrence. Changing how often it repeats,
+    // [A, A, B] to [A, B, B], must leave both chunks referenced once the old version is dropped.
+    void updateRepeatedChunks()
+    {
+        ScratchStore store("gc-repeated");
+        FileManager::Config::ChunkConfig config = testConfig();
+        config.file_versions_retained = 0; // Old versions release their references at once
+        FileManager::FileManager fm(2, config);
+
+        const std::vector<char> a = randomBytes(FileManager::Config::ChunkConfig::CHUNK_SIZE, 1);
+        const std::vector<char> b = randomBytes(FileManager::Config::ChunkConfig::CHUNK_SIZE, 2);
+        writeFile(store.path("in"), chunksOf({a, a, b}));
+        fm.uploadFile(store.path("in").string(), "file", "application/octet-stream");
+
+        const std::vector<char> expected = chunksOf({a, b, b});
+        writeFile(store.path("in"), expected);
+        fm.updateFile("file", store.path("in").string(), "application/octet-stream");
+        fm.collectGarbage();
+        CHECK(storedChunkFiles() == 2);
+        CHECK(fm.retrieveFile("file", store.path("out").string()));
+        CHECK(readFile(store.path("out")) == expected);
+
+        writeFile(store.path("in"), a);
+        fm.updateFile("file", store.path("in").string(), "application/octet-stream");
+        fm.collectGarbage();
+        CHECK(storedChunkFiles() == 1);
+        CHECK(fm.retrieveFile("file", store.path("out").string()));
+        CHECK(readFile(store.path("out")) == a);
+    }
+} // namespace
+
+int main()
+{
+    return runTests({
+        {"commitWhileCollecting", commitWhileCollecting},
+        {"updateRepeatedChunks", updateRepeatedChunks},
+    });
+}
@@ -0,0 +1,112 @@
+// tests/patch_test.cpp
+// PATCH on files chunked by the server and on files committed from client-chunked manifests,
+// and the byte ranges a diff reports for them.
+#include <algorithm>
+
+#include "cid_utility.hpp"
+#include "file_manager.hpp"
+#include "test_support.hpp"
+
+using namespace FileManager::Testing;
+using FileManager::Config::ChunkConfig;
+
+namespace
+{
+    // Applies the patch to `expected` as well, and checks the stored file matches it
+    void patchAndCheck(FileManager::FileManager &fm, const ScratchStore &store, const std::string &filename,
+                       std::vector<char> &expected, std::optional<uint64_t> offset, const std::vector<char> &patch)
+    {
+        const size_t at = static_cast<size_t>(offset.value_or(expected.size()));
+        expected.resize(std::max(expected.size(), at + patch.size()));
+        std::copy(patch.begin(), patch.end(), expected.begin() + static_cast<std::ptrdiff_t>(at));
+
+        FileManager::Metadata::FileMetadata metadata = fm.patchFile(filename, offset, patch);
+        CHECK(metadata.file_size_bytes == expected.size());
+        CHECK(fm.retrieveFile(filename, store.path("out").string()));
+        CHECK(readFile(store.path("out")) == expected);
+    }
+
+    void patchServerChunkedFile()
+    {
+        ScratchStore store("patch-server-chunked");
+        FileManager::FileManager fm(2, testConfig());
+        std::vector<char> expected = randomBytes(3 * ChunkConfig::CHUNK_SIZE + 100, 1);
+        writeFile(store.path("in"), expected);
+        const auto original = fm.uploadFile(store.path("in").string(), "file", "application/octet-stream");
+
+        patchAndCheck(fm, store, "file", expected, ChunkConfig::CHUNK_SIZE - 2000, std::vector<char>(5000, 'P'));
+        const auto patched = fm.getFileMetadata("file");
+        CHECK(patched.chunk_cids.size() == 4);
+        CHECK(patched.chunk_cids[0] != original.chunk_cids[0]);
+        CHECK(patched.chunk_cids[2] == original.chunk_cids[2]); // Untouched chunks are reused
+        CHECK(patched.chunk_cids[3] == original.chunk_cids[3]);
+
+        patchAndCheck(fm, store, "file", expected, std::nullopt, std::vector<char>(ChunkConfig::CHUNK_SIZE, 'A'));
+        patchAndCheck(fm, store, "file", expected, expected.size() - 10, std::vector<char>(100, 'E'));
+    }
+
+    void patchManifestWithSmallChunks()
+    {
+        ScratchStore store("patch-manifest");
+        FileManager::FileManager fm(2, testConfig());
+
+        // Client-chunked: three chunks of sizes unrelated to CHUNK_SIZE
+        std::vector<char> expected;
+        std::vector<std::string> cids;
+        for (size_t size : {100000, 300000, 50000})
+        {
+            std::vector<char> chunk = randomBytes(size, static_cast<uint32_t>(size));
+            cids.push_back(FileManager::CID::CIDUtility::generateSHA256(chunk));
+            expected.insert(expected.end(), chunk.begin(), chunk.end());
+            fm.putChunk(cids.back(), std::move(chunk));
+        }
+        fm.commitManifest("file", "application/octet-stream", cids);
+
+        // Inside the second chunk: the first and third are kept
+        patchAndCheck(fm, store, "file", expected, 150000, std::vector<char>(1000, 'M'));
+        auto metadata = fm.getFileMetadata("file");
+        CHECK(metadata.chunk_cids.front() == cids[0]);
+        CHECK(metadata.chunk_cids.back() == cids[2]);
+
+        // Across the boundary of the first two chunks, then past the end of the file
+        patchAndCheck(fm, store, "file", expected, 99000, std::vector<char>(3000, 'B'));
+        patchAndCheck(fm, store, "file", expected, expected.size() - 20000, std::vector<char>(40000, 'X'));
+        patchAndCheck(fm, store, "file", expected, std::nullopt, std::vector<char>(2 * ChunkConfig::CHUNK_SIZE, 'Y'));
+        patchAndCheck(fm, store, "file", expected, 0, std::vector<char>(10, 'Z'));
+    }
+
+    void diffManifestWithSmallChunks()
+    {
+        ScratchStore store("diff-manifest");
+        FileManager::FileManager fm(2, testConfig());
+
+        std::vector<std::string> cids;
+        for (size_t size : {100000, 300000, 50000})
+        {
+            std::vector<char> chunk = randomBytes(size, static_cast<uint32_t>(size));
+            cids.push_back(FileManager::CID::CIDUtility::generateSHA256(chunk));
+            fm.putChunk(cids.back(), std::move(chunk));
+        }
+        fm.commitManifest("file", "application/octet-stream", cids);
+        fm.patchFile("file", 150000, std::vector<char>(1000, 'M')); // Rewrites only the second chunk
+
+        const auto versions = fm.listFileVersions("file");
+        CHECK(versions.size() == 2);
+        const auto diff = fm.diffFiles("file", versions.front().version, "file", std::nullopt);
+        CHECK(!diff.identical);
+        CHECK(diff.ranges.size() == 1);
+        CHECK(diff.ranges[0].first_chunk == 1);
+        CHECK(diff.ranges[0].end_chunk == 2);
+        CHECK(diff.ranges[0].offset == 100000);
+        CHECK(diff.ranges[0].length == 300000);
+    }
+} // namespace
+
+int main()
+{
+    return runTests({
+        {"patchServerChunkedFile", patchServerChunkedFile},
+        {"patchManifestWithSmallChunks", patchManifestWithSmallChunks},
+        {"diffManifestWithSmallChunks", diffManifestWithSmallChunks},
+    });
+}
@@ -0,0 +1,120 @@
+// tests/test_support.hpp
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "chunk_config.hpp"
+#include "logger.hpp"
+
+// Each test is a plain executable run by ctest (see FM_BUILD_TESTS in CMakeLists.txt): a failed
+// CHECK throws, and runTests reports it and exits non-zero.
+#define CHECK(condition)                                                                              \
+    do                                                                                                \
+    {                                                                                                 \
+        if (!(condition))                                                                             \
+            throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) +          \
+                                     ": CHECK(" #condition ") failed");                               \
+    } while (false)
+
+namespace FileManager
+{
+    namespace Testing
+    {
+
+        // Chunk and metadata directories are relative to the working directory (see ChunkConfig),
+        // so each test case runs in a fresh directory under the temp directory, removed afterwards.
+        class ScratchStore
+        {
+        public:
+            explicit ScratchStore(const std::string &name)
+                : previous(std::filesystem::current_path()),
+                  dir(std::filesystem::temp_directory_path() / ("file-chunker-" + name))
+            {
+                std::filesystem::remove_all(dir);
+                std::filesystem::create_directories(dir);
+                std::filesystem::current_path(dir);
+            }
+
+            ~ScratchStore()
+            {
+                std::error_code ec;
+                std::filesystem::current_path(previous, ec);
+                std::filesystem::remove_all(dir, ec);
+            }
+
+            ScratchStore(const ScratchStore &) = delete;
+            ScratchStore &operator=(const ScratchStore &) = delete;
+
+            std::filesystem::path path(const std::string &name) const { return dir / name; }
+
+        private:
+            std::filesystem::path previous;
+            std::filesystem::path dir;
+        };
+
+        // Defaults with no background work and no grace period, so tests drive GC themselves
+        inline Config::ChunkConfig testConfig()
+        {
+            Config::ChunkConfig config;
+            config.gc_interval_s = 0;
+            config.gc_grace_period_s = 0;
+            config.compaction_interval_s = 0;
+            config.scrub_interval_s = 0;
+            return config;
+        }
+
+        inline std::vector<char> randomBytes(size_t size, uint32_t seed)
+        {
+            std::vector<char> data(size);
+            std::mt19937 rng(seed);
+            for (char &c : data)
+            {
+                c = static_cast<char>(rng());
+            }
+            return data;
+        }
+
+        inline void writeFile(const std::filesystem::path &path, const std::vector<char> &data)
+        {
+            std::ofstream(path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+
+        inline std::vector<char> readFile(const std::filesystem::path &path)
+        {
+            std::ifstream in(path, std::ios::binary);
+            return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        }
+
+        // Runs each named test case, reporting failures; returns the process exit status
+        inline int runTests(std::initializer_list<std::pair<const char *, std::function<void()>>> tests)
+        {
+            Logging::Logger::global().setLevel(Logging::Level::Warn);
+            int failed = 0;
+            for (const auto &[name, test] : tests)
+            {
+                try
+                {
+                    test();
+                    std::printf("[ OK ] %s\n", name);
+                }
+                catch (const std::exception &e)
+                {
+                    std::printf("[FAIL] %s: %s\n", name, e.what());
+                    ++failed;
+                }
+            }
+            Logging::Logger::global().flush();
+            return failed == 0 ? 0 : 1;
+        }
+
+    } // namespace Testing
+} // namespace FileManager